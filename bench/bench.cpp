@@ -1 +1,146 @@
-int main(int, char *[]) { return 0; }
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <memory>
+#include <slfmt.h>
+#include <string>
+#include <vector>
+
+#include "AllocationCounter.h"
+
+/*
+ * Benchmarks of a logging call on each logger. Besides the time, each benchmark reports the heap allocations made
+ * per call by the logging thread (the "allocs" counter, see test/AllocationCounter.h).
+ */
+
+namespace fs = std::filesystem;
+
+using slfmt::test::AllocationCounter;
+
+namespace {
+    struct NullSink : slfmt::Sink {
+        void Write([[maybe_unused]] const slfmt::Record &record) override {}
+    };
+
+    void BenchmarkInfo(benchmark::State &state, slfmt::LoggerBase &logger) {
+        // Warm up (thread buffers, lazily opened files...) before counting.
+        for (int i = 0; i < 64; i++) {
+            logger.Info("x={}", 42);
+        }
+
+        const auto before = AllocationCounter::Count();
+
+        for (auto _: state) {
+            logger.Info("x={}", 42);
+        }
+
+        state.counters["allocs"] = benchmark::Counter(static_cast<double>(AllocationCounter::Count() - before),
+                                                      benchmark::Counter::kAvgIterations);
+    }
+
+    void BM_DisabledLevel(benchmark::State &state) {
+        slfmt::SinkLogger logger("Bench", std::make_shared<NullSink>());
+        logger.SetLevel(slfmt::Level::WARN);
+        BenchmarkInfo(state, logger);
+    }
+
+    void BM_SinkLogger(benchmark::State &state) {
+        slfmt::SinkLogger logger("Bench", std::make_shared<NullSink>());
+        BenchmarkInfo(state, logger);
+    }
+
+    void BM_CombinedLogger(benchmark::State &state) {
+        std::vector<std::unique_ptr<slfmt::LoggerBase>> loggers;
+        loggers.push_back(slfmt::LogManager::GetSinkLogger("Bench", std::make_shared<NullSink>()));
+        loggers.push_back(slfmt::LogManager::GetSinkLogger("Bench", std::make_shared<NullSink>()));
+        slfmt::CombinedLogger logger("Bench", std::move(loggers));
+        BenchmarkInfo(state, logger);
+    }
+
+    void BM_StaticLogger(benchmark::State &state) {
+        slfmt::StaticLogger<NullSink, NullSink> logger("Bench");
+        BenchmarkInfo(state, logger);
+    }
+
+    void BM_FileLogger(benchmark::State &state) {
+        const auto path = fs::temp_directory_path() / "slfmt_bench.log";
+
+        {
+            slfmt::FileLogger logger("Bench", path.string());
+            BenchmarkInfo(state, logger);
+        }
+
+        fs::remove(path);
+    }
+
+    void BM_RollingFileLogger(benchmark::State &state) {
+        const auto path = fs::temp_directory_path() / "slfmt_bench_rolling.log";
+
+        {
+            slfmt::RollingFileLogger logger("Bench", path.string(), 64 << 20);
+            BenchmarkInfo(state, logger);
+        }
+
+        for (const auto &entry: fs::directory_iterator(fs::temp_directory_path())) {
+            if (entry.path().filename().string().starts_with("slfmt_bench_rolling")) {
+                fs::remove(entry.path());
+            }
+        }
+    }
+
+#ifndef _WIN32
+    void BM_ShmLogger(benchmark::State &state) {
+        slfmt::ShmRing::Remove("/slfmt_bench");
+
+        {
+            slfmt::ShmLogger logger("Bench", "/slfmt_bench");
+            BenchmarkInfo(state, logger);
+        }
+
+        slfmt::ShmRing::Remove("/slfmt_bench");
+    }
+
+    /**
+     * @brief A file logger shared as the sink of the loggers of each benchmark thread (the file is removed at exit).
+     */
+    struct SharedFile {
+        fs::path path;
+        std::shared_ptr<slfmt::FileLogger> logger;
+
+        explicit SharedFile(const std::string &name) : path(fs::temp_directory_path() / name) {
+            logger = std::make_shared<slfmt::FileLogger>("Bench", path.string());
+        }
+
+        ~SharedFile() {
+            logger.reset();
+            fs::remove(path);
+        }
+    };
+
+    void BM_DirectSink(benchmark::State &state) {
+        static SharedFile file("slfmt_bench_direct.log");
+        slfmt::SinkLogger logger("Bench", file.logger);
+        BenchmarkInfo(state, logger);
+    }
+
+    void BM_NumaBufferedSink(benchmark::State &state) {
+        // Destroyed before the file (in the reverse order of construction), which it drains to.
+        static SharedFile file("slfmt_bench_numa.log");
+        static const auto sink = std::make_shared<slfmt::NumaBufferedSink>(file.logger);
+        slfmt::SinkLogger logger("Bench", sink);
+        BenchmarkInfo(state, logger);
+    }
+
+    BENCHMARK(BM_ShmLogger);
+    BENCHMARK(BM_DirectSink)->ThreadRange(1, 8);
+    BENCHMARK(BM_NumaBufferedSink)->ThreadRange(1, 8);
+#endif
+
+    BENCHMARK(BM_DisabledLevel);
+    BENCHMARK(BM_SinkLogger);
+    BENCHMARK(BM_CombinedLogger);
+    BENCHMARK(BM_StaticLogger);
+    BENCHMARK(BM_FileLogger);
+    BENCHMARK(BM_RollingFileLogger);
+} // namespace
+
+BENCHMARK_MAIN();
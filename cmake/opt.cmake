@@ -35,3 +35,15 @@ if (WERROR)
 
     set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${ERROR_FLAG}")
 endif ()
+
+# Instrument everything (the library, its dependencies and the tests) with ThreadSanitizer
+option(SLFMT_SANITIZE_THREAD "Build with ThreadSanitizer (e.g. to run the stress tests)" OFF)
+
+if (SLFMT_SANITIZE_THREAD)
+    if (MSVC)
+        message(FATAL_ERROR "ThreadSanitizer is not supported by MSVC")
+    endif ()
+
+    add_compile_options(-fsanitize=thread -g)
+    add_link_options(-fsanitize=thread)
+endif ()
@@ -25,14 +25,27 @@
 #ifndef SLFMT_H
 #define SLFMT_H
 
+#include "slfmt/Clock.h"
 #include "slfmt/Color.h"
+#include "slfmt/Context.h"
+#include "slfmt/CrashHandler.h"
+#include "slfmt/Field.h"
+#include "slfmt/FileLock.h"
+#include "slfmt/Json.h"
 #include "slfmt/Level.h"
 #include "slfmt/LogFormat.h"
+#include "slfmt/LogVolume.h"
 #include "slfmt/Version.h"
 
 #include "slfmt/ConsoleLogger.h"
+#include "slfmt/DurableFileLogger.h"
 #include "slfmt/FileLogger.h"
 #include "slfmt/LoggerBase.h"
 #include "slfmt/LogManager.h"
+#include "slfmt/NumaBufferedSink.h"
+#include "slfmt/ScopedTimer.h"
+#include "slfmt/ShmLogger.h"
+#include "slfmt/SinkLogger.h"
+#include "slfmt/StaticLogger.h"
 
 #endif // SLFMT_H
@@ -0,0 +1,107 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * BlockIndex-inl.h - Implementation of the time index of compressed blocks
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_BLOCK_INDEX_INL_H
+#define SLFMT_BLOCK_INDEX_INL_H
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <miniz.h>
+#include <slfmt/Clock.h>
+#include <sstream>
+#include <stdexcept>
+
+#include "BlockIndex.h"
+
+namespace slfmt {
+    SLFMT_INLINE std::string BlockIndex::IndexFileName(const std::string_view file) {
+        return fmt::format("{}{}", file, EXTENSION);
+    }
+
+    SLFMT_INLINE std::int64_t BlockIndex::Now() {
+        return Millis(Clock::Now());
+    }
+
+    SLFMT_INLINE std::int64_t BlockIndex::Millis(const std::chrono::system_clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+    }
+
+    SLFMT_INLINE std::string BlockIndex::FormatEntry(const Entry &entry) {
+        return fmt::format("{} {} {} {} {} {}\n", entry.firstTime, entry.lastTime, entry.offset, entry.size,
+                           entry.levels, entry.records);
+    }
+
+    SLFMT_INLINE std::vector<BlockIndex::Entry> BlockIndex::Read(const std::filesystem::path &indexFile) {
+        std::ifstream stream(indexFile);
+        std::vector<Entry> entries;
+        std::string line;
+
+        while (std::getline(stream, line)) {
+            std::istringstream fields(line);
+            Entry entry;
+
+            if (fields >> entry.firstTime >> entry.lastTime >> entry.offset >> entry.size >> entry.levels >>
+                entry.records) {
+                entries.push_back(entry);
+            }
+        }
+
+        return entries;
+    }
+
+    SLFMT_INLINE std::string BlockIndex::ReadBlock(const std::filesystem::path &file, const Entry &entry) {
+        static constexpr size_t GZIP_HEADER_SIZE = 10;
+        static constexpr size_t GZIP_TRAILER_SIZE = 8;
+
+        std::ifstream stream(file, std::ios::binary);
+        std::string compressed(entry.size, '\0');
+
+        stream.seekg(static_cast<std::streamoff>(entry.offset));
+        stream.read(compressed.data(), static_cast<std::streamsize>(compressed.size()));
+
+        if (!stream || compressed.size() < GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE ||
+            static_cast<unsigned char>(compressed[0]) != 0x1F || static_cast<unsigned char>(compressed[1]) != 0x8B) {
+            throw std::runtime_error(fmt::format("Invalid block at offset {} of {}", entry.offset, file.string()));
+        }
+
+        mz_stream inflater{};
+        std::string output;
+        std::array<unsigned char, 64 * 1024> chunk{};
+
+        if (mz_inflateInit2(&inflater, -MZ_DEFAULT_WINDOW_BITS) != MZ_OK) {
+            throw std::runtime_error("Failed to initialize the gzip decompressor.");
+        }
+
+        inflater.next_in = reinterpret_cast<const unsigned char *>(compressed.data()) + GZIP_HEADER_SIZE;
+        inflater.avail_in = static_cast<unsigned int>(compressed.size() - GZIP_HEADER_SIZE);
+
+        int status = MZ_OK;
+
+        while (status == MZ_OK) {
+            inflater.next_out = chunk.data();
+            inflater.avail_out = static_cast<unsigned int>(chunk.size());
+
+            status = mz_inflate(&inflater, MZ_NO_FLUSH);
+            output.append(reinterpret_cast<const char *>(chunk.data()), chunk.size() - inflater.avail_out);
+        }
+
+        mz_inflateEnd(&inflater);
+
+        if (status != MZ_STREAM_END) {
+            throw std::runtime_error(fmt::format("Corrupt block at offset {} of {}", entry.offset, file.string()));
+        }
+
+        return output;
+    }
+} // namespace slfmt
+
+#endif // SLFMT_BLOCK_INDEX_INL_H
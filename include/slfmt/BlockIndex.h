@@ -0,0 +1,157 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * BlockIndex.h - Time index of the compressed blocks of a log file
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_BLOCK_INDEX_H
+#define SLFMT_BLOCK_INDEX_H
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fmt/format.h>
+#include <string>
+#include <vector>
+
+#include "Config.h"
+#include "Level.h"
+
+namespace slfmt {
+    /**
+     * @brief Sidecar index of a log file written as a sequence of independent gzip members ("blocks").
+     *
+     * @note The index of <code>file.gz</code> is <code>file.gz.idx</code>, a text file with one line per block:
+     * <code>firstTime lastTime offset size levels records</code>, where the times are milliseconds since the epoch,
+     * offset and size locate the block in the compressed file and levels is a bit mask of the levels of the records
+     * in the block. A line is only appended once its block is completely written, so the index never points to
+     * incomplete data (not even after a crash).
+     */
+    class BlockIndex {
+    public:
+        static constexpr std::string_view EXTENSION = ".idx";
+
+        /**
+         * @brief An entry of the index (a block of the compressed file).
+         */
+        struct Entry {
+            std::int64_t firstTime = 0;
+            std::int64_t lastTime = 0;
+            std::uint64_t offset = 0;
+            std::uint64_t size = 0;
+            std::uint32_t levels = 0;
+            std::uint32_t records = 0;
+
+            /**
+             * @brief Records a message of the specified level logged at the specified time into the entry.
+             *
+             * @param level The level of the message.
+             * @param time The time (milliseconds since the epoch) of the message.
+             */
+            void Add(const Level level, const std::int64_t time) {
+                if (records == 0) {
+                    firstTime = time;
+                }
+
+                lastTime = time;
+                levels |= LevelBit(level);
+                records++;
+            }
+
+            /**
+             * @brief Checks if the block may contain messages between the specified times.
+             *
+             * @param from The start of the time range (milliseconds since the epoch).
+             * @param to The end of the time range (milliseconds since the epoch).
+             *
+             * @return True if the time range of the block overlaps the specified one.
+             */
+            FMT_NODISCARD bool Overlaps(const std::int64_t from, const std::int64_t to) const {
+                return firstTime <= to && lastTime >= from;
+            }
+
+            /**
+             * @brief Checks if the block contains messages of the specified level or a more severe one.
+             *
+             * @param level The minimum level.
+             *
+             * @return True if the block contains such a message.
+             */
+            FMT_NODISCARD bool HasLevelAtLeast(const Level level) const {
+                return (levels >> static_cast<unsigned int>(level)) != 0;
+            }
+        };
+
+        BlockIndex() = delete;
+        ~BlockIndex() = delete;
+
+        /**
+         * @brief Gets the index file of the specified compressed file.
+         *
+         * @param file The compressed file.
+         *
+         * @return The index file.
+         */
+        static std::string IndexFileName(std::string_view file);
+
+        /**
+         * @brief Gets the current time (from the Clock) as milliseconds since the epoch.
+         *
+         * @return The current time.
+         */
+        static std::int64_t Now();
+
+        /**
+         * @brief Gets a time as milliseconds since the epoch.
+         *
+         * @param time The time.
+         *
+         * @return The time in milliseconds.
+         */
+        static std::int64_t Millis(std::chrono::system_clock::time_point time);
+
+        /**
+         * @brief Formats an entry as a line of the index file.
+         *
+         * @param entry The entry to format.
+         *
+         * @return The line (ending with a newline).
+         */
+        static std::string FormatEntry(const Entry &entry);
+
+        /**
+         * @brief Reads the entries of an index file.
+         *
+         * @param indexFile The index file to read.
+         *
+         * @return The entries of the index (malformed lines are skipped).
+         */
+        static std::vector<Entry> Read(const std::filesystem::path &indexFile);
+
+        /**
+         * @brief Reads and decompresses a block of a compressed file.
+         *
+         * @param file The compressed file.
+         * @param entry The index entry of the block.
+         *
+         * @return The decompressed contents of the block.
+         */
+        static std::string ReadBlock(const std::filesystem::path &file, const Entry &entry);
+
+    private:
+        static constexpr std::uint32_t LevelBit(const Level level) {
+            return 1U << static_cast<unsigned int>(level);
+        }
+    };
+} // namespace slfmt
+
+#ifndef SLFMT_COMPILED_LIB
+    #include "BlockIndex-inl.h"
+#endif
+
+#endif // SLFMT_BLOCK_INDEX_H
@@ -0,0 +1,383 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * Clock.h - Pluggable source of the timestamps of the log messages
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_CLOCK_H
+#define SLFMT_CLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define SLFMT_HAS_TSC
+
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+        #include <x86intrin.h>
+    #endif
+#endif
+
+namespace slfmt {
+    /**
+     * @brief The clock the log messages are timestamped with.
+     *
+     * @note By default it is <code>std::chrono::system_clock</code>. Use() selects a cheaper source: the coarse
+     * real-time clock of the kernel (a few milliseconds of resolution) or the time stamp counter of the CPU, which
+     * is read without a system call. The TSC is calibrated against the system clock when selected, and a background
+     * thread re-synchronizes it every Tsc::RESYNC_INTERVAL, so it follows the adjustments of the system clock (with
+     * small steps at each re-synchronization).
+     */
+    class Clock {
+    public:
+        using TimePoint = std::chrono::system_clock::time_point;
+
+        /**
+         * @brief A function returning the current time.
+         */
+        using NowFunction = TimePoint (*)();
+
+        /**
+         * @brief The sources the clock can read the time from.
+         */
+        enum class Source {
+            /**
+             * @brief <code>std::chrono::system_clock</code>.
+             */
+            SYSTEM,
+
+            /**
+             * @brief <code>clock_gettime(CLOCK_REALTIME_COARSE)</code> (Linux only).
+             */
+            COARSE,
+
+            /**
+             * @brief The time stamp counter of the CPU, calibrated against the system clock (x86-64 CPUs with an
+             * invariant TSC only).
+             */
+            TSC,
+
+            /**
+             * @brief A function set with Use(NowFunction).
+             */
+            CUSTOM
+        };
+
+        Clock() = delete;
+
+        /**
+         * @brief Gets the current time from the selected source.
+         *
+         * @return The current time.
+         */
+        static TimePoint Now() {
+            return s_now.load(std::memory_order_relaxed)();
+        }
+
+        /**
+         * @brief Selects the source of the clock.
+         *
+         * @note Selecting the TSC calibrates it (which takes about Tsc::CALIBRATION_TIME) and starts the
+         * re-synchronization thread. If a source is not available, the next one is used: TSC, COARSE, SYSTEM.
+         *
+         * @param source The source to use.
+         *
+         * @return The source actually used.
+         */
+        static Source Use(Source source) {
+            if (source == Source::TSC && !Tsc::IsAvailable()) {
+                source = Source::COARSE;
+            }
+
+#ifndef CLOCK_REALTIME_COARSE
+            if (source == Source::COARSE) {
+                source = Source::SYSTEM;
+            }
+#endif
+
+            if (source == Source::TSC) {
+                Tsc::Get().Start();
+                Set(Source::TSC, &Tsc::Now);
+                return source;
+            }
+
+            Tsc::Get().Stop();
+
+            if (source == Source::COARSE) {
+                Set(Source::COARSE, &CoarseNow);
+            } else {
+                Set(Source::SYSTEM, &SystemNow);
+            }
+
+            return GetSource();
+        }
+
+        /**
+         * @brief Uses the specified function as the source of the clock (e.g. a fixed time in tests).
+         *
+         * @param now The function returning the current time.
+         */
+        static void Use(const NowFunction now) {
+            Tsc::Get().Stop();
+            Set(Source::CUSTOM, now);
+        }
+
+        /**
+         * @brief Gets the selected source.
+         *
+         * @return The source of the clock.
+         */
+        static Source GetSource() {
+            return s_source.load(std::memory_order_relaxed);
+        }
+
+    private:
+        /**
+         * @brief Time stamp counter calibrated against the system clock.
+         *
+         * @note The conversion parameters (a TSC value, the time it corresponds to and the nanoseconds per tick as
+         * a 32.32 fixed point number) are published with a sequence lock, so Now() only reads the counter and
+         * does a multiplication.
+         */
+        class Tsc {
+        public:
+            static constexpr auto CALIBRATION_TIME = std::chrono::milliseconds(20);
+            static constexpr auto RESYNC_INTERVAL = std::chrono::seconds(1);
+
+            static Tsc &Get() {
+                static Tsc tsc;
+                return tsc;
+            }
+
+            /**
+             * @brief Checks if the CPU has a TSC that ticks at a constant rate, in all the cores and power states.
+             *
+             * @return True if the TSC can be used as a clock.
+             */
+            static bool IsAvailable() {
+#ifdef SLFMT_HAS_TSC
+    #ifdef _MSC_VER
+                int registers[4] = {};
+                __cpuid(registers, 0x80000000);
+
+                if (static_cast<unsigned int>(registers[0]) < 0x80000007) {
+                    return false;
+                }
+
+                __cpuid(registers, 0x80000007);
+                return (registers[3] & (1 << 8)) != 0;
+    #else
+                unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+                return __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) != 0 && (edx & (1U << 8)) != 0;
+    #endif
+#else
+                return false;
+#endif
+            }
+
+            static TimePoint Now() {
+                std::uint64_t ticks = 0, baseTicks = 0, baseNanos = 0, scale = 0;
+                std::uint32_t sequence = 0;
+
+                do {
+                    sequence = s_sequence.load(std::memory_order_acquire);
+                    ticks = ReadCounter();
+                    baseTicks = s_baseTicks.load(std::memory_order_relaxed);
+                    baseNanos = s_baseNanos.load(std::memory_order_relaxed);
+                    scale = s_scale.load(std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                } while ((sequence & 1) != 0 || sequence != s_sequence.load(std::memory_order_relaxed));
+
+                // Another core may be a few ticks behind the one that took the base sample.
+                const auto elapsed = ticks > baseTicks ? ticks - baseTicks : 0;
+                return TimePoint(std::chrono::duration_cast<TimePoint::duration>(
+                        std::chrono::nanoseconds(baseNanos + MultiplyFixedPoint(elapsed, scale))));
+            }
+
+            /**
+             * @brief Calibrates the counter and starts the re-synchronization thread (if not running).
+             */
+            void Start() {
+                const std::lock_guard lock(m_mutex);
+
+                if (m_thread.joinable()) {
+                    return;
+                }
+
+                auto sample = TakeSample();
+                std::this_thread::sleep_for(CALIBRATION_TIME);
+                sample = Publish(sample, TakeSample());
+
+                m_stop = false;
+                m_thread = std::thread([this, sample]() mutable {
+                    std::unique_lock threadLock(m_mutex);
+
+                    while (!m_wakeUp.wait_for(threadLock, RESYNC_INTERVAL, [this] { return m_stop; })) {
+                        sample = Publish(sample, TakeSample());
+                    }
+                });
+            }
+
+            /**
+             * @brief Stops the re-synchronization thread (if running).
+             */
+            void Stop() {
+                std::thread thread;
+
+                {
+                    const std::lock_guard lock(m_mutex);
+                    m_stop = true;
+                    thread = std::move(m_thread);
+                }
+
+                m_wakeUp.notify_all();
+
+                if (thread.joinable()) {
+                    thread.join();
+                }
+            }
+
+            Tsc(const Tsc &) = delete;
+            Tsc &operator=(const Tsc &) = delete;
+
+            ~Tsc() {
+                Stop();
+            }
+
+        private:
+            /**
+             * @brief A value of the counter and the time (in nanoseconds since the epoch) it was read at.
+             */
+            struct Sample {
+                std::uint64_t ticks;
+                std::uint64_t nanos;
+            };
+
+            // The conversion parameters are static (and trivially destructible), so Now() keeps working while
+            // other static objects are destroyed.
+            static inline std::atomic<std::uint32_t> s_sequence = 0;
+            static inline std::atomic<std::uint64_t> s_baseTicks = 0;
+            static inline std::atomic<std::uint64_t> s_baseNanos = 0;
+            static inline std::atomic<std::uint64_t> s_scale = 0;
+
+            std::mutex m_mutex;
+            std::condition_variable m_wakeUp;
+            bool m_stop = false;
+            std::thread m_thread;
+
+            Tsc() = default;
+
+            static std::uint64_t ReadCounter() {
+#ifdef SLFMT_HAS_TSC
+                return __rdtsc();
+#else
+                return 0;
+#endif
+            }
+
+            static std::uint64_t MultiplyFixedPoint(const std::uint64_t ticks, const std::uint64_t scale) {
+#if !defined(SLFMT_HAS_TSC)
+                return (ticks * scale) >> 32;
+#elif defined(_MSC_VER)
+                std::uint64_t high = 0;
+                const std::uint64_t low = _umul128(ticks, scale, &high);
+                return (high << 32) | (low >> 32);
+#else
+                // A GCC and Clang extension, marked as such so that -Wpedantic accepts it.
+                __extension__ using Product = unsigned __int128;
+                return static_cast<std::uint64_t>((static_cast<Product>(ticks) * scale) >> 32);
+#endif
+            }
+
+            /**
+             * @brief Reads the counter and the system clock at (almost) the same time.
+             *
+             * @return The sample with the narrowest window out of a few attempts.
+             */
+            static Sample TakeSample() {
+                Sample best{};
+                std::uint64_t bestWindow = UINT64_MAX;
+
+                for (int i = 0; i < 5; i++) {
+                    const auto before = ReadCounter();
+                    const auto now = std::chrono::system_clock::now();
+                    const auto after = ReadCounter();
+
+                    if (after - before < bestWindow) {
+                        bestWindow = after - before;
+                        best.ticks = before + (after - before) / 2;
+                        best.nanos = static_cast<std::uint64_t>(
+                                std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count());
+                    }
+                }
+
+                return best;
+            }
+
+            /**
+             * @brief Publishes the conversion parameters measured between two samples.
+             *
+             * @param previous The previous sample.
+             * @param current The current sample (the new base).
+             *
+             * @return The current sample.
+             */
+            static Sample Publish(const Sample &previous, const Sample &current) {
+                if (current.ticks <= previous.ticks || current.nanos <= previous.nanos) {
+                    return previous; // The system clock went back: wait for the next interval.
+                }
+
+                const auto scale = static_cast<std::uint64_t>(
+                        (static_cast<long double>(current.nanos - previous.nanos) * 4294967296.0L) /
+                        static_cast<long double>(current.ticks - previous.ticks));
+
+                s_sequence.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                s_baseTicks.store(current.ticks, std::memory_order_relaxed);
+                s_baseNanos.store(current.nanos, std::memory_order_relaxed);
+                s_scale.store(scale, std::memory_order_relaxed);
+                s_sequence.fetch_add(1, std::memory_order_release);
+
+                return current;
+            }
+        };
+
+        static void Set(const Source source, const NowFunction now) {
+            s_now.store(now, std::memory_order_relaxed);
+            s_source.store(source, std::memory_order_relaxed);
+        }
+
+        static TimePoint SystemNow() {
+            return std::chrono::system_clock::now();
+        }
+
+        static TimePoint CoarseNow() {
+#ifdef CLOCK_REALTIME_COARSE
+            timespec ts{};
+            clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+            return TimePoint(std::chrono::duration_cast<TimePoint::duration>(std::chrono::seconds(ts.tv_sec) +
+                                                                            std::chrono::nanoseconds(ts.tv_nsec)));
+#else
+            return SystemNow();
+#endif
+        }
+
+        static inline std::atomic<NowFunction> s_now = &SystemNow;
+        static inline std::atomic<Source> s_source = Source::SYSTEM;
+    };
+} // namespace slfmt
+
+#endif // SLFMT_CLOCK_H
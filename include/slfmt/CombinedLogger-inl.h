@@ -0,0 +1,193 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * CombinedLogger-inl.h - Implementation of the combined logger
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_COMBINED_LOGGER_INL_H
+#define SLFMT_COMBINED_LOGGER_INL_H
+
+#include <algorithm>
+#include <slfmt/LogFormat.h>
+
+#include "CombinedLogger.h"
+
+namespace slfmt {
+    SLFMT_INLINE CombinedLogger::CombinedLogger(const std::string_view &clazz,
+                                                std::vector<std::unique_ptr<LoggerBase>> loggers,
+                                                const Options &options)
+        : LoggerBase(clazz), m_loggers(std::move(loggers)), m_options(options) {
+        if (m_options.delivery == Delivery::QUEUED) {
+            for (size_t i = 0; i < m_loggers.size(); i++) {
+                m_queues.push_back(std::make_unique<Queue>());
+            }
+        }
+    }
+
+    SLFMT_INLINE CombinedLogger::~CombinedLogger() {
+        FlushRepeats();
+
+        // The threads write the messages left in their queues before exiting.
+        for (const auto &queue: m_queues) {
+            if (!queue->start.IsDone()) {
+                continue;
+            }
+
+            {
+                const std::lock_guard lock(queue->mutex);
+                queue->stop = true;
+            }
+
+            queue->wakeUp.notify_one();
+            queue->worker.join();
+        }
+
+        m_loggers.clear();
+    }
+
+    SLFMT_INLINE bool CombinedLogger::IsEnabled(const Level level) const {
+        if (!LoggerBase::IsEnabled(level)) {
+            return false;
+        }
+
+        return std::any_of(m_loggers.begin(), m_loggers.end(), [level](const auto &logger) {
+            return logger->IsEnabled(level);
+        });
+    }
+
+    SLFMT_INLINE void CombinedLogger::Write(const Record &record) {
+        if (!m_queues.empty()) {
+            Enqueue(record);
+            return;
+        }
+
+        // The loggers agree on the time of the record, and the first one that shows it formats it for the others.
+        const LogFormat::TimestampScope timestampScope(LogFormat::GetTime());
+
+        for (const auto &logger: m_loggers) {
+            if (logger->IsEnabled(record.level)) {
+                logger->Write(record);
+            }
+        }
+    }
+
+    SLFMT_INLINE void CombinedLogger::WriteBatch(const std::string_view clazz, const LogBatch &batch) {
+        if (!m_queues.empty()) {
+            LoggerBase::WriteBatch(clazz, batch);
+            return;
+        }
+
+        for (const auto &logger: m_loggers) {
+            logger->WriteBatch(clazz, batch);
+        }
+    }
+
+    SLFMT_INLINE void CombinedLogger::Flush() {
+        for (const auto &queue: m_queues) {
+            std::unique_lock lock(queue->mutex);
+            const auto enqueued = queue->enqueued;
+            queue->written.wait(lock, [&queue, enqueued] {
+                return queue->done >= enqueued;
+            });
+        }
+    }
+
+    SLFMT_INLINE std::uint64_t CombinedLogger::Dropped(const size_t logger) const {
+        return m_queues.empty() ? 0 : m_queues.at(logger)->dropped.load(std::memory_order_relaxed);
+    }
+
+    SLFMT_INLINE std::uint64_t CombinedLogger::Dropped() const {
+        std::uint64_t dropped = 0;
+
+        for (const auto &queue: m_queues) {
+            dropped += queue->dropped.load(std::memory_order_relaxed);
+        }
+
+        return dropped;
+    }
+
+    SLFMT_INLINE void CombinedLogger::Enqueue(const Record &record) {
+        std::shared_ptr<const QueuedRecord> queued;
+
+        for (size_t i = 0; i < m_loggers.size(); i++) {
+            if (!m_loggers[i]->IsEnabled(record.level)) {
+                continue;
+            }
+
+            // Copied once for all the loggers, with the time, thread, fields and context the loggers would have
+            // formatted.
+            if (queued == nullptr) {
+                const auto time = LogFormat::GetTime();
+                queued = std::make_shared<const QueuedRecord>(
+                        QueuedRecord{ record.level, std::string(record.clazz), std::string(record.message), time,
+                                      LogFormat::FormatTimestamp(time), LogFormat::GetThreadIdString(),
+                                      LogFormat::Attributes::Capture() });
+            }
+
+            auto &queue = *m_queues[i];
+
+            queue.start.Run([this, &queue, i] {
+                queue.worker = std::thread(&CombinedLogger::Deliver, this, i);
+            });
+
+            {
+                const std::lock_guard lock(queue.mutex);
+
+                if (queue.records.size() >= m_options.queueSize) {
+                    queue.dropped.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                queue.records.push_back(queued);
+                queue.enqueued++;
+            }
+
+            queue.wakeUp.notify_one();
+        }
+    }
+
+    SLFMT_INLINE void CombinedLogger::Deliver(const size_t index) {
+        auto &queue = *m_queues[index];
+        auto &logger = *m_loggers[index];
+        std::deque<std::shared_ptr<const QueuedRecord>> records;
+        std::unique_lock lock(queue.mutex);
+
+        while (true) {
+            queue.wakeUp.wait(lock, [&queue] {
+                return !queue.records.empty() || queue.stop;
+            });
+
+            if (queue.records.empty()) {
+                return; // Stopped, and everything is written.
+            }
+
+            records.swap(queue.records);
+            lock.unlock();
+
+            for (const auto &record: records) {
+                const LogFormat::TimestampScope timestampScope(record->timestamp, record->time);
+                const LogFormat::ThreadIdScope threadIdScope(record->threadId);
+                const LogFormat::AttributesScope attributesScope(record->attributes);
+
+                try {
+                    logger.Write({ record->level, record->clazz, record->message });
+                } catch (...) {
+                    // Nobody to report the error to: the message is counted as dropped.
+                    queue.dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            lock.lock();
+            queue.done += records.size();
+            records.clear();
+            queue.written.notify_all();
+        }
+    }
+} // namespace slfmt
+
+#endif // SLFMT_COMBINED_LOGGER_INL_H
@@ -12,15 +12,65 @@
 #ifndef SLFMT_COMBINED_LOGGER_H
 #define SLFMT_COMBINED_LOGGER_H
 
+#include "Config.h"
+#include "LazyInit.h"
+#include "LogFormat.h"
 #include "LoggerBase.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
 namespace slfmt {
     /**
      * @brief Combined logger for slfmt (logs to multiple loggers at once).
+     *
+     * @note Each message is formatted once, and only if some logger accepts its level (see LoggerBase::SetLevel()),
+     * e.g. a console logger at WARN, a file logger at DEBUG and an <code>errors.log</code> file logger at ERROR.
+     * By default the loggers are called one after the other, so a logger that blocks (e.g. on a full pipe) blocks
+     * the others too. With Delivery::QUEUED, each logger gets its own bounded queue and thread instead: a slow logger
+     * only fills its own queue, and drops (and counts, see Dropped()) the messages that do not fit. Queued messages
+     * keep the time, thread, fields and context they were logged with.
      */
     class CombinedLogger : public LoggerBase {
     public:
+        /**
+         * @brief How the messages are handed to the loggers.
+         */
+        enum class Delivery {
+            /**
+             * @brief The logging thread writes each message to the loggers, one after the other.
+             */
+            INLINE,
+
+            /**
+             * @brief The logging thread queues each message for every logger, and a thread per logger writes them.
+             */
+            QUEUED
+        };
+
+        /**
+         * @brief Options of the combined logger.
+         */
+        struct Options {
+            /**
+             * @brief How the messages are handed to the loggers.
+             */
+            Delivery delivery = Delivery::INLINE;
+
+            /**
+             * @brief The maximum number of messages waiting for each logger (Delivery::QUEUED only). Messages
+             * logged while the queue of a logger is full are dropped for that logger.
+             */
+            size_t queueSize = 8192;
+        };
+
         /**
          * @brief Construct a new Combined Logger object with the given loggers.
          *
@@ -28,51 +78,137 @@ namespace slfmt {
          * @param loggers Loggers to log to.
          */
         CombinedLogger(const std::string_view &clazz, std::vector<std::unique_ptr<LoggerBase>> loggers)
-                : LoggerBase(clazz), m_loggers(std::move(loggers)) {}
+            : CombinedLogger(clazz, std::move(loggers), Options{}) {}
+
+        /**
+         * @brief Construct a new Combined Logger object with the given loggers and options.
+         *
+         * @note With Delivery::QUEUED, the thread of a logger is started when its first message is queued.
+         *
+         * @param clazz Class name.
+         * @param loggers Loggers to log to.
+         * @param options The options of the logger.
+         */
+        CombinedLogger(const std::string_view &clazz, std::vector<std::unique_ptr<LoggerBase>> loggers,
+                       const Options &options);
+
+        ~CombinedLogger() override;
 
-        ~CombinedLogger() override {
-            m_loggers.clear();
-        }
+        /**
+         * @brief Checks if the combined logger and at least one of its loggers write messages of the level.
+         *
+         * @param level The level to check.
+         *
+         * @return True if messages of the level are written.
+         */
+        FMT_NODISCARD bool IsEnabled(const Level level) const override;
+
+        /**
+         * @brief Writes a record to the loggers that accept its level (or queues it for them).
+         *
+         * @param record The record to write.
+         */
+        void Write(const Record &record) override;
+
+        /**
+         * @brief Forwards a batch to all the loggers, so each of them writes it at once (with Delivery::QUEUED,
+         * its messages are queued one by one).
+         *
+         * @param clazz The class of the records.
+         * @param batch The records to write.
+         */
+        void WriteBatch(std::string_view clazz, const LogBatch &batch) override;
+
+        /**
+         * @brief Waits until all the messages queued so far have been written (or dropped). Does nothing with
+         * Delivery::INLINE.
+         */
+        void Flush();
+
+        /**
+         * @brief Gets the number of messages dropped so far for a logger because its queue was full.
+         *
+         * @param logger The index of the logger (in the order they were given).
+         *
+         * @return The number of dropped messages (always 0 with Delivery::INLINE).
+         */
+        FMT_NODISCARD std::uint64_t Dropped(size_t logger) const;
+
+        /**
+         * @brief Gets the number of messages dropped so far for all the loggers.
+         *
+         * @return The number of dropped messages.
+         */
+        FMT_NODISCARD std::uint64_t Dropped() const;
 
     private:
+        /**
+         * @brief A queued message, with the time, thread, call site fields and context it was logged with (shared by
+         * the queues of all the loggers).
+         */
+        struct QueuedRecord {
+            Level level;
+            std::string clazz;
+            std::string message;
+            std::chrono::system_clock::time_point time;
+            std::string timestamp;
+            std::string threadId;
+            LogFormat::Attributes attributes;
+        };
+
+        /**
+         * @brief The queue and thread of a logger (Delivery::QUEUED only).
+         */
+        struct Queue {
+            std::mutex mutex;
+            std::condition_variable wakeUp;
+            std::condition_variable written;
+            std::deque<std::shared_ptr<const QueuedRecord>> records;
+
+            /**
+             * @brief The messages queued, and written, so far.
+             */
+            std::uint64_t enqueued = 0;
+            std::uint64_t done = 0;
+
+            std::atomic<std::uint64_t> dropped = 0;
+            bool stop = false;
+
+            LazyInit start;
+
+            /**
+             * @brief The thread writing to the logger (declared last, so everything it uses is initialized before
+             * and destroyed after it).
+             */
+            std::thread worker;
+        };
+
         std::vector<std::unique_ptr<LoggerBase>> m_loggers;
+        const Options m_options;
 
-        void Trace_Internal(const std::string_view msg) override {
-            for (const auto &logger: m_loggers) {
-                logger->Trace(msg);
-            }
-        }
-
-        void Debug_Internal(const std::string_view msg) override {
-            for (const auto &logger: m_loggers) {
-                logger->Debug(msg);
-            }
-        }
-
-        void Info_Internal(const std::string_view msg) override {
-            for (const auto &logger: m_loggers) {
-                logger->Info(msg);
-            }
-        }
-
-        void Warn_Internal(const std::string_view msg) override {
-            for (const auto &logger: m_loggers) {
-                logger->Warn(msg);
-            }
-        }
-
-        void Error_Internal(const std::string_view msg) override {
-            for (const auto &logger: m_loggers) {
-                logger->Error(msg);
-            }
-        }
-
-        void Fatal_Internal(const std::string_view msg) override {
-            for (const auto &logger: m_loggers) {
-                logger->Fatal(msg);
-            }
-        }
+        /**
+         * @brief The queue of each logger (empty with Delivery::INLINE).
+         */
+        std::vector<std::unique_ptr<Queue>> m_queues;
+
+        /**
+         * @brief Queues a record for the loggers that accept its level.
+         *
+         * @param record The record to queue.
+         */
+        void Enqueue(const Record &record);
+
+        /**
+         * @brief The body of the thread of a logger: writes the messages of its queue.
+         *
+         * @param index The index of the logger.
+         */
+        void Deliver(size_t index);
     };
 } // namespace slfmt
 
+#ifndef SLFMT_COMPILED_LIB
+    #include "CombinedLogger-inl.h"
+#endif
+
 #endif // SLFMT_COMBINED_LOGGER_H
@@ -0,0 +1,26 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * Config.h - Build configuration of slfmt
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_CONFIG_H
+#define SLFMT_CONFIG_H
+
+/*
+ * By default slfmt is header-only: the implementation files (*-inl.h) are included by the headers and their
+ * functions are inline. With SLFMT_COMPILED_LIB (the CMake option of the same name), the implementation files
+ * are only compiled once, into the slfmt library (see src/slfmt.cpp), and the headers only declare the functions.
+ */
+#ifdef SLFMT_COMPILED_LIB
+    #define SLFMT_INLINE
+#else
+    #define SLFMT_INLINE inline
+#endif
+
+#endif // SLFMT_CONFIG_H
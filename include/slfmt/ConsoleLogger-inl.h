@@ -0,0 +1,44 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * ConsoleLogger-inl.h - Implementation of the console logger
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_CONSOLE_LOGGER_INL_H
+#define SLFMT_CONSOLE_LOGGER_INL_H
+
+#include "ConsoleLogger.h"
+
+namespace slfmt {
+    SLFMT_INLINE ConsoleLogger::ConsoleLogger(const std::string_view &clazz) : LoggerBase(clazz) {}
+
+    SLFMT_INLINE ConsoleLogger::~ConsoleLogger() {
+        FlushRepeats();
+    }
+
+    SLFMT_INLINE void ConsoleLogger::Write(const Record &record) {
+        // The formatted line is printed as an argument: it may contain braces (e.g. JSON layouts).
+        auto &line = LogFormat::ThreadBuffer();
+        GetLayout().FormatTo(line, FORMAT_MAPPED_PARAMS_FOR_RECORD(record));
+        fmt::print(LevelColor(record.level), "{}", line);
+    }
+
+    SLFMT_INLINE fmt::text_style ConsoleLogger::LevelColor(const Level level) {
+        switch (level) {
+            case Level::TRACE: return color::TRACE_COLOR;
+            case Level::DEBUG: return color::DEBUG_COLOR;
+            case Level::INFO: return color::INFO_COLOR;
+            case Level::WARN: return color::WARN_COLOR;
+            case Level::ERROR: return color::ERROR_COLOR;
+            case Level::FATAL: return color::FATAL_COLOR;
+            default: return color::NO_COLOR;
+        }
+    }
+} // namespace slfmt
+
+#endif // SLFMT_CONSOLE_LOGGER_INL_H
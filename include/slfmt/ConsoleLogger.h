@@ -12,6 +12,8 @@
 #ifndef SLFMT_CONSOLE_LOGGER_H
 #define SLFMT_CONSOLE_LOGGER_H
 
+#include <slfmt/Config.h>
+#include <slfmt/LogFormat.h>
 #include <slfmt/LoggerBase.h>
 
 namespace slfmt {
@@ -25,38 +27,31 @@ namespace slfmt {
          *
          * @param clazz Class name.
          */
-        explicit ConsoleLogger(const std::string_view &clazz) : LoggerBase(clazz) {}
+        explicit ConsoleLogger(const std::string_view &clazz);
+
+        ~ConsoleLogger() override;
+
+        /**
+         * @brief Prints a record, in the color of its level.
+         *
+         * @param record The record to print.
+         */
+        void Write(const Record &record) override;
 
     private:
-        void Trace_Internal(const std::string_view msg) override {
-            Print(slfmt::color::TRACE_COLOR, FORMAT_MAPPED_PARAMS_FOR_LEVEL(TRACE_LEVEL_STRING));
-        }
-
-        void Debug_Internal(const std::string_view msg) override {
-            Print(slfmt::color::DEBUG_COLOR, FORMAT_MAPPED_PARAMS_FOR_LEVEL(DEBUG_LEVEL_STRING));
-        }
-
-        void Info_Internal(const std::string_view msg) override {
-            Print(slfmt::color::INFO_COLOR, FORMAT_MAPPED_PARAMS_FOR_LEVEL(INFO_LEVEL_STRING));
-        }
-
-        void Warn_Internal(const std::string_view msg) override {
-            Print(slfmt::color::WARN_COLOR, FORMAT_MAPPED_PARAMS_FOR_LEVEL(WARN_LEVEL_STRING));
-        }
-
-        void Error_Internal(const std::string_view msg) override {
-            Print(slfmt::color::ERROR_COLOR, FORMAT_MAPPED_PARAMS_FOR_LEVEL(ERROR_LEVEL_STRING));
-        }
-
-        void Fatal_Internal(const std::string_view msg) override {
-            Print(slfmt::color::FATAL_COLOR, FORMAT_MAPPED_PARAMS_FOR_LEVEL(FATAL_LEVEL_STRING));
-        }
-
-        static void Print(const fmt::text_style &color,
-                          const std::unordered_map<std::string_view, std::string_view> &format) {
-            fmt::print(color, fmt::runtime(LogFormat::Get().Format(format)));
-        }
+        /**
+         * @brief Gets the color the records of a level are printed in.
+         *
+         * @param level The level of the record.
+         *
+         * @return The text style of the level.
+         */
+        static fmt::text_style LevelColor(Level level);
     };
 } // namespace slfmt
 
+#ifndef SLFMT_COMPILED_LIB
+    #include "ConsoleLogger-inl.h"
+#endif
+
 #endif // SLFMT_CONSOLE_LOGGER_H
@@ -0,0 +1,177 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * Context.h - Diagnostic context of the current thread
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_CONTEXT_H
+#define SLFMT_CONTEXT_H
+
+#include <fmt/format.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Json.h"
+
+namespace slfmt {
+    /**
+     * @brief Key/value pairs attached to every message the current thread logs while they are set (e.g. the request
+     * and tenant being served), a mapped diagnostic context.
+     *
+     * @note Add the Context() element to the log format to write them. The context is rendered once when it
+     * changes, and the rendered text is reused for every message until the next change. Values are copied. A key
+     * pushed again hides its previous value until popped. Only the thread that formats a message sees its context:
+     * messages formatted on another thread do not get it, unless the record carries it there (queued combined
+     * loggers, NumaBufferedSink and ShmLogger do).
+     */
+    class Context {
+    public:
+        Context() = delete;
+
+        /**
+         * @brief Adds a key/value pair to the context of the current thread.
+         *
+         * @param key The key.
+         * @param value The value.
+         */
+        static void Push(const std::string_view key, const std::string_view value) {
+            auto &state = GetState();
+            state.entries.emplace_back(key, value);
+            state.rendered = false;
+        }
+
+        /**
+         * @brief Removes the last pair added to the context of the current thread (if any).
+         */
+        static void Pop() {
+            auto &state = GetState();
+
+            if (!state.entries.empty()) {
+                state.entries.pop_back();
+                state.rendered = false;
+            }
+        }
+
+        /**
+         * @brief Removes all the pairs of the context of the current thread.
+         */
+        static void Clear() {
+            auto &state = GetState();
+            state.entries.clear();
+            state.rendered = false;
+        }
+
+        /**
+         * @brief Gets the value of a key in the context of the current thread.
+         *
+         * @param key The key.
+         *
+         * @return The value (empty if the key is not set).
+         */
+        static std::string_view Get(const std::string_view key) {
+            const auto &entries = GetState().entries;
+
+            for (auto entry = entries.rbegin(); entry != entries.rend(); ++entry) {
+                if (entry->first == key) {
+                    return entry->second;
+                }
+            }
+
+            return {};
+        }
+
+        /**
+         * @brief Gets the context of the current thread as space-separated <code>key=value</code> pairs.
+         *
+         * @return The rendered context (empty if there is none).
+         */
+        static const std::string &Text() {
+            return Render().text;
+        }
+
+        /**
+         * @brief Gets the context of the current thread as JSON members (<code>"key":"value",...</code>).
+         *
+         * @return The rendered context (empty if there is none).
+         */
+        static const std::string &JsonMembers() {
+            return Render().json;
+        }
+
+        /**
+         * @brief Adds a key/value pair to the context of the current thread for the lifetime of the scope.
+         */
+        class Scope {
+        public:
+            Scope(const std::string_view key, const std::string_view value) {
+                Push(key, value);
+            }
+
+            ~Scope() {
+                Pop();
+            }
+
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+        };
+
+    private:
+        struct State {
+            std::vector<std::pair<std::string, std::string>> entries;
+            std::string text;
+            std::string json;
+
+            /**
+             * @brief Whether text and json are up to date with the entries.
+             */
+            bool rendered = true;
+        };
+
+        static State &GetState() {
+            thread_local State state;
+            return state;
+        }
+
+        static const State &Render() {
+            auto &state = GetState();
+
+            if (state.rendered) {
+                return state;
+            }
+
+            state.text.clear();
+            state.json.clear();
+
+            for (size_t i = 0; i < state.entries.size(); i++) {
+                const auto &[key, value] = state.entries[i];
+
+                // Hidden by a later pair with the same key.
+                if (Get(key).data() != value.data()) {
+                    continue;
+                }
+
+                if (!state.text.empty()) {
+                    state.text += ' ';
+                    state.json += ',';
+                }
+
+                fmt::format_to(std::back_inserter(state.text), "{}={}", key, value);
+                Json::Quote(state.json, key);
+                state.json += ':';
+                Json::Quote(state.json, value);
+            }
+
+            state.rendered = true;
+            return state;
+        }
+    };
+} // namespace slfmt
+
+#endif // SLFMT_CONTEXT_H
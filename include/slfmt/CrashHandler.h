@@ -0,0 +1,175 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * CrashHandler.h - Drains buffered log data when the program crashes
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_CRASH_HANDLER_H
+#define SLFMT_CRASH_HANDLER_H
+
+#include <array>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <exception>
+
+#ifndef _WIN32
+    #include <signal.h>
+#endif
+
+namespace slfmt {
+    /**
+     * @brief Optional handler for fatal signals (SIGSEGV, SIGABRT, SIGBUS, SIGFPE) and std::terminate that
+     * synchronously writes any buffered log data to its file before the program dies.
+     *
+     * @note Buffered writers register themselves here on construction. Draining only uses async-signal-safe
+     * operations (lock-free atomics and write(2)); once done, the previous handler is restored and the signal
+     * is raised again.
+     */
+    class CrashHandler {
+    public:
+        /**
+         * @brief Something holding log data in memory that must be written out on a crash.
+         */
+        class Drainable {
+        public:
+            virtual ~Drainable() = default;
+
+            /**
+             * @brief Writes the in-memory data to its destination.
+             *
+             * @note Called from signal handlers: implementations must be async-signal-safe.
+             */
+            virtual void DrainForCrash() noexcept = 0;
+        };
+
+        /**
+         * @brief The maximum number of drainables that can be registered at the same time.
+         */
+        static constexpr size_t MAX_DRAINABLES = 64;
+
+        CrashHandler() = delete;
+        ~CrashHandler() = delete;
+
+        /**
+         * @brief Installs the crash handler. Calling it more than once has no effect.
+         */
+        static void Install() {
+            if (s_installed.exchange(true)) {
+                return;
+            }
+
+            for (size_t i = 0; i < SIGNALS.size(); i++) {
+#ifdef _WIN32
+                s_previousHandlers[i] = std::signal(SIGNALS[i], OnSignal);
+#else
+                struct sigaction action {};
+
+                action.sa_handler = OnSignal;
+                sigemptyset(&action.sa_mask);
+                sigaction(SIGNALS[i], &action, &s_previousHandlers[i]);
+#endif
+            }
+
+            s_previousTerminate = std::set_terminate(OnTerminate);
+        }
+
+        /**
+         * @brief Registers a drainable to be drained on a crash.
+         *
+         * @param drainable The drainable to register.
+         *
+         * @return True if it was registered, false if there are already MAX_DRAINABLES registered.
+         */
+        static bool Register(Drainable *drainable) {
+            for (auto &slot: s_drainables) {
+                Drainable *expected = nullptr;
+
+                if (slot.compare_exchange_strong(expected, drainable)) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        /**
+         * @brief Unregisters a previously registered drainable.
+         *
+         * @param drainable The drainable to unregister.
+         */
+        static void Unregister(Drainable *drainable) {
+            for (auto &slot: s_drainables) {
+                Drainable *expected = drainable;
+
+                if (slot.compare_exchange_strong(expected, nullptr)) {
+                    return;
+                }
+            }
+        }
+
+        /**
+         * @brief Drains every registered drainable.
+         *
+         * @note Async-signal-safe.
+         */
+        static void DrainAll() noexcept {
+            for (auto &slot: s_drainables) {
+                if (auto *drainable = slot.load(std::memory_order_acquire); drainable != nullptr) {
+                    drainable->DrainForCrash();
+                }
+            }
+        }
+
+    private:
+#ifdef _WIN32
+        using SignalAction = void (*)(int);
+
+        static constexpr std::array<int, 3> SIGNALS = { SIGSEGV, SIGABRT, SIGFPE };
+#else
+        using SignalAction = struct sigaction;
+
+        static constexpr std::array<int, 4> SIGNALS = { SIGSEGV, SIGABRT, SIGBUS, SIGFPE };
+#endif
+
+        static inline std::array<std::atomic<Drainable *>, MAX_DRAINABLES> s_drainables{};
+        static inline std::array<SignalAction, SIGNALS.size()> s_previousHandlers{};
+        static inline std::terminate_handler s_previousTerminate = nullptr;
+        static inline std::atomic<bool> s_installed = false;
+
+        static void OnSignal(const int signal) {
+            DrainAll();
+
+            // Restore the handler that was installed before ours (usually the default one) and let it handle
+            // the signal, so the program still dies (and dumps core) as it would have without slfmt.
+            for (size_t i = 0; i < SIGNALS.size(); i++) {
+                if (SIGNALS[i] == signal) {
+#ifdef _WIN32
+                    std::signal(signal, s_previousHandlers[i]);
+#else
+                    sigaction(signal, &s_previousHandlers[i], nullptr);
+#endif
+                }
+            }
+
+            std::raise(signal);
+        }
+
+        static void OnTerminate() {
+            DrainAll();
+
+            if (s_previousTerminate != nullptr) {
+                s_previousTerminate();
+            }
+
+            std::abort();
+        }
+    };
+} // namespace slfmt
+
+#endif // SLFMT_CRASH_HANDLER_H
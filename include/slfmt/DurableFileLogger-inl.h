@@ -0,0 +1,201 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * DurableFileLogger-inl.h - Implementation of the durable file logger
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_DURABLE_FILE_LOGGER_INL_H
+#define SLFMT_DURABLE_FILE_LOGGER_INL_H
+
+#include <algorithm>
+#include <slfmt/LogFormat.h>
+#include <stdexcept>
+#include <vector>
+
+#include "DurableFileLogger.h"
+
+namespace slfmt {
+    SLFMT_INLINE DurableFileLogger::DurableFileLogger(const std::string_view &clazz, const std::string_view &file,
+                                                      const Options &options)
+        : LoggerBase(clazz), m_file(file), m_options(options) {}
+
+    SLFMT_INLINE DurableFileLogger::~DurableFileLogger() {
+        FlushRepeats();
+
+        {
+            const std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+
+        // The committer finishes the pending requests before exiting.
+        m_wakeUp.notify_all();
+
+        if (m_committer.joinable()) {
+            m_committer.join();
+        }
+
+        m_writer.Close();
+    }
+
+    SLFMT_INLINE void DurableFileLogger::WaitDurable(const Sequence sequence) {
+        if (DurableSequence() >= sequence) {
+            return;
+        }
+
+        StartCommitter();
+        std::unique_lock lock(m_mutex);
+        Request(sequence);
+
+        m_committed.wait(lock, [this, sequence] {
+            return DurableSequence() >= sequence || !m_error.empty();
+        });
+
+        if (DurableSequence() < sequence) {
+            lock.unlock();
+            ThrowError();
+        }
+    }
+
+    SLFMT_INLINE bool DurableFileLogger::WaitDurable(const Sequence sequence, const std::chrono::milliseconds timeout) {
+        if (DurableSequence() >= sequence) {
+            return true;
+        }
+
+        StartCommitter();
+        std::unique_lock lock(m_mutex);
+        Request(sequence);
+
+        m_committed.wait_for(lock, timeout, [this, sequence] {
+            return DurableSequence() >= sequence || !m_error.empty();
+        });
+
+        if (DurableSequence() < sequence && !m_error.empty()) {
+            lock.unlock();
+            ThrowError();
+        }
+
+        return DurableSequence() >= sequence;
+    }
+
+    SLFMT_INLINE void DurableFileLogger::WhenDurable(const Sequence sequence, std::function<void(bool)> callback) {
+        if (!AddCallback(sequence, std::move(callback))) {
+            callback(DurableSequence() >= sequence);
+        }
+    }
+
+    SLFMT_INLINE DurableFileLogger::Sequence DurableFileLogger::AppendMessage(const Record &record) {
+        m_open.Run([this] {
+            m_writer.Open(m_file);
+        });
+
+        auto &line = LogFormat::ThreadBuffer();
+        GetLayout().FormatTo(line, FORMAT_MAPPED_PARAMS_FOR_RECORD(record));
+
+        // The sequence number is taken with the record written, so a sync after it covers all the previous ones.
+        const std::lock_guard lock(m_appendMutex);
+        m_writer.Write(line);
+        return m_appended.fetch_add(1, std::memory_order_acq_rel) + 1;
+    }
+
+    SLFMT_INLINE void DurableFileLogger::Request(const Sequence sequence) {
+        if (sequence > LastSequence()) {
+            throw std::runtime_error(fmt::format("Record {} has not been written yet.", sequence));
+        }
+
+        if (sequence > m_requested) {
+            m_requested = sequence;
+            m_wakeUp.notify_one();
+        }
+    }
+
+    SLFMT_INLINE bool DurableFileLogger::AddCallback(const Sequence sequence, std::function<void(bool)> &&callback) {
+        if (DurableSequence() >= sequence) {
+            return false;
+        }
+
+        StartCommitter();
+        const std::lock_guard lock(m_mutex);
+
+        if (DurableSequence() >= sequence || !m_error.empty()) {
+            return false;
+        }
+
+        Request(sequence);
+        m_callbacks.emplace(sequence, std::move(callback));
+        return true;
+    }
+
+    SLFMT_INLINE void DurableFileLogger::StartCommitter() {
+        m_start.Run([this] {
+            m_committer = std::thread(&DurableFileLogger::Run, this);
+        });
+    }
+
+    SLFMT_INLINE void DurableFileLogger::ThrowError() {
+        const std::lock_guard lock(m_mutex);
+        throw std::runtime_error(m_error.empty() ? "The log record is not durable." : m_error);
+    }
+
+    SLFMT_INLINE void DurableFileLogger::Run() {
+        std::unique_lock lock(m_mutex);
+
+        while (true) {
+            m_wakeUp.wait(lock, [this] {
+                return m_stop || m_requested > DurableSequence();
+            });
+
+            if (!m_error.empty() || m_requested <= DurableSequence()) {
+                return; // Stopped, and nothing left to commit.
+            }
+
+            lock.unlock();
+
+            if (m_options.commitDelay.count() > 0) {
+                std::this_thread::sleep_for(m_options.commitDelay);
+            }
+
+            // Everything written until now is covered by the sync, whoever waits for it.
+            const auto target = LastSequence();
+            std::string error;
+
+            try {
+                m_writer.Sync();
+            } catch (const std::exception &e) {
+                error = e.what();
+            }
+
+            m_commits.fetch_add(1, std::memory_order_relaxed);
+            lock.lock();
+
+            if (error.empty()) {
+                m_durable.store(target, std::memory_order_release);
+            } else {
+                m_error = error;
+            }
+
+            const auto last = error.empty() ? m_callbacks.upper_bound(target) : m_callbacks.end();
+            std::vector<std::function<void(bool)>> ready;
+
+            for (auto it = m_callbacks.begin(); it != last; ++it) {
+                ready.push_back(std::move(it->second));
+            }
+
+            m_callbacks.erase(m_callbacks.begin(), last);
+            lock.unlock();
+            m_committed.notify_all();
+
+            for (const auto &callback: ready) {
+                callback(error.empty());
+            }
+
+            lock.lock();
+        }
+    }
+} // namespace slfmt
+
+#endif // SLFMT_DURABLE_FILE_LOGGER_INL_H
@@ -0,0 +1,327 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * DurableFileLogger.h - File logger that reports when its messages are on disk
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_DURABLE_FILE_LOGGER_H
+#define SLFMT_DURABLE_FILE_LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <slfmt/Config.h>
+#include <slfmt/FileWriter.h>
+#include <slfmt/LazyInit.h>
+#include <slfmt/LoggerBase.h>
+#include <string>
+#include <thread>
+
+// The awaitable needs coroutine support (GCC 10 only enables it with -fcoroutines, which the CMake target adds).
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+    #include <coroutine>
+    #define SLFMT_HAS_COROUTINES
+#endif
+
+namespace slfmt {
+    /**
+     * @brief File logger for records that must be on disk before the program goes on (e.g. audit logs).
+     *
+     * @note Every record appended with Append() gets a sequence number, and WaitDurable() (or WhenDurable(), or
+     * <code>co_await AwaitDurable()</code>) waits until it is stored on the disk. Instead of syncing the file for
+     * every record, a background committer syncs it once (<code>fdatasync</code>) for all the records appended
+     * so far whenever someone is waiting, so concurrent waiters share the cost of a single sync (group commit).
+     * Records are written unbuffered and in sequence order. Messages logged with the usual methods (Info(), ...)
+     * are sequenced too: LastSequence() covers them.
+     */
+    class DurableFileLogger : public LoggerBase {
+    public:
+        /**
+         * @brief The sequence number of a record: 1 for the first one, and so on (0 means no record).
+         */
+        using Sequence = std::uint64_t;
+
+        /**
+         * @brief Options of the durable file logger.
+         */
+        struct Options {
+            /**
+             * @brief How long the committer waits before each sync, to gather the records (and waiters) arriving
+             * meanwhile. Trades latency for fewer syncs under load.
+             */
+            std::chrono::microseconds commitDelay{ 0 };
+        };
+
+#ifdef SLFMT_HAS_COROUTINES
+        /**
+         * @brief Waits, in a coroutine, until a record is durable (see AwaitDurable()).
+         */
+        class Awaiter {
+        public:
+            Awaiter(DurableFileLogger &logger, const Sequence sequence) : m_logger(logger), m_sequence(sequence) {}
+
+            FMT_NODISCARD bool await_ready() const {
+                return m_logger.DurableSequence() >= m_sequence;
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                // Resumed by the committer thread, unless the record is already durable (or can never be).
+                return m_logger.AddCallback(m_sequence, [this, handle](const bool durable) {
+                    m_durable = durable;
+                    handle.resume();
+                });
+            }
+
+            void await_resume() const {
+                if (!m_durable || m_logger.DurableSequence() < m_sequence) {
+                    m_logger.ThrowError();
+                }
+            }
+
+        private:
+            DurableFileLogger &m_logger;
+            const Sequence m_sequence;
+            bool m_durable = true;
+        };
+#endif
+
+        /**
+         * @brief Constructs a new logger for the specified class and file, with the default options.
+         *
+         * @param clazz The class to create a logger for.
+         * @param file The file to log to.
+         */
+        DurableFileLogger(const std::string_view &clazz, const std::string_view &file)
+            : DurableFileLogger(clazz, file, Options{}) {}
+
+        /**
+         * @brief Constructs a new logger for the specified class and file.
+         *
+         * @note Neither the file is opened nor the committer started until they are needed.
+         *
+         * @param clazz The class to create a logger for.
+         * @param file The file to log to.
+         * @param options The options of the logger.
+         */
+        DurableFileLogger(const std::string_view &clazz, const std::string_view &file, const Options &options);
+
+        ~DurableFileLogger() override;
+
+        /**
+         * @brief Appends a record at the specified level.
+         *
+         * @tparam Args The types of the arguments to format the message with.
+         * @param level The level of the record.
+         * @param format The format string.
+         * @param args The arguments to format the message with.
+         *
+         * @return The sequence number of the record, or 0 if the level is not enabled (nothing was written).
+         */
+        template<typename... Args>
+        Sequence Append(const Level &level, const std::string_view format, Args &&...args) {
+            if (!IsEnabled(level)) {
+                return 0;
+            }
+
+            const auto msg = fmt::vformat(format, fmt::make_format_args(args...));
+            return AppendMessage({ level, GetClass(), msg });
+        }
+
+        /**
+         * @brief Gets the sequence number of the last record written.
+         *
+         * @return The last sequence number (0 if nothing was written yet).
+         */
+        FMT_NODISCARD Sequence LastSequence() const {
+            return m_appended.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Gets the sequence number up to which the records are known to be on disk.
+         *
+         * @return The last durable sequence number.
+         */
+        FMT_NODISCARD Sequence DurableSequence() const {
+            return m_durable.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Gets the number of times the file was synced (each sync makes all the previous records durable).
+         *
+         * @return The number of syncs.
+         */
+        FMT_NODISCARD std::uint64_t Commits() const {
+            return m_commits.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Blocks until the record (and all the previous ones) is on disk.
+         *
+         * @note Throws std::runtime_error if the record was not written yet, or if the file could not be synced.
+         *
+         * @param sequence The sequence number of the record.
+         */
+        void WaitDurable(Sequence sequence);
+
+        /**
+         * @brief Blocks until the record (and all the previous ones) is on disk, or the timeout expires.
+         *
+         * @note Throws std::runtime_error if the record was not written yet, or if the file could not be synced.
+         *
+         * @param sequence The sequence number of the record.
+         * @param timeout The maximum time to wait.
+         *
+         * @return True if the record is durable.
+         */
+        bool WaitDurable(Sequence sequence, std::chrono::milliseconds timeout);
+
+        /**
+         * @brief Calls a function when the record (and all the previous ones) is on disk.
+         *
+         * @note The function is called by the committer thread (or right away, if the record is already durable)
+         * and must not block it. It receives false if the file could not be synced.
+         *
+         * @param sequence The sequence number of the record.
+         * @param callback The function to call.
+         */
+        void WhenDurable(Sequence sequence, std::function<void(bool)> callback);
+
+        /**
+         * @brief Writes a record, sequenced like the appended ones.
+         *
+         * @param record The record to write.
+         */
+        void Write(const Record &record) override {
+            AppendMessage(record);
+        }
+
+#ifdef SLFMT_HAS_COROUTINES
+        /**
+         * @brief Waits, in a coroutine, until the record (and all the previous ones) is on disk:
+         * <code>co_await logger.AwaitDurable(sequence);</code>
+         *
+         * @note The coroutine is resumed by the committer thread. Resuming throws std::runtime_error if the file
+         * could not be synced.
+         *
+         * @param sequence The sequence number of the record.
+         *
+         * @return The awaitable.
+         */
+        FMT_NODISCARD Awaiter AwaitDurable(const Sequence sequence) {
+            return { *this, sequence };
+        }
+#endif
+
+    private:
+        const std::string m_file;
+        const Options m_options;
+
+        /**
+         * @brief Opens the file when the first message is logged.
+         */
+        LazyInit m_open;
+
+        /**
+         * @brief The writer for the file (unbuffered).
+         */
+        FileWriter m_writer;
+
+        /**
+         * @brief Serializes the writes, so the records are in the file in sequence order.
+         */
+        std::mutex m_appendMutex;
+
+        std::atomic<Sequence> m_appended = 0;
+        std::atomic<Sequence> m_durable = 0;
+        std::atomic<std::uint64_t> m_commits = 0;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wakeUp;
+        std::condition_variable m_committed;
+
+        /**
+         * @brief The highest sequence number someone is waiting for.
+         */
+        Sequence m_requested = 0;
+
+        /**
+         * @brief The functions waiting for their records to be durable.
+         */
+        std::multimap<Sequence, std::function<void(bool)>> m_callbacks;
+
+        /**
+         * @brief The error of the sync that failed (empty if none). Once a sync fails, no record becomes durable.
+         */
+        std::string m_error;
+
+        bool m_stop = false;
+
+        /**
+         * @brief Starts the committer thread when someone first waits.
+         */
+        LazyInit m_start;
+
+        /**
+         * @brief The committer thread (declared last, so everything it uses is initialized before and destroyed
+         * after it).
+         */
+        std::thread m_committer;
+
+        /**
+         * @brief Formats and writes a record.
+         *
+         * @param record The record to write.
+         *
+         * @return The sequence number of the record.
+         */
+        Sequence AppendMessage(const Record &record);
+
+        /**
+         * @brief Asks the committer to make a record durable (with the mutex locked).
+         *
+         * @param sequence The sequence number of the record.
+         */
+        void Request(Sequence sequence);
+
+        /**
+         * @brief Registers a function to call when a record is durable.
+         *
+         * @param sequence The sequence number of the record.
+         * @param callback The function to call.
+         *
+         * @return False if the function was not registered, because the record is already durable or the file
+         * cannot be synced.
+         */
+        bool AddCallback(Sequence sequence, std::function<void(bool)> &&callback);
+
+        /**
+         * @brief Starts the committer thread (if not running).
+         */
+        void StartCommitter();
+
+        /**
+         * @brief Throws the error of the failed sync.
+         */
+        [[noreturn]] void ThrowError();
+
+        /**
+         * @brief The body of the committer thread: syncs the file while someone waits for a record.
+         */
+        void Run();
+    };
+} // namespace slfmt
+
+#ifndef SLFMT_COMPILED_LIB
+    #include "DurableFileLogger-inl.h"
+#endif
+
+#endif // SLFMT_DURABLE_FILE_LOGGER_H
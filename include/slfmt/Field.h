@@ -0,0 +1,195 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * Field.h - Typed key/value fields attached to log messages
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_FIELD_H
+#define SLFMT_FIELD_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fmt/format.h>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+
+#include "Json.h"
+
+namespace slfmt {
+    /**
+     * @brief A typed key/value pair attached to a log message at the call site.
+     *
+     * @note String values are <b>not</b> copied; they must outlive the logging call (which is always the
+     * case for temporaries created in the call expression itself).
+     */
+    class Field {
+    public:
+        using Value = std::variant<std::string_view, std::int64_t, std::uint64_t, double, bool>;
+
+        /**
+         * @brief Constructs an empty field (the unused slots of Fields).
+         */
+        Field() = default;
+
+        /**
+         * @brief Constructs a new field.
+         *
+         * @tparam T The type of the value (string-like, integral, floating point or bool).
+         * @param key The key of the field.
+         * @param value The value of the field.
+         */
+        template<typename T>
+        Field(const std::string_view key, const T &value) : m_key(key), m_value(ToValue(value)) {}
+
+        FMT_NODISCARD std::string_view Key() const { return m_key; }
+
+        FMT_NODISCARD const Value &GetValue() const { return m_value; }
+
+        /**
+         * @brief Appends the field as a JSON member (<code>"key":value</code>).
+         *
+         * @param out The string to append to.
+         */
+        void AppendJson(std::string &out) const {
+            Json::Quote(out, m_key);
+            out += ':';
+
+            std::visit(
+                    [&out](const auto &value) {
+                        using V = std::decay_t<decltype(value)>;
+
+                        if constexpr (std::is_same_v<V, std::string_view>) {
+                            Json::Quote(out, value);
+                        } else if constexpr (std::is_same_v<V, bool>) {
+                            out += value ? "true" : "false";
+                        } else if constexpr (std::is_same_v<V, double>) {
+                            // JSON has no representation for NaN or infinity.
+                            if (std::isfinite(value)) {
+                                fmt::format_to(std::back_inserter(out), "{}", value);
+                            } else {
+                                out += "null";
+                            }
+                        } else {
+                            fmt::format_to(std::back_inserter(out), "{}", value);
+                        }
+                    },
+                    m_value);
+        }
+
+        /**
+         * @brief Appends the field as plain text (<code>key=value</code>).
+         *
+         * @param out The string to append to.
+         */
+        void AppendText(std::string &out) const {
+            out += m_key;
+            out += '=';
+
+            std::visit(
+                    [&out](const auto &value) {
+                        fmt::format_to(std::back_inserter(out), "{}", value);
+                    },
+                    m_value);
+        }
+
+    private:
+        std::string_view m_key{};
+        Value m_value{};
+
+        template<typename T>
+        static Value ToValue(const T &value) {
+            if constexpr (std::is_same_v<T, bool>) {
+                return value;
+            } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+                return static_cast<std::int64_t>(value);
+            } else if constexpr (std::is_integral_v<T>) {
+                return static_cast<std::uint64_t>(value);
+            } else if constexpr (std::is_floating_point_v<T>) {
+                return static_cast<double>(value);
+            } else {
+                static_assert(std::is_convertible_v<const T &, std::string_view>,
+                              "Field values must be strings, integers, floating point numbers or booleans.");
+                return std::string_view(value);
+            }
+        }
+    };
+
+    /**
+     * @brief A list of fields passed to a logging call.
+     *
+     * @note The fields are copied into the list (without allocating), so a named list stays valid after the
+     * expression that created it; their string values are not. While a call is being logged, its fields are
+     * published through a thread-local pointer so the layout can render them (see Scope and Current()).
+     */
+    class Fields {
+    public:
+        /**
+         * @brief The maximum number of fields of a list.
+         */
+        static constexpr size_t MAX_FIELDS = 16;
+
+        /**
+         * @brief Constructs a list of fields.
+         *
+         * @note Throws std::runtime_error if there are more than MAX_FIELDS fields.
+         *
+         * @param fields The fields.
+         */
+        Fields(const std::initializer_list<Field> fields) : m_size(fields.size()) {
+            if (fields.size() > MAX_FIELDS) {
+                throw std::runtime_error("Too many fields in a log message.");
+            }
+
+            std::copy(fields.begin(), fields.end(), m_fields.begin());
+        }
+
+        FMT_NODISCARD auto begin() const { return m_fields.begin(); }
+
+        FMT_NODISCARD auto end() const { return m_fields.begin() + static_cast<std::ptrdiff_t>(m_size); }
+
+        FMT_NODISCARD bool Empty() const { return m_size == 0; }
+
+        /**
+         * @brief Gets the fields of the message being logged by the current thread.
+         *
+         * @return The current fields, or nullptr if the message has none.
+         */
+        static const Fields *Current() { return s_current; }
+
+        /**
+         * @brief Publishes a list of fields as the current ones for the lifetime of the scope.
+         */
+        class Scope {
+        public:
+            explicit Scope(const Fields &fields) : m_previous(s_current) { s_current = &fields; }
+
+            ~Scope() { s_current = m_previous; }
+
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+        private:
+            const Fields *m_previous;
+        };
+
+    private:
+        std::array<Field, MAX_FIELDS> m_fields{};
+        size_t m_size;
+
+        static inline thread_local const Fields *s_current = nullptr;
+    };
+} // namespace slfmt
+
+#endif // SLFMT_FIELD_H
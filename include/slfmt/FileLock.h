@@ -0,0 +1,89 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * FileLock.h - Advisory inter-process lock on a file
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_FILE_LOCK_H
+#define SLFMT_FILE_LOCK_H
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <sys/locking.h>
+    #include <sys/stat.h>
+#else
+    #include <sys/file.h>
+    #include <unistd.h>
+#endif
+
+namespace slfmt {
+    /**
+     * @brief Holds an exclusive advisory lock on a file for as long as the object lives.
+     *
+     * @note The lock is shared by all the processes that lock the same file (<code>flock</code> on POSIX systems),
+     * so it can be used to coordinate work between several processes, e.g. rolling over a log file they all write
+     * to. It is advisory: it does not prevent writing to the file, only other lock attempts.
+     */
+    class FileLock {
+    public:
+        /**
+         * @brief Locks the specified file, waiting until no other process holds the lock.
+         *
+         * @param file The lock file (created if it does not exist).
+         */
+        explicit FileLock(const std::string &file) {
+#ifdef _WIN32
+            m_fd = _open(file.c_str(), _O_RDWR | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+            m_fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+#endif
+
+            if (m_fd < 0) {
+                throw std::runtime_error(fmt::format("Failed to open lock file {}: {}", file, std::strerror(errno)));
+            }
+
+#ifdef _WIN32
+            // _LK_LOCK gives up after 10 attempts, one second apart.
+            while (_locking(m_fd, _LK_LOCK, 1) != 0) {}
+#else
+            while (::flock(m_fd, LOCK_EX) != 0) {
+                if (errno != EINTR) {
+                    const int error = errno;
+                    ::close(m_fd);
+                    throw std::runtime_error(fmt::format("Failed to lock file {}: {}", file, std::strerror(error)));
+                }
+            }
+#endif
+        }
+
+        FileLock(const FileLock &) = delete;
+        FileLock &operator=(const FileLock &) = delete;
+
+        ~FileLock() {
+#ifdef _WIN32
+            _locking(m_fd, _LK_UNLCK, 1);
+            _close(m_fd);
+#else
+            // Closing the descriptor releases the lock.
+            ::close(m_fd);
+#endif
+        }
+
+    private:
+        int m_fd = -1;
+    };
+} // namespace slfmt
+
+#endif // SLFMT_FILE_LOCK_H
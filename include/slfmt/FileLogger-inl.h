@@ -0,0 +1,71 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * FileLogger-inl.h - Implementation of the file logger
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_FILE_LOGGER_INL_H
+#define SLFMT_FILE_LOGGER_INL_H
+
+#include "FileLogger.h"
+
+namespace slfmt {
+    SLFMT_INLINE FileLogger::FileLogger(const std::string_view &clazz, const std::string_view &file,
+                                        const size_t bufferSize)
+        : LoggerBase(clazz), m_file(file), m_writer(bufferSize) {}
+
+    SLFMT_INLINE FileLogger::~FileLogger() {
+        FlushRepeats();
+        m_writer.Close(); // Flush the pending messages before closing the file.
+    }
+
+    SLFMT_INLINE void FileLogger::Flush() {
+        m_writer.Flush();
+    }
+
+    SLFMT_INLINE void FileLogger::Write(const Record &record) {
+        WriteAndFlushStream(FORMAT_MAPPED_PARAMS_FOR_RECORD(record));
+
+        if (record.level >= Level::ERROR) {
+            m_writer.Flush();
+        }
+    }
+
+    SLFMT_INLINE void FileLogger::WriteBatch(const std::string_view clazz, const LogBatch &batch) {
+        m_open.Run([this] {
+            m_writer.Open(m_file);
+        });
+
+        const auto lines = FormatBatch(clazz, batch);
+
+        if (lines.empty()) {
+            return;
+        }
+
+        m_writer.Write(lines);
+
+        if (batch.GetMaxLevel() >= Level::ERROR) {
+            m_writer.Flush();
+        }
+    }
+
+    SLFMT_INLINE void FileLogger::WriteAndFlushStream(
+            const std::unordered_map<std::string_view, std::string_view> &format_map) {
+        m_open.Run([this] {
+            m_writer.Open(m_file);
+        });
+
+        // Rendered into the buffer of the thread and written with a single call: concurrent messages are never
+        // interleaved, and unbuffered loggers take no lock.
+        auto &line = LogFormat::ThreadBuffer();
+        GetLayout().FormatTo(line, format_map);
+        m_writer.Write(line);
+    }
+} // namespace slfmt
+
+#endif // SLFMT_FILE_LOGGER_INL_H
@@ -12,12 +12,18 @@
 #ifndef SLFMT_FILE_LOGGER_H
 #define SLFMT_FILE_LOGGER_H
 
-#include <fstream>
+#include <slfmt/Config.h>
+#include <slfmt/FileWriter.h>
+#include <slfmt/LazyInit.h>
+#include <slfmt/LogFormat.h>
 #include <slfmt/LoggerBase.h>
 
 namespace slfmt {
     /**
      * @brief File logger for slfmt.
+     *
+     * @note The logger can be used from several threads at once: each message is written to the file with a single
+     * <code>write</code> call.
      */
     class FileLogger : public LoggerBase {
     public:
@@ -26,61 +32,70 @@ namespace slfmt {
          *
          * @param clazz The class to create a logger for.
          * @param file The file to log to.
+         * @param bufferSize The size (in bytes) of the in-memory buffer, or 0 to write each message immediately.
+         *
+         * @note A buffered logger writes its messages when the buffer is full, when an ERROR or FATAL message is
+         * logged, on Flush() and on destruction. Install the CrashHandler to also write them if the program crashes.
+         * The file is not opened (nor created) until the first message is logged.
          */
-        FileLogger(const std::string_view &clazz, const std::string_view &file)
-            : LoggerBase(clazz), m_stream(file.data(), std::ios::out | std::ios::app) {}
+        FileLogger(const std::string_view &clazz, const std::string_view &file, size_t bufferSize = 0);
 
-        ~FileLogger() override {
-            m_stream.flush(); // Flush the stream before closing the file.
-            m_stream.close();
-        }
+        ~FileLogger() override;
 
-    private:
         /**
-         * @brief The output stream for the file to log to.
-         *
-         * @note the mode <b>std::ios::app (seek to end before each write)</b> allows having
-         * multiple instances of loggers, writing to the same file <b>without</b> overwriting each other.
+         * @brief Writes the buffered messages (if any) to the file.
          */
-        std::ofstream m_stream;
+        void Flush();
 
-        void Trace_Internal(std::string_view msg) override {
-            WriteAndFlushStream(FORMAT_MAPPED_PARAMS_FOR_LEVEL(TRACE_LEVEL_STRING));
-        }
-
-        void Debug_Internal(std::string_view msg) override {
-            WriteAndFlushStream(FORMAT_MAPPED_PARAMS_FOR_LEVEL(DEBUG_LEVEL_STRING));
-        }
+        /**
+         * @brief Writes a record to the file (and the buffered ones, for ERROR and FATAL records).
+         *
+         * @param record The record to write.
+         */
+        void Write(const Record &record) override;
 
-        void Info_Internal(std::string_view msg) override {
-            WriteAndFlushStream(FORMAT_MAPPED_PARAMS_FOR_LEVEL(INFO_LEVEL_STRING));
-        }
+        /**
+         * @brief Writes the records of a batch to the file with a single call.
+         *
+         * @param clazz The class of the records.
+         * @param batch The records to write.
+         */
+        void WriteBatch(std::string_view clazz, const LogBatch &batch) override;
 
-        void Warn_Internal(std::string_view msg) override {
-            WriteAndFlushStream(FORMAT_MAPPED_PARAMS_FOR_LEVEL(WARN_LEVEL_STRING));
-        }
+    private:
+        /**
+         * @brief The file path to log to.
+         */
+        const std::string m_file;
 
-        void Error_Internal(std::string_view msg) override {
-            WriteAndFlushStream(FORMAT_MAPPED_PARAMS_FOR_LEVEL(ERROR_LEVEL_STRING));
-        }
+        /**
+         * @brief Opens the file when the first message is logged.
+         */
+        LazyInit m_open;
 
-        void Fatal_Internal(std::string_view msg) override {
-            WriteAndFlushStream(FORMAT_MAPPED_PARAMS_FOR_LEVEL(FATAL_LEVEL_STRING));
-        }
+        /**
+         * @brief The writer for the file to log to.
+         *
+         * @note The file is opened in append mode (every write goes to the end of the file), which allows having
+         * multiple instances of loggers writing to the same file <b>without</b> overwriting each other.
+         */
+        FileWriter m_writer;
 
         /**
-         * @brief Writes the specified message to the file and flushes the stream.
+         * @brief Writes the specified message to the file.
          *
-         * @note When flushing the stream, the message is written to the file immediately. So, if the program
-         * crashes, the message will be written to the file before the crash.
+         * @note When the logger is not buffered, the message is written to the file immediately. So, if the
+         * program crashes, the message will be written to the file before the crash. Buffered messages rely
+         * on the CrashHandler instead.
          *
          * @param format_map The format map to write.
          */
-        void WriteAndFlushStream(const std::unordered_map<std::string_view, std::string_view> &format_map) {
-            const auto msg = LogFormat::Get().Format(format_map);
-            m_stream.write(msg.data(), static_cast<std::streamsize>(msg.size())).flush();
-        }
+        void WriteAndFlushStream(const std::unordered_map<std::string_view, std::string_view> &format_map);
     };
 } // namespace slfmt
 
+#ifndef SLFMT_COMPILED_LIB
+    #include "FileLogger-inl.h"
+#endif
+
 #endif // SLFMT_FILE_LOGGER_H
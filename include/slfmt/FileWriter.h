@@ -0,0 +1,340 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * FileWriter.h - Appending writer over a raw file descriptor
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_FILE_WRITER_H
+#define SLFMT_FILE_WRITER_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+#include "CrashHandler.h"
+
+namespace slfmt {
+    /**
+     * @brief Writes data at the end of a file through a raw file descriptor opened in append mode.
+     *
+     * @note The writer can either be unbuffered (every Write() goes straight to the file, so it survives
+     * a crash of the program) or buffered (data is kept in memory until the buffer is full or Flush() is
+     * called). Buffered writers register themselves in the CrashHandler, which writes out the pending data
+     * if the program crashes (once CrashHandler::Install() has been called). When CrashHandler::MAX_DRAINABLES
+     * writers are already registered, a new writer is unbuffered instead (see IsBuffered()).
+     */
+    class FileWriter : public CrashHandler::Drainable {
+    public:
+        /**
+         * @brief Creates a writer without a file. Open() must be called before writing.
+         *
+         * @param bufferSize The size (in bytes) of the in-memory buffer, or 0 to write every call through.
+         */
+        explicit FileWriter(const size_t bufferSize = 0)
+            : m_buffer(bufferSize > 0 ? std::make_unique<char[]>(bufferSize) : nullptr), m_capacity(bufferSize) {
+            // Data left in a buffer the crash handler does not know about would be lost on a crash.
+            if (m_capacity > 0 && !CrashHandler::Register(this)) {
+                m_buffer.reset();
+                m_capacity = 0;
+            }
+        }
+
+        /**
+         * @brief Opens the specified file for appending.
+         *
+         * @param file The file to write to (created if it does not exist).
+         * @param bufferSize The size (in bytes) of the in-memory buffer, or 0 to write every call through.
+         */
+        explicit FileWriter(const std::string &file, const size_t bufferSize = 0) : FileWriter(bufferSize) {
+            Open(file);
+        }
+
+        FileWriter(const FileWriter &) = delete;
+        FileWriter &operator=(const FileWriter &) = delete;
+
+        ~FileWriter() override {
+            if (m_capacity > 0) {
+                CrashHandler::Unregister(this);
+            }
+
+            Close();
+        }
+
+        /**
+         * @brief Opens the specified file for appending (closing the current one, if any).
+         *
+         * @param file The file to write to (created if it does not exist).
+         */
+        void Open(const std::string &file) {
+            Close();
+
+#ifdef _WIN32
+            const int fd = _open(file.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+            const int fd = ::open(file.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+
+            if (fd < 0) {
+                throw std::runtime_error(fmt::format("Failed to open log file {}: {}", file, std::strerror(errno)));
+            }
+
+            m_fd.store(fd, std::memory_order_release);
+        }
+
+        /**
+         * @brief Flushes the pending data and closes the file.
+         */
+        void Close() {
+            const int fd = m_fd.load(std::memory_order_acquire);
+
+            if (fd < 0) {
+                return;
+            }
+
+            Flush();
+            m_fd.store(-1, std::memory_order_release);
+
+#ifdef _WIN32
+            _close(fd);
+#else
+            ::close(fd);
+#endif
+        }
+
+        /**
+         * @brief Writes data at the end of the file (or into the buffer, if the writer is buffered).
+         *
+         * @note The data reaches the file in a single <code>write</code> call (buffers are only flushed between
+         * calls), so the records of writers appending to the same file from other threads or processes are never
+         * interleaved with it. Unbuffered writes take no lock; buffered ones lock the buffer, so both are safe to
+         * call from several threads (while the file is not being reopened or closed).
+         *
+         * @param data The data to write.
+         */
+        void Write(const std::string_view data) {
+            if (m_capacity == 0) {
+                WriteFully(m_fd.load(std::memory_order_relaxed), data.data(), data.size());
+                return;
+            }
+
+            const std::lock_guard lock(m_bufferMutex);
+            const size_t size = m_size.load(std::memory_order_relaxed);
+
+            if (size + data.size() > m_capacity) {
+                FlushBuffer();
+
+                // Data that would not fit in an empty buffer is written directly.
+                if (data.size() >= m_capacity) {
+                    WriteFully(m_fd.load(std::memory_order_relaxed), data.data(), data.size());
+                    return;
+                }
+            }
+
+            const size_t offset = m_size.load(std::memory_order_relaxed);
+            std::memcpy(m_buffer.get() + offset, data.data(), data.size());
+
+            // Publish the new size only once the data is in place, so a crash drain never writes partial data.
+            m_size.store(offset + data.size(), std::memory_order_release);
+        }
+
+        /**
+         * @brief Writes the buffered data to the file.
+         */
+        void Flush() {
+            if (m_capacity == 0) {
+                return;
+            }
+
+            const std::lock_guard lock(m_bufferMutex);
+            FlushBuffer();
+        }
+
+        /**
+         * @brief Writes the buffered data and waits until the data of the file is stored on the disk
+         * (<code>fdatasync</code>).
+         *
+         * @note Throws if the data could not be stored, or if a write failed since the previous call.
+         */
+        void Sync() {
+            Flush();
+
+            const int fd = m_fd.load(std::memory_order_acquire);
+
+            if (fd < 0) {
+                return;
+            }
+
+            // Data that never reached the file cannot be made durable.
+            if (const int error = m_writeError.exchange(0, std::memory_order_relaxed); error != 0) {
+                throw std::runtime_error(fmt::format("Failed to write log file: {}", std::strerror(error)));
+            }
+
+#if defined(_WIN32)
+            const bool synced = _commit(fd) == 0;
+#elif defined(__APPLE__)
+            const bool synced = ::fsync(fd) == 0; // No fdatasync on macOS.
+#else
+            const bool synced = ::fdatasync(fd) == 0;
+#endif
+
+            if (!synced) {
+                throw std::runtime_error(fmt::format("Failed to sync log file: {}", std::strerror(errno)));
+            }
+        }
+
+        /**
+         * @brief Checks if the writer has a file open.
+         *
+         * @return True if the file is open.
+         */
+        FMT_NODISCARD bool IsOpen() const { return m_fd.load(std::memory_order_acquire) >= 0; }
+
+        /**
+         * @brief Checks if the writer keeps data in memory.
+         *
+         * @return True if the writer is buffered.
+         */
+        FMT_NODISCARD bool IsBuffered() const { return m_capacity > 0; }
+
+        /**
+         * @brief Gets the current size of the open file (including what other writers appended to it).
+         *
+         * @return The size (in bytes) of the file, or 0 if it is not open.
+         */
+        FMT_NODISCARD std::uint64_t FileSize() const {
+#ifdef _WIN32
+            struct _stat64 info{};
+            const bool ok = _fstat64(m_fd.load(std::memory_order_relaxed), &info) == 0;
+#else
+            struct stat info{};
+            const bool ok = ::fstat(m_fd.load(std::memory_order_relaxed), &info) == 0;
+#endif
+
+            return ok ? static_cast<std::uint64_t>(info.st_size) : 0;
+        }
+
+        /**
+         * @brief Checks if the open file is no longer the one at the specified path, i.e. it has been renamed or
+         * deleted (by another process rolling it over, for instance) and the writer should reopen the path.
+         *
+         * @note Compares the device and inode of the open file with those of the path (always false on Windows,
+         * where open files cannot be renamed).
+         *
+         * @param file The path the writer opened.
+         *
+         * @return True if the path no longer refers to the open file.
+         */
+        FMT_NODISCARD bool IsReplaced(const std::string &file) const {
+#ifdef _WIN32
+            return false;
+#else
+            struct stat opened{};
+            struct stat current{};
+
+            if (::fstat(m_fd.load(std::memory_order_relaxed), &opened) != 0) {
+                return false;
+            }
+
+            return ::stat(file.c_str(), &current) != 0 || current.st_ino != opened.st_ino ||
+                   current.st_dev != opened.st_dev;
+#endif
+        }
+
+        void DrainForCrash() noexcept override {
+            const size_t size = m_size.exchange(0, std::memory_order_acq_rel);
+
+            if (size > 0) {
+                WriteFully(m_fd.load(std::memory_order_acquire), m_buffer.get(), size);
+            }
+        }
+
+    private:
+        std::atomic<int> m_fd = -1;
+        std::unique_ptr<char[]> m_buffer;
+        size_t m_capacity;
+        std::atomic<size_t> m_size = 0;
+
+        /**
+         * @brief Serializes the writers of the buffer (the crash drain does not take it: it must not block).
+         */
+        std::mutex m_bufferMutex;
+
+        /**
+         * @brief The error of the last failed write since the last Sync() (0 if none).
+         */
+        std::atomic<int> m_writeError = 0;
+
+        /**
+         * @brief Writes the buffered data to the file (with the buffer locked).
+         */
+        void FlushBuffer() {
+            const size_t size = m_size.load(std::memory_order_acquire);
+
+            if (size == 0) {
+                return;
+            }
+
+            WriteFully(m_fd.load(std::memory_order_relaxed), m_buffer.get(), size);
+            m_size.store(0, std::memory_order_release);
+        }
+
+        /**
+         * @brief Writes the whole data to the file descriptor, retrying on partial writes and interruptions.
+         *
+         * @note Async-signal-safe. Errors are not reported to the caller (there is nowhere to report them from a
+         * crash handler), but remembered for the next Sync().
+         *
+         * @param fd The file descriptor to write to.
+         * @param data The data to write.
+         * @param size The size of the data.
+         */
+        void WriteFully(const int fd, const char *data, size_t size) noexcept {
+            if (fd < 0) {
+                return;
+            }
+
+            while (size > 0) {
+#ifdef _WIN32
+                const auto written = _write(fd, data, static_cast<unsigned int>(size));
+#else
+                const auto written = ::write(fd, data, size);
+#endif
+
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    m_writeError.store(errno, std::memory_order_relaxed);
+                    return;
+                }
+
+                data += written;
+                size -= static_cast<size_t>(written);
+            }
+        }
+    };
+} // namespace slfmt
+
+#endif // SLFMT_FILE_WRITER_H
@@ -0,0 +1,61 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * Files-inl.h - Implementation of the file utilities
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_FILES_INL_H
+#define SLFMT_FILES_INL_H
+
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+#include <miniz.h>
+#include <stdexcept>
+
+#include "Files.h"
+
+namespace slfmt {
+    SLFMT_INLINE void Files::CopyFileToDir(const fs::path &filePath, const fs::path &directory) {
+        if (!fs::exists(filePath)) {
+            throw std::runtime_error("Source file does not exist.");
+        }
+
+        const fs::path dest = directory / filePath.filename();
+        fs::copy_file(filePath, dest, fs::copy_options::overwrite_existing);
+    }
+
+    SLFMT_INLINE void Files::MoveFileToDir(const fs::path &filePath, const fs::path &directory) {
+        if (!fs::exists(filePath)) {
+            throw std::runtime_error("Source file does not exist.");
+        }
+
+        const fs::path dest = directory / filePath.filename();
+        fs::rename(filePath, dest);
+    }
+
+    SLFMT_INLINE fs::path Files::CompressFile(const fs::path &file, const std::string &zip_name) {
+        const auto fileStr = file.string();
+        const auto zipFilename = fmt::format("{}.zip", zip_name);
+        mz_zip_archive zip{};
+
+        memset(&zip, 0, sizeof(zip));
+        mz_zip_writer_init_file(&zip, zipFilename.c_str(), 0);
+        mz_zip_writer_add_file(&zip, fileStr.c_str(), fileStr.c_str(), "", 0, MZ_BEST_COMPRESSION);
+        mz_zip_writer_finalize_archive(&zip);
+        mz_zip_writer_end(&zip);
+
+        return zipFilename;
+    }
+
+    SLFMT_INLINE void Files::ClearFile(const fs::path &file) {
+        std::ofstream(file, std::ios::out | std::ios::trunc).close();
+    }
+} // namespace slfmt
+
+#endif // SLFMT_FILES_INL_H
@@ -2,9 +2,9 @@
 #define SLFMT_FILES_H
 
 #include <filesystem>
-#include <fmt/format.h>
-#include <miniz.h>
-#include <fstream>
+#include <string>
+
+#include "Config.h"
 
 namespace fs = std::filesystem;
 
@@ -17,14 +17,7 @@ namespace slfmt {
          * @param filePath The path to the file to copy.
          * @param directory The directory to copy the file to.
          */
-        static void CopyFileToDir(const fs::path &filePath, const fs::path &directory) {
-            if (!fs::exists(filePath)) {
-                throw std::runtime_error("Source file does not exist.");
-            }
-
-            const fs::path dest = directory / filePath.filename();
-            fs::copy_file(filePath, dest, fs::copy_options::overwrite_existing);
-        }
+        static void CopyFileToDir(const fs::path &filePath, const fs::path &directory);
 
         /**
          * @brief Moves a file to the specified directory.
@@ -32,14 +25,7 @@ namespace slfmt {
          * @param filePath The path to the file to move.
          * @param directory The directory to move the file to.
          */
-        static void MoveFileToDir(const fs::path &filePath, const fs::path &directory) {
-            if (!fs::exists(filePath)) {
-                throw std::runtime_error("Source file does not exist.");
-            }
-
-            const fs::path dest = directory / filePath.filename();
-            fs::rename(filePath, dest);
-        }
+        static void MoveFileToDir(const fs::path &filePath, const fs::path &directory);
 
         /**
          * @brief Compresses a file into a zip archive.
@@ -49,29 +35,19 @@ namespace slfmt {
          *
          * @return The path to the zip archive.
          */
-        static fs::path CompressFile(const fs::path &file, const std::string &zip_name) {
-            const auto fileStr = file.string();
-            const auto zipFilename = fmt::format("{}.zip", zip_name);
-            mz_zip_archive zip{};
-
-            memset(&zip, 0, sizeof(zip));
-            mz_zip_writer_init_file(&zip, zipFilename.c_str(), 0);
-            mz_zip_writer_add_file(&zip, fileStr.c_str(), fileStr.c_str(), "", 0, MZ_BEST_COMPRESSION);
-            mz_zip_writer_finalize_archive(&zip);
-            mz_zip_writer_end(&zip);
-
-            return zipFilename;
-        }
+        static fs::path CompressFile(const fs::path &file, const std::string &zip_name);
 
         /**
          * @brief Clears the contents of the specified file.
          *
          * @param file The file to clear.
          */
-        static void ClearFile(const fs::path &file) {
-            std::ofstream(file, std::ios::out | std::ios::trunc).close();
-        }
+        static void ClearFile(const fs::path &file);
     };
 } // slfmt
 
+#ifndef SLFMT_COMPILED_LIB
+    #include "Files-inl.h"
+#endif
+
 #endif // SLFMT_FILES_H
@@ -0,0 +1,139 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * GzipWriter-inl.h - Implementation of the streaming gzip compression
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_GZIP_WRITER_INL_H
+#define SLFMT_GZIP_WRITER_INL_H
+
+#include <array>
+#include <miniz.h>
+#include <stdexcept>
+
+#include "GzipWriter.h"
+
+namespace slfmt {
+    struct GzipWriter::Deflater {
+        mz_stream stream{};
+        mz_ulong crc = MZ_CRC32_INIT;
+    };
+
+    SLFMT_INLINE GzipWriter::GzipWriter(FileWriter &writer, const size_t blockSize, const int level)
+        : m_writer(writer), m_blockSize(blockSize), m_level(level), m_deflater(std::make_unique<Deflater>()) {}
+
+    SLFMT_INLINE GzipWriter::~GzipWriter() {
+        if (m_started) {
+            mz_deflateEnd(&m_deflater->stream);
+        }
+    }
+
+    SLFMT_INLINE void GzipWriter::Begin() {
+        // Magic, deflate method, no flags, no modification time, no extra flags, unknown OS.
+        static constexpr std::array<unsigned char, 10> HEADER = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF };
+
+        if (m_started) {
+            throw std::logic_error("The gzip stream has already been started.");
+        }
+
+        auto &stream = m_deflater->stream;
+        stream = {};
+
+        // Negative window bits produce a raw deflate stream, the gzip framing is written by hand.
+        if (mz_deflateInit2(&stream, m_level, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 9, MZ_DEFAULT_STRATEGY) !=
+            MZ_OK) {
+            throw std::runtime_error("Failed to initialize the gzip compressor.");
+        }
+
+        m_started = true;
+        m_deflater->crc = MZ_CRC32_INIT;
+        m_inputSize = 0;
+        m_blockFill = 0;
+        WriteOutput(reinterpret_cast<const char *>(HEADER.data()), HEADER.size());
+    }
+
+    SLFMT_INLINE void GzipWriter::Write(const std::string_view data) {
+        const auto *bytes = reinterpret_cast<const unsigned char *>(data.data());
+
+        m_deflater->crc = mz_crc32(m_deflater->crc, bytes, data.size());
+        m_inputSize += data.size();
+        m_blockFill += data.size();
+
+        Deflate(bytes, data.size(), MZ_NO_FLUSH);
+
+        if (m_blockSize > 0 && m_blockFill >= m_blockSize) {
+            FlushBlock();
+        }
+    }
+
+    SLFMT_INLINE void GzipWriter::FlushBlock() {
+        if (m_blockFill == 0) {
+            return;
+        }
+
+        Deflate(nullptr, 0, MZ_SYNC_FLUSH);
+        m_blockFill = 0;
+    }
+
+    SLFMT_INLINE void GzipWriter::Finish() {
+        if (!m_started) {
+            return;
+        }
+
+        Deflate(nullptr, 0, MZ_FINISH);
+        mz_deflateEnd(&m_deflater->stream);
+        m_started = false;
+
+        // CRC-32 and size of the uncompressed data (modulo 2^32), both little-endian.
+        const auto crc = m_deflater->crc;
+        std::array<char, 8> trailer{};
+        for (size_t i = 0; i < 4; i++) {
+            trailer[i] = static_cast<char>((crc >> (8 * i)) & 0xFF);
+            trailer[4 + i] = static_cast<char>((m_inputSize >> (8 * i)) & 0xFF);
+        }
+
+        WriteOutput(trailer.data(), trailer.size());
+    }
+
+    SLFMT_INLINE void GzipWriter::WriteOutput(const char *data, const size_t size) {
+        m_writer.Write({ data, size });
+        m_outputSize += size;
+    }
+
+    SLFMT_INLINE void GzipWriter::Deflate(const unsigned char *data, const size_t size, const int flush) {
+        std::array<unsigned char, 16 * 1024> output; // Not initialized: only the produced bytes are read.
+        auto &stream = m_deflater->stream;
+
+        stream.next_in = data;
+        stream.avail_in = static_cast<unsigned int>(size);
+
+        while (true) {
+            stream.next_out = output.data();
+            stream.avail_out = static_cast<unsigned int>(output.size());
+
+            const int status = mz_deflate(&stream, flush);
+
+            if (status != MZ_OK && status != MZ_STREAM_END && status != MZ_BUF_ERROR) {
+                throw std::runtime_error("Failed to compress the log data.");
+            }
+
+            const size_t produced = output.size() - stream.avail_out;
+
+            if (produced > 0) {
+                WriteOutput(reinterpret_cast<const char *>(output.data()), produced);
+            }
+
+            // Done once all the input is consumed and the compressor had room to spare (or the stream ended).
+            if (status == MZ_STREAM_END || (stream.avail_in == 0 && stream.avail_out != 0)) {
+                break;
+            }
+        }
+    }
+} // namespace slfmt
+
+#endif // SLFMT_GZIP_WRITER_INL_H
@@ -0,0 +1,133 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * GzipWriter.h - Streaming gzip compression of log files
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_GZIP_WRITER_H
+#define SLFMT_GZIP_WRITER_H
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+#include "Config.h"
+#include "FileWriter.h"
+
+namespace slfmt {
+    /**
+     * @brief Compresses data on the fly into gzip format, writing the compressed bytes through a FileWriter.
+     *
+     * @note The deflate stream is flushed (MZ_SYNC_FLUSH) every time a block of blockSize uncompressed bytes has
+     * been written, so everything up to the last block boundary can be decompressed even if the program crashes
+     * before Finish() writes the gzip trailer (e.g. <code>zcat</code> prints it and then reports the truncation).
+     */
+    class GzipWriter {
+    public:
+        static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024; // 64 KB
+        static constexpr int DEFAULT_LEVEL = 6; // MZ_DEFAULT_LEVEL
+
+        /**
+         * @brief Constructs a new gzip writer. No data is written until Begin() is called.
+         *
+         * @param writer The writer to write the compressed data to.
+         * @param blockSize The amount of uncompressed data (in bytes) after which the stream is flushed, or 0 to
+         * only flush it when FlushBlock() is called.
+         * @param level The compression level (0-10, see miniz).
+         */
+        explicit GzipWriter(FileWriter &writer, size_t blockSize = DEFAULT_BLOCK_SIZE, int level = DEFAULT_LEVEL);
+
+        GzipWriter(const GzipWriter &) = delete;
+        GzipWriter &operator=(const GzipWriter &) = delete;
+
+        ~GzipWriter();
+
+        /**
+         * @brief Starts a new gzip stream (writes the gzip header).
+         */
+        void Begin();
+
+        /**
+         * @brief Compresses the specified data, flushing the stream if a block boundary is reached.
+         *
+         * @param data The data to compress.
+         */
+        void Write(std::string_view data);
+
+        /**
+         * @brief Flushes all the data written so far to the file, ending the current block.
+         */
+        void FlushBlock();
+
+        /**
+         * @brief Ends the gzip stream (writes the remaining data and the gzip trailer).
+         */
+        void Finish();
+
+        /**
+         * @brief Checks if a gzip stream is in progress.
+         *
+         * @return True if Begin() has been called and Finish() has not.
+         */
+        FMT_NODISCARD bool IsStarted() const { return m_started; }
+
+        /**
+         * @brief Gets the amount of uncompressed data written since the last block boundary.
+         *
+         * @return The size (in bytes) of the data in the current block.
+         */
+        FMT_NODISCARD size_t BlockFill() const { return m_blockFill; }
+
+        /**
+         * @brief Gets the total amount of compressed data (headers and trailers included) written by this object.
+         *
+         * @return The size (in bytes) of the compressed output.
+         */
+        FMT_NODISCARD std::uint64_t OutputSize() const { return m_outputSize; }
+
+    private:
+        FileWriter &m_writer;
+        const size_t m_blockSize;
+        const int m_level;
+
+        /**
+         * @brief The miniz deflate stream and checksum (defined with the implementation, so that only the
+         * library parses miniz when it is compiled).
+         */
+        struct Deflater;
+
+        std::unique_ptr<Deflater> m_deflater;
+        bool m_started = false;
+        std::uint64_t m_inputSize = 0;
+        size_t m_blockFill = 0;
+        std::uint64_t m_outputSize = 0;
+
+        /**
+         * @brief Writes compressed data to the file.
+         *
+         * @param data The data to write.
+         * @param size The size of the data.
+         */
+        void WriteOutput(const char *data, size_t size);
+
+        /**
+         * @brief Runs the compressor over the specified input, writing all the output it produces.
+         *
+         * @param data The input data (may be null for flushes).
+         * @param size The size of the input data.
+         * @param flush The miniz flush mode.
+         */
+        void Deflate(const unsigned char *data, size_t size, int flush);
+    };
+} // namespace slfmt
+
+#ifndef SLFMT_COMPILED_LIB
+    #include "GzipWriter-inl.h"
+#endif
+
+#endif // SLFMT_GZIP_WRITER_H
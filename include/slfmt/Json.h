@@ -0,0 +1,168 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * Json.h - JSON string escaping for slfmt
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_JSON_H
+#define SLFMT_JSON_H
+
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#if defined(__AVX2__)
+    #define SLFMT_JSON_AVX2 1
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SLFMT_JSON_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+namespace slfmt {
+    /**
+     * @brief JSON helpers used by the JSON log layout.
+     */
+    class Json {
+    public:
+        /**
+         * @brief Appends the specified string to the output, escaping it as the contents of a JSON string
+         * (quotes are not added).
+         *
+         * @note Quotes, backslashes and control characters (< 0x20) are escaped. Any other byte (including
+         * UTF-8 sequences) is copied as is. The scan for characters to escape is vectorized with AVX2 or SSE2
+         * when the compiler targets them, falling back to a scalar loop otherwise.
+         *
+         * @param out The string to append to.
+         * @param str The string to escape.
+         */
+        static void Escape(std::string &out, const std::string_view str) {
+            const char *it = str.data();
+            const char *const end = it + str.size();
+
+            while (it != end) {
+                const char *next = FindEscapable(it, end);
+                out.append(it, next);
+
+                if (next == end) {
+                    break;
+                }
+
+                EscapeChar(out, *next);
+                it = next + 1;
+            }
+        }
+
+        /**
+         * @brief Appends the specified string to the output as a quoted JSON string.
+         *
+         * @param out The string to append to.
+         * @param str The string to quote.
+         */
+        static void Quote(std::string &out, const std::string_view str) {
+            out += '"';
+            Escape(out, str);
+            out += '"';
+        }
+
+    private:
+        /**
+         * @brief Checks if a character must be escaped inside a JSON string.
+         *
+         * @param c The character to check.
+         *
+         * @return True if the character must be escaped.
+         */
+        static constexpr bool IsEscapable(const char c) {
+            return static_cast<unsigned char>(c) < 0x20 || c == '"' || c == '\\';
+        }
+
+        /**
+         * @brief Finds the first character in [begin, end) that must be escaped.
+         *
+         * @param begin The start of the range.
+         * @param end The end of the range.
+         *
+         * @return A pointer to the first character to escape, or end if there is none.
+         */
+        static const char *FindEscapable(const char *begin, const char *const end) {
+#if defined(SLFMT_JSON_AVX2)
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i backslash = _mm256_set1_epi8('\\');
+            const __m256i control = _mm256_set1_epi8(0x1F);
+
+            for (; end - begin >= 32; begin += 32) {
+                const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+
+                // A byte is a control character iff max(byte, 0x1F) == 0x1F (unsigned comparison).
+                const __m256i mask = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+                        _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, control), control));
+                const auto bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(mask));
+
+                if (bits != 0) {
+                    return begin + std::countr_zero(bits);
+                }
+            }
+#elif defined(SLFMT_JSON_SSE2)
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i control = _mm_set1_epi8(0x1F);
+
+            for (; end - begin >= 16; begin += 16) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+
+                // A byte is a control character iff max(byte, 0x1F) == 0x1F (unsigned comparison).
+                const __m128i mask = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                                               _mm_cmpeq_epi8(chunk, backslash)),
+                                                  _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+                const auto bits = static_cast<std::uint32_t>(_mm_movemask_epi8(mask));
+
+                if (bits != 0) {
+                    return begin + std::countr_zero(bits);
+                }
+            }
+#endif
+
+            // Scalar fallback (also handles the tail that does not fill a whole vector).
+            while (begin != end && !IsEscapable(*begin)) {
+                ++begin;
+            }
+
+            return begin;
+        }
+
+        /**
+         * @brief Appends the escape sequence of the specified character.
+         *
+         * @param out The string to append to.
+         * @param c The character to escape.
+         */
+        static void EscapeChar(std::string &out, const char c) {
+            static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\b': out += "\\b"; break;
+                case '\f': out += "\\f"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default: {
+                    const auto byte = static_cast<unsigned char>(c);
+                    const char unicode[] = { '\\', 'u', '0', '0', HEX_DIGITS[byte >> 4], HEX_DIGITS[byte & 0xF] };
+                    out.append(unicode, sizeof(unicode));
+                }
+            }
+        }
+    };
+} // namespace slfmt
+
+#endif // SLFMT_JSON_H
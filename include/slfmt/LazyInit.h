@@ -0,0 +1,67 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * LazyInit.h - One-time initialization on first use
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_LAZY_INIT_H
+#define SLFMT_LAZY_INIT_H
+
+#include <atomic>
+#include <fmt/format.h>
+#include <mutex>
+
+namespace slfmt {
+    /**
+     * @brief Runs an initialization function once, the first time it is needed.
+     *
+     * @note Loggers are usually created during static initialization (see the <code>SLFMT_*_LOGGER_FIELD</code>
+     * macros), so they defer opening their files and starting their threads until the first message is logged.
+     * Once the initialization has completed, Run() is a single atomic load. If the initialization function throws,
+     * it is run again on the next call.
+     */
+    class LazyInit {
+    public:
+        /**
+         * @brief Runs the specified function if it is the first call (or all the previous ones threw). Concurrent
+         * callers wait until the initialization has completed.
+         *
+         * @note The function must not call Run() on the same object.
+         *
+         * @param init The initialization function.
+         */
+        template<typename Function>
+        void Run(Function &&init) {
+            if (m_done.load(std::memory_order_acquire)) {
+                return;
+            }
+
+            std::lock_guard lock(m_mutex);
+
+            if (!m_done.load(std::memory_order_relaxed)) {
+                init();
+                m_done.store(true, std::memory_order_release);
+            }
+        }
+
+        /**
+         * @brief Checks if the initialization has completed.
+         *
+         * @return True if the initialization function has run successfully.
+         */
+        FMT_NODISCARD bool IsDone() const {
+            return m_done.load(std::memory_order_acquire);
+        }
+
+    private:
+        std::atomic<bool> m_done = false;
+        std::mutex m_mutex;
+    };
+} // namespace slfmt
+
+#endif // SLFMT_LAZY_INIT_H
@@ -12,15 +12,15 @@
 #ifndef SLFMT_LEVEL_H
 #define SLFMT_LEVEL_H
 
-#include <string>
+#include <string_view>
 
-static const auto TRACE_LEVEL_STRING = "TRACE";
-static const auto DEBUG_LEVEL_STRING = "DEBUG";
-static const auto INFO_LEVEL_STRING = "INFO";
-static const auto WARN_LEVEL_STRING = "WARN";
-static const auto ERROR_LEVEL_STRING = "ERROR";
-static const auto FATAL_LEVEL_STRING = "FATAL";
-static const auto UNKNOWN_LEVEL_STRING = "UNKNOWN";
+static constexpr std::string_view TRACE_LEVEL_STRING = "TRACE";
+static constexpr std::string_view DEBUG_LEVEL_STRING = "DEBUG";
+static constexpr std::string_view INFO_LEVEL_STRING = "INFO";
+static constexpr std::string_view WARN_LEVEL_STRING = "WARN";
+static constexpr std::string_view ERROR_LEVEL_STRING = "ERROR";
+static constexpr std::string_view FATAL_LEVEL_STRING = "FATAL";
+static constexpr std::string_view UNKNOWN_LEVEL_STRING = "UNKNOWN";
 
 namespace slfmt {
     /**
@@ -32,9 +32,9 @@ namespace slfmt {
      * @brief Converts a log level to a string.
      *
      * @param level The level to convert.
-     * @return The string representation of the level.
+     * @return The string representation of the level (a static string: nothing is allocated).
      */
-    static std::string LevelToString(const Level &level) {
+    constexpr std::string_view LevelToString(const Level &level) {
         switch (level) {
             case Level::TRACE: return TRACE_LEVEL_STRING;
             case Level::DEBUG: return DEBUG_LEVEL_STRING;
@@ -52,7 +52,7 @@ namespace slfmt {
      * @param level The string to convert.
      * @return The log level.
      */
-    static Level StringToLevel(const std::string_view &level) {
+    constexpr Level StringToLevel(const std::string_view &level) {
         if (level == TRACE_LEVEL_STRING) return Level::TRACE;
         if (level == DEBUG_LEVEL_STRING) return Level::DEBUG;
         if (level == INFO_LEVEL_STRING) return Level::INFO;
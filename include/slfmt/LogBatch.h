@@ -0,0 +1,239 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * LogBatch.h - Batches of log messages written at once
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_LOG_BATCH_H
+#define SLFMT_LOG_BATCH_H
+
+#include <chrono>
+#include <fmt/format.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Clock.h"
+#include "Level.h"
+#include "LogFormat.h"
+
+namespace slfmt {
+    class LoggerBase;
+
+    /**
+     * @brief Messages collected to be written by a logger all at once (see LoggerBase::Batch()).
+     *
+     * @note The messages are formatted when they are added, one after the other in a single buffer, and handed to
+     * the logger when the batch is committed (on Commit() or when the batch is destroyed): file loggers write the
+     * whole batch with one call, the socket logger queues it with one lock. Messages of levels the logger does not
+     * write are discarded when added. Repeated messages are not collapsed (see LoggerBase::SuppressRepeats()), and
+     * fields are the ones of the thread when the batch is committed.
+     */
+    class LogBatch {
+    public:
+        /**
+         * @brief How the messages of a batch are timestamped.
+         */
+        enum class Timestamp {
+            /**
+             * @brief Each message with the time it was added at.
+             */
+            PER_RECORD,
+
+            /**
+             * @brief All the messages with the time the batch was created at (read and formatted only once).
+             */
+            SNAPSHOT
+        };
+
+        /**
+         * @brief Creates an empty batch for a logger.
+         *
+         * @param logger The logger that writes the batch.
+         * @param timestamp How the messages are timestamped.
+         */
+        LogBatch(LoggerBase &logger, const Timestamp timestamp)
+            : m_logger(logger), m_timestamp(timestamp),
+              m_snapshot(timestamp == Timestamp::SNAPSHOT ? Clock::Now() : Clock::TimePoint{}) {}
+
+        LogBatch(const LogBatch &) = delete;
+        LogBatch(LogBatch &&) = delete;
+
+        LogBatch &operator=(const LogBatch &) = delete;
+        LogBatch &operator=(LogBatch &&) = delete;
+
+        /**
+         * @brief Commits the messages that have not been committed yet.
+         *
+         * @note Errors writing the messages are ignored here: call Commit() to get them.
+         */
+        ~LogBatch() {
+            try {
+                Commit();
+            } catch (...) {
+                // A destructor must not throw.
+            }
+        }
+
+        /**
+         * @brief Adds a message of the specified level to the batch.
+         *
+         * @tparam Args The types of the arguments to format the message with.
+         * @param level The level of the message.
+         * @param format The format string.
+         * @param args The arguments to format the message with.
+         */
+        template<typename... Args>
+        void Log(const Level &level, const std::string_view format, Args &&...args) {
+            Add(level, format, fmt::make_format_args(args...));
+        }
+
+        /**
+         * @brief Adds a message of the TRACE level to the batch.
+         */
+        template<typename... Args>
+        void Trace(const std::string_view format, Args &&...args) {
+            Add(Level::TRACE, format, fmt::make_format_args(args...));
+        }
+
+        /**
+         * @brief Adds a message of the DEBUG level to the batch.
+         */
+        template<typename... Args>
+        void Debug(const std::string_view format, Args &&...args) {
+            Add(Level::DEBUG, format, fmt::make_format_args(args...));
+        }
+
+        /**
+         * @brief Adds a message of the INFO level to the batch.
+         */
+        template<typename... Args>
+        void Info(const std::string_view format, Args &&...args) {
+            Add(Level::INFO, format, fmt::make_format_args(args...));
+        }
+
+        /**
+         * @brief Adds a message of the WARN level to the batch.
+         */
+        template<typename... Args>
+        void Warn(const std::string_view format, Args &&...args) {
+            Add(Level::WARN, format, fmt::make_format_args(args...));
+        }
+
+        /**
+         * @brief Adds a message of the ERROR level to the batch.
+         */
+        template<typename... Args>
+        void Error(const std::string_view format, Args &&...args) {
+            Add(Level::ERROR, format, fmt::make_format_args(args...));
+        }
+
+        /**
+         * @brief Adds a message of the FATAL level to the batch.
+         */
+        template<typename... Args>
+        void Fatal(const std::string_view format, Args &&...args) {
+            Add(Level::FATAL, format, fmt::make_format_args(args...));
+        }
+
+        /**
+         * @brief Hands the messages added so far to the logger, and empties the batch.
+         */
+        void Commit();
+
+        /**
+         * @brief Gets the number of messages in the batch.
+         *
+         * @return The number of messages not committed yet.
+         */
+        FMT_NODISCARD size_t Size() const {
+            return m_records.size();
+        }
+
+        /**
+         * @brief Gets the highest level of the messages in the batch (e.g. to flush after errors).
+         *
+         * @return The highest level, or TRACE if the batch is empty.
+         */
+        FMT_NODISCARD Level GetMaxLevel() const {
+            return m_maxLevel;
+        }
+
+        /**
+         * @brief Calls a function for every message of the batch, in order, with its timestamp fixed (see
+         * LogFormat::TimestampScope).
+         *
+         * @note Used by the loggers to write the batch. Each distinct timestamp is formatted only once.
+         *
+         * @tparam Function A callable with the signature <code>void(Level, std::string_view)</code>.
+         * @param function The function to call with the level and the message.
+         */
+        template<typename Function>
+        void ForEach(Function &&function) const {
+            std::string timestamp;
+            std::chrono::milliseconds formattedTime{ -1 };
+
+            for (const auto &record: m_records) {
+                // Timestamps only show milliseconds.
+                const auto time =
+                        std::chrono::duration_cast<std::chrono::milliseconds>(record.time.time_since_epoch());
+
+                if (time != formattedTime) {
+                    timestamp = LogFormat::FormatTimestamp(record.time);
+                    formattedTime = time;
+                }
+
+                const LogFormat::TimestampScope scope(timestamp, record.time);
+                function(record.level, std::string_view(m_messages).substr(record.offset, record.size));
+            }
+        }
+
+    private:
+        /**
+         * @brief A message of the batch (its text is in m_messages).
+         */
+        struct Record {
+            Level level;
+            Clock::TimePoint time;
+            size_t offset;
+            size_t size;
+        };
+
+        LoggerBase &m_logger;
+        const Timestamp m_timestamp;
+
+        /**
+         * @brief The time of all the messages (only with Timestamp::SNAPSHOT).
+         */
+        const Clock::TimePoint m_snapshot;
+
+        /**
+         * @brief The text of all the messages, one after the other.
+         */
+        std::string m_messages;
+
+        std::vector<Record> m_records;
+        Level m_maxLevel = Level::TRACE;
+
+        /**
+         * @brief Formats a message at the end of the batch (if the logger writes its level).
+         *
+         * @param level The level of the message.
+         * @param format The format string.
+         * @param args The arguments to format the message with.
+         */
+        void Add(Level level, std::string_view format, fmt::format_args args);
+
+        /**
+         * @brief Removes all the messages.
+         */
+        void Clear();
+    };
+} // namespace slfmt
+
+#endif // SLFMT_LOG_BATCH_H
@@ -0,0 +1,477 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * LogFormat-inl.h - Implementation of the log format
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_LOG_FORMAT_INL_H
+#define SLFMT_LOG_FORMAT_INL_H
+
+#include <cstring>
+#include <iomanip>
+#include <slfmt/Clock.h>
+#include <sstream>
+
+#include "LogFormat.h"
+
+namespace slfmt {
+    SLFMT_INLINE const LogFormat &LogFormat::Get() {
+        // The snapshot used by the thread, and the version it was taken at.
+        thread_local std::shared_ptr<const LogFormat> format;
+        thread_local std::uint64_t formatVersion = 0;
+        const auto version = s_version.load(std::memory_order_acquire);
+
+        if (format == nullptr || formatVersion != version) {
+            format = GetShared();
+            formatVersion = version;
+        }
+
+        return *format;
+    }
+
+    SLFMT_INLINE std::shared_ptr<const LogFormat> LogFormat::GetShared() {
+        const std::lock_guard lock(s_formatMutex);
+
+        if (s_format == nullptr || s_format->IsEmpty()) {
+            auto builder = Builder().Timestamp().Level().Class().ThreadId().Message();
+            s_format = std::make_shared<const LogFormat>(builder.Build());
+        }
+
+        return s_format;
+    }
+
+    SLFMT_INLINE void LogFormat::Set(const LogFormat &format) {
+        auto snapshot = std::make_shared<const LogFormat>(format);
+
+        {
+            const std::lock_guard lock(s_formatMutex);
+            s_format = std::move(snapshot);
+        }
+
+        s_version.fetch_add(1, std::memory_order_release);
+    }
+
+    SLFMT_INLINE std::string LogFormat::Format(
+            const std::unordered_map<std::string_view, std::string_view> &replaces) const {
+        std::string formatted;
+        FormatTo(formatted, replaces);
+        return formatted;
+    }
+
+    SLFMT_INLINE void LogFormat::FormatTo(
+            std::string &formatted, const std::unordered_map<std::string_view, std::string_view> &replaces) const {
+        if (m_json) {
+            FormatJson(formatted, replaces);
+            return;
+        }
+
+        formatted.clear();
+
+        if (m_literals.empty()) {
+            return;
+        }
+
+        // Written in a single pass: the values (fields and context come from the caller) are never searched for
+        // placeholders.
+        formatted += m_literals.front();
+
+        for (size_t i = 0; i < m_functions.size(); i++) {
+            AppendValue(formatted, i, replaces);
+            formatted += m_literals[i + 1];
+        }
+    }
+
+    SLFMT_INLINE void LogFormat::AppendValue(
+            std::string &out, const size_t index,
+            const std::unordered_map<std::string_view, std::string_view> &replaces) const {
+        const auto placeholder = m_placeholders[index];
+
+        if (placeholder.empty()) {
+            m_functions[index](out);
+            return;
+        }
+
+        // Not every record has all the placeholders (e.g. without the class): the placeholder is kept.
+        const auto replace = replaces.find(placeholder);
+        out += replace != replaces.end() ? replace->second : placeholder;
+    }
+
+    SLFMT_INLINE LogFormat::Builder &LogFormat::Builder::Timestamp(const std::string &leftDelimiter,
+                                                                  const std::string &rightDelimiter) {
+        const auto delimited_string = Delimit("{}", leftDelimiter, rightDelimiter);
+        m_formats.push_back(delimited_string);
+        m_functions.emplace_back(AppendTimestamp);
+        m_placeholders.emplace_back();
+        m_keys.emplace_back("timestamp");
+        return *this;
+    }
+
+    SLFMT_INLINE LogFormat::Builder &LogFormat::Builder::Level(const std::string &leftDelimiter,
+                                                              const std::string &rightDelimiter) {
+        const auto delimited_string = Delimit("{}", leftDelimiter, rightDelimiter);
+        m_formats.push_back(delimited_string);
+        m_functions.emplace_back(nullptr);
+        m_placeholders.emplace_back("{L}");
+        m_keys.emplace_back("level");
+        return *this;
+    }
+
+    SLFMT_INLINE LogFormat::Builder &LogFormat::Builder::Class(const std::string &leftDelimiter,
+                                                              const std::string &rightDelimiter) {
+        const auto delimited_string = Delimit("{}", leftDelimiter, rightDelimiter);
+        m_formats.push_back(delimited_string);
+        m_functions.emplace_back(nullptr);
+        m_placeholders.emplace_back("{C}");
+        m_keys.emplace_back("class");
+        return *this;
+    }
+
+    SLFMT_INLINE LogFormat::Builder &LogFormat::Builder::ThreadId(const std::string &leftDelimiter,
+                                                                 const std::string &rightDelimiter) {
+        const auto delimited_string = Delimit("{}", leftDelimiter, rightDelimiter);
+        m_formats.push_back(delimited_string);
+        m_functions.emplace_back(AppendThreadId);
+        m_placeholders.emplace_back();
+        m_keys.emplace_back("thread");
+        return *this;
+    }
+
+    SLFMT_INLINE LogFormat::Builder &LogFormat::Builder::Message(const std::string &leftDelimiter,
+                                                                const std::string &rightDelimiter) {
+        const auto delimited_string = Delimit("{}", leftDelimiter, rightDelimiter);
+        m_formats.push_back(delimited_string);
+        m_functions.emplace_back(nullptr);
+        m_placeholders.emplace_back("{M}");
+        m_keys.emplace_back("message");
+        return *this;
+    }
+
+    SLFMT_INLINE LogFormat::Builder &LogFormat::Builder::Fields(const std::string &leftDelimiter,
+                                                               const std::string &rightDelimiter) {
+        const auto delimited_string = Delimit("{}", leftDelimiter, rightDelimiter);
+        m_formats.push_back(delimited_string);
+        m_functions.emplace_back(AppendFields);
+        m_placeholders.emplace_back();
+        m_keys.emplace_back(FIELDS_KEY);
+        return *this;
+    }
+
+    SLFMT_INLINE LogFormat::Builder &LogFormat::Builder::Context(const std::string &leftDelimiter,
+                                                                const std::string &rightDelimiter) {
+        const auto delimited_string = Delimit("{}", leftDelimiter, rightDelimiter);
+        m_formats.push_back(delimited_string);
+        m_functions.emplace_back(AppendContext);
+        m_placeholders.emplace_back();
+        m_keys.emplace_back(CONTEXT_KEY);
+        return *this;
+    }
+
+    SLFMT_INLINE LogFormat LogFormat::Builder::Build() const {
+        LogFormat logFormat;
+
+        // Each format is separated by a space (except for the last one), and split around the value of its element.
+        std::string literal;
+
+        for (size_t i = 0; i < m_formats.size(); i++) {
+            const auto value = m_formats[i].find("{}");
+            literal += m_formats[i].substr(0, value);
+            logFormat.m_literals.push_back(std::move(literal));
+            literal = m_formats[i].substr(value + 2);
+
+            if (i != m_formats.size() - 1) {
+                literal += " ";
+            }
+        }
+
+        literal += "\n"; // Add a newline at the end.
+        logFormat.m_literals.push_back(std::move(literal));
+        logFormat.m_functions = m_functions;
+        logFormat.m_placeholders = m_placeholders;
+
+        return logFormat;
+    }
+
+    SLFMT_INLINE LogFormat LogFormat::Builder::BuildJson() const {
+        LogFormat logFormat;
+
+        logFormat.m_json = true;
+        logFormat.m_functions = m_functions;
+        logFormat.m_placeholders = m_placeholders;
+        logFormat.m_keys = m_keys;
+
+        if (std::find(m_keys.begin(), m_keys.end(), FIELDS_KEY) == m_keys.end()) {
+            logFormat.m_functions.emplace_back(AppendFields);
+            logFormat.m_placeholders.emplace_back();
+            logFormat.m_keys.emplace_back(FIELDS_KEY);
+        }
+
+        return logFormat;
+    }
+
+    SLFMT_INLINE std::string LogFormat::GetTimestampString() {
+        if (s_timestamp != nullptr) {
+            return GetFixedTimestamp();
+        }
+
+        return FormatTimestamp(Clock::Now());
+    }
+
+    SLFMT_INLINE void LogFormat::AppendTimestamp(std::string &out) {
+        if (s_timestamp != nullptr) {
+            out += GetFixedTimestamp();
+            return;
+        }
+
+        out += FormatTimestamp(Clock::Now());
+    }
+
+    SLFMT_INLINE const std::string &LogFormat::GetFixedTimestamp() {
+        if (s_unformatted != nullptr && s_unformatted->empty()) {
+            *s_unformatted = FormatTimestamp(s_time);
+        }
+
+        return *s_timestamp;
+    }
+
+    SLFMT_INLINE std::chrono::system_clock::time_point LogFormat::GetTime() {
+        return s_timestamp != nullptr ? s_time : Clock::Now();
+    }
+
+    SLFMT_INLINE std::string LogFormat::FormatTimestamp(const std::chrono::system_clock::time_point time) {
+        const auto nowTime = std::chrono::system_clock::to_time_t(time);
+        const auto nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()) % 1000;
+        tm tm = {};
+
+#ifdef _WIN32
+        localtime_s(&tm, &nowTime);
+#else
+        localtime_r(&nowTime, &tm);
+#endif
+
+        std::stringstream ss;
+        ss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << ',' << std::setfill('0') << std::setw(3) << nowMs.count();
+        return ss.str();
+    }
+
+    SLFMT_INLINE void LogFormat::FormatJson(
+            std::string &formatted, const std::unordered_map<std::string_view, std::string_view> &replaces) const {
+        formatted.clear();
+        formatted += '{';
+
+        for (size_t i = 0; i < m_functions.size(); i++) {
+            if (m_keys[i] == FIELDS_KEY) {
+                AppendJsonFields(formatted);
+                continue;
+            }
+
+            if (m_keys[i] == CONTEXT_KEY) {
+                const auto &members = GetContextJson();
+
+                if (!members.empty() && formatted.size() > 1) {
+                    formatted += ',';
+                }
+
+                formatted += members;
+
+                continue;
+            }
+
+            if (formatted.size() > 1) {
+                formatted += ',';
+            }
+
+            Json::Quote(formatted, m_keys[i]);
+            formatted += ':';
+
+            if (m_placeholders[i].empty()) {
+                // The value is escaped as a whole, so it is written to a scratch buffer first.
+                thread_local std::string value;
+                value.clear();
+                m_functions[i](value);
+                Json::Quote(formatted, value);
+                continue;
+            }
+
+            const auto replace = replaces.find(m_placeholders[i]);
+            Json::Quote(formatted, replace != replaces.end() ? replace->second : m_placeholders[i]);
+        }
+
+        formatted += "}\n";
+    }
+
+    SLFMT_INLINE void LogFormat::AppendJsonFields(std::string &out) {
+        if (s_attributes != nullptr) {
+            if (!s_attributes->fieldsJson.empty()) {
+                if (out.size() > 1) {
+                    out += ',';
+                }
+
+                out += s_attributes->fieldsJson;
+            }
+
+            return;
+        }
+
+        const auto *fields = Fields::Current();
+
+        if (fields == nullptr) {
+            return;
+        }
+
+        for (const auto &field: *fields) {
+            if (out.size() > 1) {
+                out += ',';
+            }
+
+            field.AppendJson(out);
+        }
+    }
+
+    SLFMT_INLINE std::string LogFormat::GetFieldsString() {
+        std::string str;
+        AppendFields(str);
+        return str;
+    }
+
+    SLFMT_INLINE void LogFormat::AppendFields(std::string &out) {
+        if (s_attributes != nullptr) {
+            out += s_attributes->fieldsText;
+            return;
+        }
+
+        const auto *fields = Fields::Current();
+
+        if (fields == nullptr) {
+            return;
+        }
+
+        bool first = true;
+
+        for (const auto &field: *fields) {
+            if (!first) {
+                out += ' ';
+            }
+
+            field.AppendText(out);
+            first = false;
+        }
+    }
+
+    SLFMT_INLINE const std::string &LogFormat::GetContextText() {
+        return s_attributes != nullptr ? s_attributes->contextText : slfmt::Context::Text();
+    }
+
+    SLFMT_INLINE void LogFormat::AppendContext(std::string &out) {
+        out += GetContextText();
+    }
+
+    SLFMT_INLINE const std::string &LogFormat::GetContextJson() {
+        return s_attributes != nullptr ? s_attributes->contextJson : slfmt::Context::JsonMembers();
+    }
+
+    SLFMT_INLINE LogFormat::Attributes LogFormat::Attributes::Capture() {
+        Attributes attributes;
+        attributes.fieldsText = GetFieldsString();
+        AppendJsonFields(attributes.fieldsJson);
+        attributes.contextText = GetContextText();
+        attributes.contextJson = GetContextJson();
+        return attributes;
+    }
+
+    SLFMT_INLINE size_t LogFormat::Attributes::SerializedSize() const {
+        if (Empty()) {
+            return 0;
+        }
+
+        size_t size = 0;
+
+        for (const auto member: ATTRIBUTES) {
+            size += sizeof(std::uint32_t) + (this->*member).size();
+        }
+
+        return size;
+    }
+
+    SLFMT_INLINE void LogFormat::Attributes::Serialize(char *data) const {
+        if (Empty()) {
+            return;
+        }
+
+        for (const auto member: ATTRIBUTES) {
+            const auto &value = this->*member;
+            const auto valueSize = static_cast<std::uint32_t>(value.size());
+
+            std::memcpy(data, &valueSize, sizeof(valueSize));
+            std::memcpy(data + sizeof(valueSize), value.data(), value.size());
+            data += sizeof(valueSize) + value.size();
+        }
+    }
+
+    SLFMT_INLINE bool LogFormat::Attributes::Deserialize(std::string_view data, Attributes &attributes) {
+        const auto clear = [&attributes] {
+            for (const auto member: ATTRIBUTES) {
+                (attributes.*member).clear();
+            }
+        };
+
+        clear();
+
+        if (data.empty()) {
+            return true;
+        }
+
+        // Never trust the sizes beyond the data (e.g. a record of a ring shared with other processes).
+        for (const auto member: ATTRIBUTES) {
+            std::uint32_t valueSize = 0;
+
+            if (data.size() < sizeof(valueSize)) {
+                clear();
+                return false;
+            }
+
+            std::memcpy(&valueSize, data.data(), sizeof(valueSize));
+            data.remove_prefix(sizeof(valueSize));
+
+            if (valueSize > data.size()) {
+                clear();
+                return false;
+            }
+
+            (attributes.*member).assign(data.substr(0, valueSize));
+            data.remove_prefix(valueSize);
+        }
+
+        if (!data.empty()) {
+            clear();
+            return false;
+        }
+
+        return true;
+    }
+
+    SLFMT_INLINE std::string LogFormat::GetThreadIdString() {
+        if (s_threadId != nullptr) {
+            return *s_threadId;
+        }
+
+        std::stringstream ss;
+        ss << std::this_thread::get_id();
+        return ss.str();
+    }
+
+    SLFMT_INLINE void LogFormat::AppendThreadId(std::string &out) {
+        if (s_threadId != nullptr) {
+            out += *s_threadId;
+            return;
+        }
+
+        out += GetThreadIdString();
+    }
+} // namespace slfmt
+
+#endif // SLFMT_LOG_FORMAT_INL_H
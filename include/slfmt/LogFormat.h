@@ -1,42 +1,55 @@
 #ifndef SLFMT_LOG_FORMAT_H
 #define SLFMT_LOG_FORMAT_H
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <fmt/format.h>
 #include <functional>
-#include <iomanip>
-#include <sstream>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "Config.h"
+#include "Context.h"
+#include "Field.h"
+#include "Json.h"
+
 namespace slfmt {
     class LogFormat {
     public:
         /**
          * @brief Gets the log format to use by the loggers.
          *
-         * @return The log format to use.
+         * @note The log formats are immutable snapshots. Each thread keeps a reference to the current one, and only
+         * takes the new one (locking) after Set(): otherwise Get() is an atomic load, without copying or locking.
+         * The returned format stays valid until the thread calls Get() again (use GetShared() to keep it longer).
+         * If no log format was set, the default one is used.
          *
-         * @note If the log format is empty (or not set yet), it will be initialized with
-         * the default log format.
+         * @return The log format to use.
          */
-        static LogFormat Get() {
-            if (s_format == nullptr || s_format->IsEmpty()) {
-                auto builder = Builder().Timestamp().Level().Class().ThreadId().Message();
-                s_format = std::make_unique<LogFormat>(builder.Build());
-            }
+        static const LogFormat &Get();
 
-            return *s_format;
-        }
+        /**
+         * @brief Gets a reference to the current log format snapshot, that keeps it alive.
+         *
+         * @return The log format to use.
+         */
+        static std::shared_ptr<const LogFormat> GetShared();
 
         /**
-         * @brief Sets the log format to use by the loggers. This will affect all loggers, so
-         * it is recommended to set the log format before creating any loggers.
+         * @brief Sets the log format to use by the loggers (except those with their own layout, see
+         * LoggerBase::SetLayout()). Can be called while other threads log: each message is formatted with
+         * either the previous format or the new one.
          *
          * @param format Log format to use.
          */
-        static void Set(const LogFormat &format) { s_format = std::make_unique<LogFormat>(format); }
+        static void Set(const LogFormat &format);
 
         /**
          * @brief Formats the log message with the specified replacements.
@@ -45,91 +58,267 @@ namespace slfmt {
          *
          * @return The formatted log message.
          */
-        FMT_NODISCARD std::string Format(const std::unordered_map<std::string_view, std::string_view> &replaces) const {
-            std::string formatted = m_format_string;
-
-            for (const auto &function: m_functions) {
-                formatted.replace(formatted.find("{}"), 2, function());
-            }
+        FMT_NODISCARD std::string Format(const std::unordered_map<std::string_view, std::string_view> &replaces) const;
 
-            for (const auto &[key, value]: replaces) {
-                formatted.replace(formatted.find(key), key.size(), value);
-            }
+        /**
+         * @brief Formats the log message with the specified replacements into a string, reusing its memory.
+         *
+         * @param formatted The string to format the message into (its previous contents are replaced).
+         * @param replaces Replacements to use.
+         */
+        void FormatTo(std::string &formatted,
+                      const std::unordered_map<std::string_view, std::string_view> &replaces) const;
 
-            return formatted;
+        /**
+         * @brief Gets the buffer of the calling thread to format messages into, so the loggers do not allocate a
+         * new string for every message.
+         *
+         * @note The buffer is only valid until the thread formats the next message.
+         *
+         * @return The buffer of the calling thread.
+         */
+        static std::string &ThreadBuffer() {
+            thread_local std::string buffer;
+            return buffer;
         }
 
-        FMT_NODISCARD bool IsEmpty() const { return m_format_string.empty(); }
+        /**
+         * @brief Gets the current timestamp (from the Clock, or the one fixed by a TimestampScope) as a string.
+         *
+         * @note The format is as follows: "YYYY-MM-DD HH:MM:SS,mmm".
+         *
+         * @return The current timestamp as a string.
+         */
+        static std::string GetTimestampString();
+
+        /**
+         * @brief Formats a time as the timestamp of a message ("YYYY-MM-DD HH:MM:SS,mmm", local time).
+         *
+         * @param time The time to format.
+         *
+         * @return The timestamp.
+         */
+        static std::string FormatTimestamp(std::chrono::system_clock::time_point time);
 
         /**
-         * @brief Builder for the log format.
+         * @brief Gets the time of the message being formatted: the one fixed by a TimestampScope, or the current
+         * time (from the Clock).
+         *
+         * @return The time of the message.
          */
-        class Builder {
+        static std::chrono::system_clock::time_point GetTime();
+
+        /**
+         * @brief Fixes the timestamp of the messages formatted by the current thread while the scope exists,
+         * instead of reading the Clock for each of them (used to write batches of messages, see LogBatch, and
+         * messages logged by other threads).
+         */
+        class TimestampScope {
         public:
-            Builder() = default;
+            /**
+             * @brief Fixes the timestamp of the messages.
+             *
+             * @param timestamp The formatted timestamp (see FormatTimestamp()). It must outlive the scope.
+             * @param time The time the timestamp shows (see GetTime()).
+             */
+            TimestampScope(const std::string &timestamp, const std::chrono::system_clock::time_point time)
+                : m_previous(s_timestamp), m_previousTime(s_time), m_previousUnformatted(s_unformatted) {
+                s_timestamp = &timestamp;
+                s_time = time;
+                s_unformatted = nullptr;
+            }
 
-            Builder &Timestamp(const std::string &leftDelimiter = "", const std::string &rightDelimiter = "") {
-                const auto delimited_string = Delimit("{}", leftDelimiter, rightDelimiter);
-                m_formats.push_back(delimited_string);
-                m_functions.emplace_back(GetTimestampString);
-                return *this;
+            /**
+             * @brief Fixes the time of the messages, whose timestamp is formatted by the first of them that shows it
+             * (a timestamp already fixed for the same time is kept).
+             *
+             * @param time The time of the messages.
+             */
+            explicit TimestampScope(const std::chrono::system_clock::time_point time)
+                : m_previous(s_timestamp), m_previousTime(s_time), m_previousUnformatted(s_unformatted) {
+                if (s_timestamp != nullptr && s_time == time) {
+                    return;
+                }
+
+                s_timestamp = &m_timestamp;
+                s_time = time;
+                s_unformatted = &m_timestamp;
             }
 
-            Builder &Level(const std::string &leftDelimiter = "", const std::string &rightDelimiter = "") {
-                const auto delimited_string = Delimit("{}", leftDelimiter, rightDelimiter);
-                m_formats.push_back(delimited_string);
-                m_functions.emplace_back([] {
-                    return "{L}";
-                });
-                return *this;
+            TimestampScope(const TimestampScope &) = delete;
+            TimestampScope &operator=(const TimestampScope &) = delete;
+
+            ~TimestampScope() {
+                s_timestamp = m_previous;
+                s_time = m_previousTime;
+                s_unformatted = m_previousUnformatted;
             }
 
-            Builder &Class(const std::string &leftDelimiter = "(", const std::string &rightDelimiter = ")") {
-                const auto delimited_string = Delimit("{}", leftDelimiter, rightDelimiter);
-                m_formats.push_back(delimited_string);
-                m_functions.emplace_back([] {
-                    return "{C}";
-                });
-                return *this;
+        private:
+            const std::string *m_previous;
+            std::chrono::system_clock::time_point m_previousTime;
+            std::string *m_previousUnformatted;
+
+            /**
+             * @brief The timestamp formatted on demand, when only the time is fixed.
+             */
+            std::string m_timestamp{};
+        };
+
+        /**
+         * @brief Gets the ID of the current thread (or the one fixed by a ThreadIdScope) as a string.
+         *
+         * @return The ID of the thread.
+         */
+        static std::string GetThreadIdString();
+
+        /**
+         * @brief Fixes the thread ID of the messages formatted by the current thread while the scope exists (used
+         * to write messages logged by other threads or processes, see ShmRing).
+         */
+        class ThreadIdScope {
+        public:
+            /**
+             * @brief Fixes the thread ID of the messages.
+             *
+             * @param threadId The thread ID. It must outlive the scope.
+             */
+            explicit ThreadIdScope(const std::string &threadId) : m_previous(s_threadId) {
+                s_threadId = &threadId;
             }
 
-            Builder &ThreadId(const std::string &leftDelimiter = "[Thread-", const std::string &rightDelimiter = "]") {
-                const auto delimited_string = Delimit("{}", leftDelimiter, rightDelimiter);
-                m_formats.push_back(delimited_string);
-                m_functions.emplace_back(GetThreadIdString);
-                return *this;
+            ThreadIdScope(const ThreadIdScope &) = delete;
+            ThreadIdScope &operator=(const ThreadIdScope &) = delete;
+
+            ~ThreadIdScope() {
+                s_threadId = m_previous;
             }
 
-            Builder &Message(const std::string &leftDelimiter = "", const std::string &rightDelimiter = "") {
-                const auto delimited_string = Delimit("{}", leftDelimiter, rightDelimiter);
-                m_formats.push_back(delimited_string);
-                m_functions.emplace_back([] {
-                    return "{M}";
-                });
-                return *this;
+        private:
+            const std::string *m_previous;
+        };
+
+        /**
+         * @brief The call site fields (see slfmt::Fields) and diagnostic context (see slfmt::Context) of a message,
+         * rendered, to format the message on another thread than the one that logged it.
+         */
+        struct Attributes {
+            std::string fieldsText;
+            std::string fieldsJson;
+            std::string contextText;
+            std::string contextJson;
+
+            /**
+             * @brief Renders the fields and context of the message being logged by the current thread.
+             *
+             * @return The rendered fields and context.
+             */
+            static Attributes Capture();
+
+            FMT_NODISCARD bool Empty() const {
+                return fieldsText.empty() && fieldsJson.empty() && contextText.empty() && contextJson.empty();
             }
 
-            FMT_NODISCARD LogFormat Build() const {
-                LogFormat logFormat;
+            /**
+             * @brief Gets the size of the attributes once serialized (see Serialize()).
+             *
+             * @return The size (0 if they are empty).
+             */
+            FMT_NODISCARD size_t SerializedSize() const;
 
-                // Each format is separated by a space (except for the last one).
-                for (size_t i = 0; i < m_formats.size(); i++) {
-                    logFormat.m_format_string += m_formats[i];
+            /**
+             * @brief Serializes the attributes, to copy them with a record: each string after its size (nothing if
+             * they are empty).
+             *
+             * @param data Where to write them (SerializedSize() bytes).
+             */
+            void Serialize(char *data) const;
 
-                    if (i != m_formats.size() - 1) {
-                        logFormat.m_format_string += " ";
-                    }
-                }
+            /**
+             * @brief Reads serialized attributes.
+             *
+             * @param data The attributes, as written by Serialize() (empty if the record has none).
+             * @param attributes The attributes read.
+             *
+             * @return False if the sizes of the strings do not match the data (the attributes are then empty).
+             */
+            static bool Deserialize(std::string_view data, Attributes &attributes);
+        };
 
-                logFormat.m_format_string += "\n"; // Add a newline at the end.
-                logFormat.m_functions = m_functions;
+        /**
+         * @brief Fixes the fields and context of the messages formatted by the current thread while the scope exists
+         * (used to write messages logged by other threads, see CombinedLogger and NumaBufferedSink).
+         */
+        class AttributesScope {
+        public:
+            /**
+             * @brief Fixes the fields and context of the messages.
+             *
+             * @param attributes The rendered fields and context. They must outlive the scope.
+             */
+            explicit AttributesScope(const Attributes &attributes) : m_previous(s_attributes) {
+                s_attributes = &attributes;
+            }
 
-                return logFormat;
+            AttributesScope(const AttributesScope &) = delete;
+            AttributesScope &operator=(const AttributesScope &) = delete;
+
+            ~AttributesScope() {
+                s_attributes = m_previous;
             }
 
+        private:
+            const Attributes *m_previous;
+        };
+
+        FMT_NODISCARD bool IsEmpty() const { return m_literals.empty() && m_functions.empty(); }
+
+        /**
+         * @brief Builder for the log format.
+         */
+        class Builder {
+        public:
+            Builder() = default;
+
+            Builder &Timestamp(const std::string &leftDelimiter = "", const std::string &rightDelimiter = "");
+
+            Builder &Level(const std::string &leftDelimiter = "", const std::string &rightDelimiter = "");
+
+            Builder &Class(const std::string &leftDelimiter = "(", const std::string &rightDelimiter = ")");
+
+            Builder &ThreadId(const std::string &leftDelimiter = "[Thread-", const std::string &rightDelimiter = "]");
+
+            Builder &Message(const std::string &leftDelimiter = "", const std::string &rightDelimiter = "");
+
+            /**
+             * @brief Adds the key/value fields passed at the call site (see slfmt::Fields). In text layouts
+             * they are rendered as space-separated <code>key=value</code> pairs.
+             */
+            Builder &Fields(const std::string &leftDelimiter = "", const std::string &rightDelimiter = "");
+
+            /**
+             * @brief Adds the diagnostic context of the logging thread (see slfmt::Context), rendered as
+             * space-separated <code>key=value</code> pairs (or as members of the object, in JSON layouts). The
+             * rendered context is cached until it changes.
+             */
+            Builder &Context(const std::string &leftDelimiter = "", const std::string &rightDelimiter = "");
+
+            FMT_NODISCARD LogFormat Build() const;
+
+            /**
+             * @brief Builds a JSON-lines log format: each message is written as a single JSON object
+             * containing the added elements, one per line. Delimiters are ignored.
+             *
+             * @note The call site fields are always included (at the end if Fields() was not added), as
+             * top-level members of the object.
+             */
+            FMT_NODISCARD LogFormat BuildJson() const;
+
         private:
             std::vector<std::string> m_formats{};
-            std::vector<std::function<std::string()>> m_functions{};
+            std::vector<std::function<void(std::string &)>> m_functions{};
+            std::vector<std::string_view> m_placeholders{};
+            std::vector<std::string> m_keys{};
 
             /**
              * @brief Delimits a string with the specified delimiters.
@@ -149,11 +338,43 @@ namespace slfmt {
     private:
         LogFormat() = default;
 
-        std::string m_format_string{};
-        std::vector<std::function<std::string()>> m_functions{};
+        /**
+         * @brief Key used for the call site fields element (they are spliced into the JSON object).
+         */
+        static constexpr std::string_view FIELDS_KEY{};
+
+        /**
+         * @brief Key used for the diagnostic context element (it is spliced into the JSON object).
+         */
+        static constexpr std::string_view CONTEXT_KEY = "context";
 
         /**
-         * @brief The format to use in the logs.
+         * @brief The text around the elements of a text layout: the literal i is written before the element i, and
+         * the last one after the last element.
+         */
+        std::vector<std::string> m_literals{};
+
+        /**
+         * @brief The function appending the value of each element to the message (null for the elements written from
+         * the record), so cached values like the context are appended without a temporary copy.
+         */
+        std::vector<std::function<void(std::string &)>> m_functions{};
+
+        /**
+         * @brief The placeholder of each element written from the record ({L}, {C} or {M}), replaced with its value
+         * in the replacements passed to Format(). Empty for the elements written by their function.
+         */
+        std::vector<std::string_view> m_placeholders{};
+
+        /**
+         * @brief JSON member names of each element (only used by JSON layouts).
+         */
+        std::vector<std::string> m_keys{};
+
+        bool m_json = false;
+
+        /**
+         * @brief The format to use in the logs (replaced, never modified, by Set()).
          *
          * @note It is first initialized as the default log format which is composed of the following:
          * <ol>
@@ -164,43 +385,141 @@ namespace slfmt {
          *  <li>Message: the message to log.</li>
          * </ol>
          */
-        static inline std::unique_ptr<LogFormat> s_format = nullptr;
+        static inline std::shared_ptr<const LogFormat> s_format = nullptr;
+
+        /**
+         * @brief Guards s_format (the first read sets the default).
+         */
+        static inline std::mutex s_formatMutex;
+
+        /**
+         * @brief Incremented by every Set(), so the threads know when to take the new format.
+         */
+        static inline std::atomic<std::uint64_t> s_version = 0;
+
+        /**
+         * @brief The timestamp fixed by the innermost TimestampScope of the thread (null if none).
+         */
+        static inline thread_local const std::string *s_timestamp = nullptr;
+
+        /**
+         * @brief The time of the timestamp fixed by the innermost TimestampScope of the thread (only valid with
+         * s_timestamp).
+         */
+        static inline thread_local std::chrono::system_clock::time_point s_time{};
+
+        /**
+         * @brief The timestamp of the innermost TimestampScope of the thread if it fixes only the time, empty until
+         * a message shows it (null otherwise).
+         */
+        static inline thread_local std::string *s_unformatted = nullptr;
 
         /**
-         * @brief Gets the current timestamp as a string.
+         * @brief Gets the timestamp fixed by the innermost TimestampScope of the thread (s_timestamp must be set),
+         * formatting it first if the scope only fixes the time.
          *
-         * @note The format is as follows: "YYYY-MM-DD HH:MM:SS,mmm".
+         * @return The fixed timestamp.
+         */
+        static const std::string &GetFixedTimestamp();
+
+        /**
+         * @brief The thread ID fixed by the innermost ThreadIdScope of the thread (null if none).
+         */
+        static inline thread_local const std::string *s_threadId = nullptr;
+
+        /**
+         * @brief The fields and context fixed by the innermost AttributesScope of the thread (null if none).
+         */
+        static inline thread_local const Attributes *s_attributes = nullptr;
+
+        /**
+         * @brief The strings of the attributes, in the order they are serialized.
+         */
+        static constexpr std::array<std::string Attributes::*, 4> ATTRIBUTES = {
+            &Attributes::fieldsText, &Attributes::fieldsJson, &Attributes::contextText, &Attributes::contextJson
+        };
+
+        /**
+         * @brief Formats the log message as a JSON object (followed by a newline).
          *
-         * @return The current timestamp as a string.
+         * @param formatted The string to format the message into (its previous contents are replaced).
+         * @param replaces Replacements to use for the placeholders of the elements.
          */
-        static std::string GetTimestampString() {
-            const auto now = std::chrono::system_clock::now();
-            const auto nowTime = std::chrono::system_clock::to_time_t(now);
-            const auto nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
-            tm tm = {};
+        void FormatJson(std::string &formatted,
+                        const std::unordered_map<std::string_view, std::string_view> &replaces) const;
 
-#ifdef _WIN32
-            localtime_s(&tm, &nowTime);
-#else
-            localtime_r(&nowTime, &tm);
-#endif
+        /**
+         * @brief Appends the value of an element: the replacement of its placeholder, or what its function appends.
+         *
+         * @param out The string to append to.
+         * @param index The index of the element.
+         * @param replaces Replacements to use for the placeholders.
+         */
+        void AppendValue(std::string &out, size_t index,
+                         const std::unordered_map<std::string_view, std::string_view> &replaces) const;
 
-            std::stringstream ss;
-            ss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << ',' << std::setfill('0') << std::setw(3) << nowMs.count();
-            return ss.str();
-        }
+        /**
+         * @brief Appends the current call site fields as JSON members.
+         *
+         * @param out The string to append to.
+         */
+        static void AppendJsonFields(std::string &out);
 
         /**
-         * @brief Gets the current thread ID as a string.
+         * @brief Gets the current call site fields as space-separated <code>key=value</code> pairs.
          *
-         * @return The current thread ID as a string.
+         * @return The fields as a string (empty if there are none).
          */
-        static std::string GetThreadIdString() {
-            std::stringstream ss;
-            ss << std::this_thread::get_id();
-            return ss.str();
-        }
+        static std::string GetFieldsString();
+
+        /**
+         * @brief Appends the current call site fields as space-separated <code>key=value</code> pairs.
+         *
+         * @param out The string to append to.
+         */
+        static void AppendFields(std::string &out);
+
+        /**
+         * @brief Gets the diagnostic context of the current thread (or the one fixed by an AttributesScope) as
+         * space-separated <code>key=value</code> pairs.
+         *
+         * @return The context as a string (empty if there is none).
+         */
+        static const std::string &GetContextText();
+
+        /**
+         * @brief Appends the diagnostic context text (see GetContextText()), without copying it first.
+         *
+         * @param out The string to append to.
+         */
+        static void AppendContext(std::string &out);
+
+        /**
+         * @brief Appends the current timestamp (see GetTimestampString()).
+         *
+         * @param out The string to append to.
+         */
+        static void AppendTimestamp(std::string &out);
+
+        /**
+         * @brief Appends the ID of the current thread (see GetThreadIdString()).
+         *
+         * @param out The string to append to.
+         */
+        static void AppendThreadId(std::string &out);
+
+        /**
+         * @brief Gets the diagnostic context of the current thread (or the one fixed by an AttributesScope) as JSON
+         * members.
+         *
+         * @return The context as JSON members (empty if there is none).
+         */
+        static const std::string &GetContextJson();
     };
 } // namespace slfmt
 
+#ifndef SLFMT_COMPILED_LIB
+    #include "LogFormat-inl.h"
+#endif
+
 #endif // SLFMT_LOG_FORMAT_H
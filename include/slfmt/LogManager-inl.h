@@ -0,0 +1,82 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * LogManager-inl.h - Implementation of the log manager
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_LOG_MANAGER_INL_H
+#define SLFMT_LOG_MANAGER_INL_H
+
+#include <slfmt/FileLogger.h>
+
+#include "LogManager.h"
+
+namespace slfmt {
+    SLFMT_INLINE std::unique_ptr<LoggerBase> LogManager::GetLogger(const std::string_view &clazz) {
+        return GetConsoleLogger(clazz);
+    }
+
+    SLFMT_INLINE std::unique_ptr<LoggerBase> LogManager::GetConsoleLogger(const std::string_view &clazz) {
+        return std::make_unique<ConsoleLogger>(clazz);
+    }
+
+    SLFMT_INLINE std::unique_ptr<LoggerBase> LogManager::GetFileLogger(const std::string_view &clazz,
+                                                                       const std::string_view &file,
+                                                                       const size_t bufferSize) {
+        return std::make_unique<FileLogger>(clazz, file, bufferSize);
+    }
+
+    SLFMT_INLINE std::unique_ptr<LoggerBase> LogManager::GetRollingFileLogger(const std::string_view &clazz,
+                                                                              const std::string_view &file,
+                                                                              const size_t fileSize,
+                                                                              const size_t bufferSize) {
+        return std::make_unique<RollingFileLogger>(clazz, file, fileSize, bufferSize);
+    }
+
+    SLFMT_INLINE std::unique_ptr<LoggerBase> LogManager::GetRollingFileLogger(
+            const std::string_view &clazz, const std::string_view &file, const RollingFileLogger::Options &options) {
+        return std::make_unique<RollingFileLogger>(clazz, file, options);
+    }
+
+#ifndef _WIN32
+    SLFMT_INLINE std::unique_ptr<LoggerBase> LogManager::GetSocketLogger(const std::string_view &clazz,
+                                                                         const std::string_view &socketPath) {
+        return std::make_unique<SocketLogger>(clazz, socketPath);
+    }
+
+    SLFMT_INLINE std::unique_ptr<LoggerBase> LogManager::GetSocketLogger(const std::string_view &clazz,
+                                                                         const std::string_view &socketPath,
+                                                                         const SocketLogger::Options &options) {
+        return std::make_unique<SocketLogger>(clazz, socketPath, options);
+    }
+
+    SLFMT_INLINE std::unique_ptr<LoggerBase> LogManager::GetShmLogger(const std::string_view &clazz,
+                                                                      const std::string_view &ringName,
+                                                                      const size_t capacity) {
+        return std::make_unique<ShmLogger>(clazz, ringName, capacity);
+    }
+#endif
+
+    SLFMT_INLINE std::unique_ptr<LoggerBase> LogManager::GetSinkLogger(const std::string_view &clazz,
+                                                                       std::shared_ptr<Sink> sink) {
+        return std::make_unique<SinkLogger>(clazz, std::move(sink));
+    }
+
+    SLFMT_INLINE std::unique_ptr<LoggerBase> LogManager::GetCombinedLogger(
+            const std::string_view &clazz, std::vector<std::unique_ptr<LoggerBase>> loggers) {
+        return std::make_unique<CombinedLogger>(clazz, std::move(loggers));
+    }
+
+    SLFMT_INLINE std::unique_ptr<LoggerBase> LogManager::GetCombinedLogger(
+            const std::string_view &clazz, std::vector<std::unique_ptr<LoggerBase>> loggers,
+            const CombinedLogger::Options &options) {
+        return std::make_unique<CombinedLogger>(clazz, std::move(loggers), options);
+    }
+} // namespace slfmt
+
+#endif // SLFMT_LOG_MANAGER_INL_H
@@ -13,9 +13,15 @@
 #define SLFMT_LOG_MANAGER_H
 
 #include <slfmt/CombinedLogger.h>
+#include <slfmt/Config.h>
 #include <slfmt/ConsoleLogger.h>
 #include <slfmt/LoggerBase.h>
 #include <slfmt/RollingFileLogger.h>
+#include <slfmt/ShmLogger.h>
+#include <slfmt/SinkLogger.h>
+#include <slfmt/SocketLogger.h>
+#include <slfmt/StaticLogger.h>
+#include <type_traits>
 
 #define SLFMT_CONSOLE_LOGGER(clazz) slfmt::LogManager::GetConsoleLogger(#clazz)
 #define SLFMT_FILE_LOGGER(clazz) slfmt::LogManager::GetFileLogger(#clazz)
@@ -43,25 +49,46 @@ namespace slfmt {
         LogManager() = delete;
         ~LogManager() = delete;
 
-        static std::unique_ptr<LoggerBase> GetLogger(const std::string_view &clazz) {
-            return GetConsoleLogger(clazz);
-        }
+        static std::unique_ptr<LoggerBase> GetLogger(const std::string_view &clazz);
 
-        static std::unique_ptr<LoggerBase> GetConsoleLogger(const std::string_view &clazz) {
-            return std::make_unique<ConsoleLogger>(clazz);
-        }
+        static std::unique_ptr<LoggerBase> GetConsoleLogger(const std::string_view &clazz);
 
         static std::unique_ptr<LoggerBase> GetFileLogger(const std::string_view &clazz,
-                                                         const std::string_view &file = s_defaultLoggerFilename) {
-            return std::make_unique<FileLogger>(clazz, file);
-        }
+                                                         const std::string_view &file = s_defaultLoggerFilename,
+                                                         const size_t bufferSize = 0);
 
         static std::unique_ptr<LoggerBase> GetRollingFileLogger(const std::string_view &clazz,
-                                                                const std::string_view &file, const size_t fileSize) {
-            return std::make_unique<RollingFileLogger>(clazz, file, fileSize);
-        }
+                                                                const std::string_view &file, const size_t fileSize,
+                                                                const size_t bufferSize = 0);
+
+        static std::unique_ptr<LoggerBase> GetRollingFileLogger(const std::string_view &clazz,
+                                                                const std::string_view &file,
+                                                                const RollingFileLogger::Options &options);
+
+#ifndef _WIN32
+        static std::unique_ptr<LoggerBase> GetSocketLogger(const std::string_view &clazz,
+                                                           const std::string_view &socketPath);
+
+        static std::unique_ptr<LoggerBase> GetSocketLogger(const std::string_view &clazz,
+                                                           const std::string_view &socketPath,
+                                                           const SocketLogger::Options &options);
+
+        static std::unique_ptr<LoggerBase> GetShmLogger(const std::string_view &clazz,
+                                                        const std::string_view &ringName,
+                                                        const size_t capacity = ShmRing::DEFAULT_CAPACITY);
+#endif
+
+        static std::unique_ptr<LoggerBase> GetSinkLogger(const std::string_view &clazz, std::shared_ptr<Sink> sink);
+
+        static std::unique_ptr<LoggerBase> GetCombinedLogger(const std::string_view &clazz,
+                                                             std::vector<std::unique_ptr<LoggerBase>> loggers);
+
+        static std::unique_ptr<LoggerBase> GetCombinedLogger(const std::string_view &clazz,
+                                                             std::vector<std::unique_ptr<LoggerBase>> loggers,
+                                                             const CombinedLogger::Options &options);
 
         template<typename... Loggers>
+            requires(std::is_convertible_v<Loggers &&, std::unique_ptr<LoggerBase>> && ...)
         static std::unique_ptr<LoggerBase> GetCombinedLogger(const std::string_view &clazz, Loggers &&...loggers) {
             std::vector<std::unique_ptr<LoggerBase>> combinedLoggers;
 
@@ -69,9 +96,32 @@ namespace slfmt {
             combinedLoggers.reserve(sizeof...(loggers));
             (combinedLoggers.push_back(std::forward<Loggers>(loggers)), ...);
 
-            return std::make_unique<CombinedLogger>(clazz, std::move(combinedLoggers));
+            return GetCombinedLogger(clazz, std::move(combinedLoggers));
+        }
+
+        /**
+         * @brief Creates a logger writing to a set of sinks known at compile time (see StaticLogger), e.g.
+         * <code>GetStaticLogger<FileLogger, ConsoleLogger>("Main", std::tuple("app.log"), std::tuple())</code>.
+         *
+         * @note The logger keeps its type, so calls through it do not go through the LoggerBase vtable, but it
+         * converts to a <code>std::unique_ptr<LoggerBase></code> where one is expected.
+         *
+         * @tparam Sinks The types of the sinks.
+         * @tparam Args The types of the tuples of arguments of the sinks.
+         * @param clazz The class to create a logger for.
+         * @param args A tuple with the constructor arguments of each sink (none to construct them from the class).
+         *
+         * @return The logger.
+         */
+        template<typename... Sinks, typename... Args>
+        static std::unique_ptr<StaticLogger<Sinks...>> GetStaticLogger(const std::string_view &clazz, Args &&...args) {
+            return std::make_unique<StaticLogger<Sinks...>>(clazz, std::forward<Args>(args)...);
         }
     };
 } // namespace slfmt
 
+#ifndef SLFMT_COMPILED_LIB
+    #include "LogManager-inl.h"
+#endif
+
 #endif // SLFMT_LOG_MANAGER_H
@@ -0,0 +1,308 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * LogVolume.h - Records and bytes logged per class
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_LOG_VOLUME_H
+#define SLFMT_LOG_VOLUME_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fmt/format.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Level.h"
+#include "Sink.h"
+
+namespace slfmt {
+    /**
+     * @brief Counts the records and bytes logged by every class, per level, to find the loggers that log the most.
+     *
+     * @note Every logger counts the records it writes (after the level and repeat filters) in the counters of its
+     * class, shared by all the loggers of the class: two relaxed atomic additions per record. The bytes are those
+     * of the formatted messages, without the layout. Use Snapshot() or Top() to read the counters, Report() to
+     * format the top classes, or a Reporter to log the report periodically.
+     */
+    class LogVolume {
+    public:
+        static constexpr size_t LEVELS = static_cast<size_t>(Level::UNKNOWN);
+
+        /**
+         * @brief The counters of a class.
+         */
+        class Counters {
+        public:
+            /**
+             * @brief Counts a record.
+             *
+             * @param level The level of the record.
+             * @param bytes The size of its message.
+             */
+            void Add(const Level level, const size_t bytes) {
+                const auto index = std::min(static_cast<size_t>(level), LEVELS - 1);
+                m_records[index].fetch_add(1, std::memory_order_relaxed);
+                m_bytes[index].fetch_add(bytes, std::memory_order_relaxed);
+            }
+
+        private:
+            friend class LogVolume;
+
+            std::array<std::atomic<std::uint64_t>, LEVELS> m_records{};
+            std::array<std::atomic<std::uint64_t>, LEVELS> m_bytes{};
+        };
+
+        /**
+         * @brief The volume of a class at some point.
+         */
+        struct Entry {
+            std::string clazz;
+            std::array<std::uint64_t, LEVELS> records{};
+            std::array<std::uint64_t, LEVELS> bytes{};
+
+            FMT_NODISCARD std::uint64_t TotalRecords() const {
+                return Sum(records);
+            }
+
+            FMT_NODISCARD std::uint64_t TotalBytes() const {
+                return Sum(bytes);
+            }
+
+        private:
+            static std::uint64_t Sum(const std::array<std::uint64_t, LEVELS> &values) {
+                std::uint64_t sum = 0;
+
+                for (const auto value: values) {
+                    sum += value;
+                }
+
+                return sum;
+            }
+        };
+
+        /**
+         * @brief What the classes are ranked by.
+         */
+        enum class Order { RECORDS, BYTES };
+
+        LogVolume() = delete;
+
+        /**
+         * @brief Gets the counters of a class (created the first time).
+         *
+         * @note Loggers get them when they are constructed. The counters live until the program exits.
+         *
+         * @param clazz The class.
+         *
+         * @return The counters.
+         */
+        static Counters &For(const std::string_view clazz) {
+            auto &registry = GetRegistry();
+            const std::lock_guard lock(registry.mutex);
+            auto counters = registry.counters.find(clazz);
+
+            if (counters == registry.counters.end()) {
+                counters = registry.counters.emplace(std::string(clazz), std::make_unique<Counters>()).first;
+            }
+
+            return *counters->second;
+        }
+
+        /**
+         * @brief Reads the counters of all the classes that logged something.
+         *
+         * @return The volume of each class, by class name.
+         */
+        static std::vector<Entry> Snapshot() {
+            auto &registry = GetRegistry();
+            const std::lock_guard lock(registry.mutex);
+            std::vector<Entry> entries;
+
+            for (const auto &[clazz, counters]: registry.counters) {
+                Entry entry{ clazz };
+
+                for (size_t i = 0; i < LEVELS; i++) {
+                    entry.records[i] = counters->m_records[i].load(std::memory_order_relaxed);
+                    entry.bytes[i] = counters->m_bytes[i].load(std::memory_order_relaxed);
+                }
+
+                if (entry.TotalRecords() > 0) {
+                    entries.push_back(std::move(entry));
+                }
+            }
+
+            return entries;
+        }
+
+        /**
+         * @brief Gets the classes that logged the most.
+         *
+         * @param count The maximum number of classes.
+         * @param order What the classes are ranked by.
+         *
+         * @return The volume of the top classes, the largest first.
+         */
+        static std::vector<Entry> Top(const size_t count, const Order order = Order::BYTES) {
+            auto entries = Snapshot();
+            const auto key = [order](const Entry &entry) {
+                return order == Order::BYTES ? entry.TotalBytes() : entry.TotalRecords();
+            };
+
+            std::stable_sort(entries.begin(), entries.end(), [&key](const Entry &a, const Entry &b) {
+                return key(a) > key(b);
+            });
+
+            entries.resize(std::min(count, entries.size()));
+            return entries;
+        }
+
+        /**
+         * @brief Formats a report of the classes that logged the most, one line per class, e.g.
+         * <code>Parser: 1200 records, 48000 bytes (INFO 1000/40000, WARN 200/8000)</code>.
+         *
+         * @param count The maximum number of classes.
+         * @param order What the classes are ranked by.
+         *
+         * @return The report.
+         */
+        static std::string Report(const size_t count = 10, const Order order = Order::BYTES) {
+            const auto entries = Top(count, order);
+            std::string report =
+                    fmt::format("Log volume, top {} classes by {}:", entries.size(),
+                                order == Order::BYTES ? "bytes" : "records");
+
+            for (const auto &entry: entries) {
+                fmt::format_to(std::back_inserter(report), "\n  {}: {} records, {} bytes (", entry.clazz,
+                               entry.TotalRecords(), entry.TotalBytes());
+                const char *separator = "";
+
+                for (size_t i = 0; i < LEVELS; i++) {
+                    if (entry.records[i] > 0) {
+                        fmt::format_to(std::back_inserter(report), "{}{} {}/{}", separator,
+                                       LevelToString(static_cast<Level>(i)), entry.records[i], entry.bytes[i]);
+                        separator = ", ";
+                    }
+                }
+
+                report += ')';
+            }
+
+            return report;
+        }
+
+        /**
+         * @brief Sets all the counters to 0 (e.g. to measure an interval).
+         */
+        static void Reset() {
+            auto &registry = GetRegistry();
+            const std::lock_guard lock(registry.mutex);
+
+            for (const auto &[clazz, counters]: registry.counters) {
+                for (size_t i = 0; i < LEVELS; i++) {
+                    counters->m_records[i].store(0, std::memory_order_relaxed);
+                    counters->m_bytes[i].store(0, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * @brief Writes the report of the top classes to a sink (e.g. a logger) at a fixed interval, from a
+         * background thread, while it exists.
+         */
+        class Reporter {
+        public:
+            /**
+             * @brief Starts reporting.
+             *
+             * @param sink Where to write the report (as an INFO record of the class "LogVolume"). It must outlive
+             * the reporter.
+             * @param count The maximum number of classes of each report.
+             * @param interval The time between two reports.
+             * @param order What the classes are ranked by.
+             */
+            Reporter(Sink &sink, const size_t count, const std::chrono::milliseconds interval,
+                     const Order order = Order::BYTES)
+                : m_sink(sink), m_count(count), m_interval(interval), m_order(order),
+                  m_thread(&Reporter::Run, this) {}
+
+            Reporter(const Reporter &) = delete;
+            Reporter &operator=(const Reporter &) = delete;
+
+            ~Reporter() {
+                {
+                    const std::lock_guard lock(m_mutex);
+                    m_stop = true;
+                }
+
+                m_wakeUp.notify_one();
+                m_thread.join();
+            }
+
+        private:
+            Sink &m_sink;
+            const size_t m_count;
+            const std::chrono::milliseconds m_interval;
+            const Order m_order;
+
+            std::mutex m_mutex;
+            std::condition_variable m_wakeUp;
+            bool m_stop = false;
+
+            /**
+             * @brief The reporting thread (declared last, so everything it uses is initialized before and destroyed
+             * after it).
+             */
+            std::thread m_thread;
+
+            void Run() {
+                std::unique_lock lock(m_mutex);
+
+                while (!m_wakeUp.wait_for(lock, m_interval, [this] {
+                    return m_stop;
+                })) {
+                    if (!m_sink.IsEnabled(Level::INFO)) {
+                        continue;
+                    }
+
+                    const auto report = Report(m_count, m_order);
+
+                    try {
+                        m_sink.Write({ Level::INFO, "LogVolume", report });
+                    } catch (...) {
+                        // Nobody to report the error to: the next report is tried anyway.
+                    }
+                }
+            }
+        };
+
+    private:
+        struct Registry {
+            std::mutex mutex;
+            std::map<std::string, std::unique_ptr<Counters>, std::less<>> counters;
+        };
+
+        static Registry &GetRegistry() {
+            // Never destroyed: static loggers still count their last records while the program exits.
+            static auto *registry = new Registry();
+            return *registry;
+        }
+    };
+} // namespace slfmt
+
+#endif // SLFMT_LOG_VOLUME_H
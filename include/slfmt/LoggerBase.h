@@ -12,122 +12,287 @@
 #ifndef SLFMT_LOGGER_BASE_H
 #define SLFMT_LOGGER_BASE_H
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <fmt/format.h>
 #include <iomanip>
+#include <iterator>
 #include <memory>
 #include <sstream>
 #include <string>
 #include <thread>
 
 #include "Color.h"
+#include "Field.h"
 #include "Files.h"
 #include "Level.h"
-
-#define FORMAT_MAPPED_PARAMS_FOR_LEVEL(level)                                                                          \
-    {                                                                                                                  \
-        { "{L}", level }, { "{C}", GetClass() }, {                                                                     \
-            "{M}", msg                                                                                                 \
-        }                                                                                                              \
-    }
+#include "LogBatch.h"
+#include "LogVolume.h"
+#include "RepeatFilter.h"
+#include "Sink.h"
 
 namespace slfmt {
-    class LoggerBase {
+    /**
+     * @brief The base of the loggers: formats the messages and writes them as records (see Sink).
+     *
+     * @note Loggers are sinks themselves, so they can be shared by several loggers (see SinkLogger) or combined
+     * (see CombinedLogger).
+     */
+    class LoggerBase : public Sink {
     private:
+        friend class LogBatch;
+
         /**
          * @brief Class name for the logger.
          */
         const std::string m_class;
 
         /**
-         * @brief Logs a message at the specified level.
+         * @brief The minimum level of the messages the logger writes.
+         */
+        std::atomic<Level> m_level = Level::TRACE;
+
+        /**
+         * @brief The filter of repeated messages (null if repeated messages are written).
+         */
+        std::unique_ptr<RepeatFilter> m_repeats;
+
+        /**
+         * @brief The volume counters of the class (see LogVolume).
+         */
+        LogVolume::Counters &m_volume;
+
+        /**
+         * @brief The layout of the logger (null to use the global LogFormat).
+         */
+        std::shared_ptr<const LogFormat> m_layout;
+
+        /**
+         * @brief Writes a formatted message as a record of the logger.
+         *
+         * @param level The level of the message.
+         * @param msg The message to write.
+         */
+        void WriteMessage(const Level level, const std::string_view msg) {
+            m_volume.Add(level, msg.size());
+            Write(Record{ level, m_class, msg });
+        }
+
+        /**
+         * @brief Formats a message and logs it at the specified level (unless it repeats the previous one).
          *
          * @param level The level to log at.
-         * @param msg The message to log.
-         */
-        void Log_Internal(const Level &level, const std::string_view msg) {
-            if (level == Level::TRACE) {
-                Trace_Internal(msg);
-            } else if (level == Level::DEBUG) {
-                Debug_Internal(msg);
-            } else if (level == Level::INFO) {
-                Info_Internal(msg);
-            } else if (level == Level::WARN) {
-                Warn_Internal(msg);
-            } else if (level == Level::ERROR) {
-                Error_Internal(msg);
-            } else if (level == Level::FATAL) {
-                Fatal_Internal(msg);
+         * @param format The format string.
+         * @param args The arguments to format the message with.
+         */
+        void FormatAndWrite(const Level level, const std::string_view format, const fmt::format_args args) {
+            if (m_repeats == nullptr) {
+                WriteMessage(level, fmt::vformat(format, args));
+                return;
+            }
+
+            // Repetitions identified by their format string are not even formatted.
+            std::string msg;
+            RepeatFilter::Decision decision;
+
+            if (m_repeats->GetKey() == RepeatFilter::Key::FORMAT) {
+                decision = m_repeats->Check(level, format);
+
+                if (decision.write) {
+                    msg = fmt::vformat(format, args);
+                }
+            } else {
+                msg = fmt::vformat(format, args);
+                decision = m_repeats->Check(level, msg);
+            }
+
+            if (decision.repeated > 0) {
+                WriteMessage(decision.repeatedLevel, RepeatFilter::Summary(decision.repeated));
+            }
+
+            if (decision.write) {
+                WriteMessage(level, msg);
             }
         }
 
+    protected:
         /**
-         * @brief Logs a message at the TRACE level.
+         * @brief Constructs a new logger for the specified class.
          *
-         * @param msg The message to log.
+         * @param clazz The class to create a logger for.
          */
-        virtual void Trace_Internal(std::string_view msg) = 0;
+        explicit LoggerBase(const std::string_view clazz) : m_class(clazz), m_volume(LogVolume::For(clazz)) {}
 
         /**
-         * @brief Logs a message at the DEBUG level.
+         * @brief Writes the summary of the repetitions that have not been summarized yet (if any).
          *
-         * @param msg The message to log.
+         * @note Loggers call it when they are destroyed, while they can still write.
          */
-        virtual void Debug_Internal(std::string_view msg) = 0;
+        void FlushRepeats() {
+            if (m_repeats == nullptr) {
+                return;
+            }
+
+            const auto pending = m_repeats->TakeRepeated();
+
+            if (pending.repeated > 0) {
+                WriteMessage(pending.repeatedLevel, RepeatFilter::Summary(pending.repeated));
+            }
+        }
 
         /**
-         * @brief Logs a message at the INFO level.
+         * @brief Formats the records of a batch that the logger writes with the current LogFormat, one after the
+         * other.
+         *
+         * @param clazz The class of the records.
+         * @param batch The records to format.
          *
-         * @param msg The message to log.
+         * @return The formatted records (empty if the logger writes none of them).
          */
-        virtual void Info_Internal(std::string_view msg) = 0;
+        FMT_NODISCARD std::string FormatBatch(const std::string_view clazz, const LogBatch &batch) const {
+            const auto &format = GetLayout();
+            auto &line = LogFormat::ThreadBuffer();
+            std::string lines;
+
+            batch.ForEach([&](const Level level, const std::string_view msg) {
+                if (!IsEnabled(level)) {
+                    return;
+                }
+
+                const Record record{ level, clazz, msg };
+                format.FormatTo(line, FORMAT_MAPPED_PARAMS_FOR_RECORD(record));
+                lines += line;
+            });
+
+            return lines;
+        }
+
+    public:
+        ~LoggerBase() override = default;
 
         /**
-         * @brief Logs a message at the WARN level.
+         * @brief Gets the class name for the logger.
          *
-         * @param msg The message to log.
+         * @return The class name for the logger.
          */
-        virtual void Warn_Internal(std::string_view msg) = 0;
+        FMT_NODISCARD std::string_view GetClass() const {
+            return m_class;
+        }
 
         /**
-         * @brief Logs a message at the ERROR level.
+         * @brief Writes the records of a batch (see Batch()).
          *
-         * @param msg The message to log.
+         * @note By default each record is written on its own. Loggers override it to write the whole batch at once.
+         * Records of levels the logger does not write must be skipped (a batch can be forwarded by a
+         * CombinedLogger to loggers with different levels).
+         *
+         * @param clazz The class of the records.
+         * @param batch The records to write.
          */
-        virtual void Error_Internal(std::string_view msg) = 0;
+        void WriteBatch(const std::string_view clazz, const LogBatch &batch) override {
+            batch.ForEach([this, clazz](const Level level, const std::string_view msg) {
+                if (IsEnabled(level)) {
+                    Write({ level, clazz, msg });
+                }
+            });
+        }
 
         /**
-         * @brief Logs a message at the FATAL level.
+         * @brief Sets the minimum level of the messages the logger writes. Messages of lower levels are discarded
+         * before formatting them.
          *
-         * @param msg The message to log.
+         * @param level The minimum level (TRACE, the default, writes every message).
          */
-        virtual void Fatal_Internal(std::string_view msg) = 0;
+        void SetLevel(const Level level) {
+            m_level.store(level, std::memory_order_relaxed);
+        }
 
-    protected:
         /**
-         * @brief Constructs a new logger for the specified class.
+         * @brief Gets the minimum level of the messages the logger writes.
          *
-         * @param clazz The class to create a logger for.
+         * @return The minimum level.
          */
-        explicit LoggerBase(const std::string_view clazz) : m_class(clazz) {}
+        FMT_NODISCARD Level GetLevel() const {
+            return m_level.load(std::memory_order_relaxed);
+        }
 
         /**
-         * @brief Gets the class name for the logger.
+         * @brief Gives the logger its own layout, instead of the global LogFormat (see LogFormat::Set()).
          *
-         * @return The class name for the logger.
+         * @note Must be called before logging with the logger. Loggers writing to a shared sink (see SinkLogger)
+         * are formatted with the layout of the sink.
+         *
+         * @param layout The layout of the logger (null to use the global LogFormat again).
          */
-        FMT_NODISCARD std::string_view GetClass() const {
-            return m_class;
+        void SetLayout(std::shared_ptr<const LogFormat> layout) {
+            m_layout = std::move(layout);
         }
 
-    public:
-        LoggerBase(const LoggerBase &) = delete;
-        LoggerBase(LoggerBase &&) = delete;
+        /**
+         * @brief Gives the logger its own layout, instead of the global LogFormat (see LogFormat::Set()).
+         *
+         * @note Must be called before logging with the logger.
+         *
+         * @param layout The layout of the logger.
+         */
+        void SetLayout(const LogFormat &layout) {
+            SetLayout(std::make_shared<const LogFormat>(layout));
+        }
 
-        LoggerBase &operator=(const LoggerBase &) = delete;
-        LoggerBase &operator=(LoggerBase &&) = delete;
+        /**
+         * @brief Gets the layout the logger formats its messages with.
+         *
+         * @return The layout of the logger, or the global LogFormat if it has none.
+         */
+        FMT_NODISCARD const LogFormat &GetLayout() const {
+            return m_layout != nullptr ? *m_layout : LogFormat::Get();
+        }
 
-        virtual ~LoggerBase() = default;
+        /**
+         * @brief Collapses identical consecutive messages into the first one and a periodic "Last message repeated N
+         * times" summary (see RepeatFilter).
+         *
+         * @note Must be called before logging with the logger.
+         *
+         * @param options The options of the filter.
+         */
+        void SuppressRepeats(const RepeatFilter::Options &options = {}) {
+            m_repeats = std::make_unique<RepeatFilter>(options);
+        }
+
+        /**
+         * @brief Checks if the logger writes messages of the specified level.
+         *
+         * @param level The level to check.
+         *
+         * @return True if messages of the level are written.
+         */
+        FMT_NODISCARD bool IsEnabled(const Level level) const override {
+            return level >= GetLevel();
+        }
+
+        /**
+         * @brief Starts a batch of messages, written all at once when the batch is committed or destroyed (see
+         * LogBatch).
+         *
+         * <pre>
+         * {
+         *     auto batch = logger.Batch(LogBatch::Timestamp::SNAPSHOT);
+         *
+         *     for (const auto &item: items) {
+         *         batch.Info("Processed {}", item);
+         *     }
+         * } // All the messages are written here.
+         * </pre>
+         *
+         * @param timestamp How the messages are timestamped.
+         *
+         * @return The batch.
+         */
+        FMT_NODISCARD LogBatch Batch(const LogBatch::Timestamp timestamp = LogBatch::Timestamp::PER_RECORD) {
+            return { *this, timestamp };
+        }
 
         /**
          * @brief Logs a message at the specified level.
@@ -139,7 +304,11 @@ namespace slfmt {
          */
         template<typename... Args>
         void Log(const Level &level, const std::string_view format, Args &&...args) {
-            Log_Internal(level, (std::string) fmt::vformat(format, fmt::make_format_args(args...)));
+            if (!IsEnabled(level)) {
+                return;
+            }
+
+            FormatAndWrite(level, format, fmt::make_format_args(args...));
         }
 
         /**
@@ -151,7 +320,11 @@ namespace slfmt {
          */
         template<typename... Args>
         void Trace(const std::string_view format, Args &&...args) {
-            Trace_Internal((std::string) fmt::vformat(format, fmt::make_format_args(args...)));
+            if (!IsEnabled(Level::TRACE)) {
+                return;
+            }
+
+            FormatAndWrite(Level::TRACE, format, fmt::make_format_args(args...));
         }
 
         /**
@@ -163,7 +336,11 @@ namespace slfmt {
          */
         template<typename... Args>
         void Debug(const std::string_view format, Args &&...args) {
-            Debug_Internal((std::string) fmt::vformat(format, fmt::make_format_args(args...)));
+            if (!IsEnabled(Level::DEBUG)) {
+                return;
+            }
+
+            FormatAndWrite(Level::DEBUG, format, fmt::make_format_args(args...));
         }
 
         /**
@@ -175,7 +352,11 @@ namespace slfmt {
          */
         template<typename... Args>
         void Info(const std::string_view format, Args &&...args) {
-            Info_Internal((std::string) fmt::vformat(format, fmt::make_format_args(args...)));
+            if (!IsEnabled(Level::INFO)) {
+                return;
+            }
+
+            FormatAndWrite(Level::INFO, format, fmt::make_format_args(args...));
         }
 
         /**
@@ -187,7 +368,11 @@ namespace slfmt {
          */
         template<typename... Args>
         void Warn(const std::string_view format, Args &&...args) {
-            Warn_Internal((std::string) fmt::vformat(format, fmt::make_format_args(args...)));
+            if (!IsEnabled(Level::WARN)) {
+                return;
+            }
+
+            FormatAndWrite(Level::WARN, format, fmt::make_format_args(args...));
         }
 
         /**
@@ -199,7 +384,11 @@ namespace slfmt {
          */
         template<typename... Args>
         void Error(const std::string_view format, Args &&...args) {
-            Error_Internal((std::string) fmt::vformat(format, fmt::make_format_args(args...)));
+            if (!IsEnabled(Level::ERROR)) {
+                return;
+            }
+
+            FormatAndWrite(Level::ERROR, format, fmt::make_format_args(args...));
         }
 
         /**
@@ -211,9 +400,147 @@ namespace slfmt {
          */
         template<typename... Args>
         void Fatal(const std::string_view format, Args &&...args) {
-            Fatal_Internal((std::string) fmt::vformat(format, fmt::make_format_args(args...)));
+            if (!IsEnabled(Level::FATAL)) {
+                return;
+            }
+
+            FormatAndWrite(Level::FATAL, format, fmt::make_format_args(args...));
+        }
+
+        /**
+         * @brief Logs a message with key/value fields at the specified level.
+         *
+         * @tparam Args The types of the arguments to format the message with.
+         * @param level The level to log at.
+         * @param fields The fields to attach to the message.
+         * @param format The format string.
+         * @param args The arguments to format the message with.
+         */
+        template<typename... Args>
+        void Log(const Level &level, const Fields &fields, const std::string_view format, Args &&...args) {
+            const Fields::Scope scope(fields);
+            Log(level, format, std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Logs a message with key/value fields at the TRACE level.
+         *
+         * @tparam Args The types of the arguments to format the message with.
+         * @param fields The fields to attach to the message.
+         * @param format The format string.
+         * @param args The arguments to format the message with.
+         */
+        template<typename... Args>
+        void Trace(const Fields &fields, const std::string_view format, Args &&...args) {
+            const Fields::Scope scope(fields);
+            Trace(format, std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Logs a message with key/value fields at the DEBUG level.
+         *
+         * @tparam Args The types of the arguments to format the message with.
+         * @param fields The fields to attach to the message.
+         * @param format The format string.
+         * @param args The arguments to format the message with.
+         */
+        template<typename... Args>
+        void Debug(const Fields &fields, const std::string_view format, Args &&...args) {
+            const Fields::Scope scope(fields);
+            Debug(format, std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Logs a message with key/value fields at the INFO level.
+         *
+         * @tparam Args The types of the arguments to format the message with.
+         * @param fields The fields to attach to the message.
+         * @param format The format string.
+         * @param args The arguments to format the message with.
+         */
+        template<typename... Args>
+        void Info(const Fields &fields, const std::string_view format, Args &&...args) {
+            const Fields::Scope scope(fields);
+            Info(format, std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Logs a message with key/value fields at the WARN level.
+         *
+         * @tparam Args The types of the arguments to format the message with.
+         * @param fields The fields to attach to the message.
+         * @param format The format string.
+         * @param args The arguments to format the message with.
+         */
+        template<typename... Args>
+        void Warn(const Fields &fields, const std::string_view format, Args &&...args) {
+            const Fields::Scope scope(fields);
+            Warn(format, std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Logs a message with key/value fields at the ERROR level.
+         *
+         * @tparam Args The types of the arguments to format the message with.
+         * @param fields The fields to attach to the message.
+         * @param format The format string.
+         * @param args The arguments to format the message with.
+         */
+        template<typename... Args>
+        void Error(const Fields &fields, const std::string_view format, Args &&...args) {
+            const Fields::Scope scope(fields);
+            Error(format, std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Logs a message with key/value fields at the FATAL level.
+         *
+         * @tparam Args The types of the arguments to format the message with.
+         * @param fields The fields to attach to the message.
+         * @param format The format string.
+         * @param args The arguments to format the message with.
+         */
+        template<typename... Args>
+        void Fatal(const Fields &fields, const std::string_view format, Args &&...args) {
+            const Fields::Scope scope(fields);
+            Fatal(format, std::forward<Args>(args)...);
         }
     };
+
+    inline void LogBatch::Add(const Level level, const std::string_view format, const fmt::format_args args) {
+        if (!m_logger.IsEnabled(level)) {
+            return;
+        }
+
+        const auto offset = m_messages.size();
+        fmt::vformat_to(std::back_inserter(m_messages), format, args);
+        m_logger.m_volume.Add(level, m_messages.size() - offset);
+
+        const auto time = m_timestamp == Timestamp::SNAPSHOT ? m_snapshot : Clock::Now();
+        m_records.push_back({ level, time, offset, m_messages.size() - offset });
+        m_maxLevel = std::max(m_maxLevel, level);
+    }
+
+    inline void LogBatch::Commit() {
+        if (m_records.empty()) {
+            return;
+        }
+
+        try {
+            m_logger.WriteBatch(m_logger.GetClass(), *this);
+        } catch (...) {
+            Clear(); // Not written again by the destructor.
+            throw;
+        }
+
+        Clear();
+    }
+
+    inline void LogBatch::Clear() {
+        m_messages.clear();
+        m_records.clear();
+        m_maxLevel = Level::TRACE;
+    }
 } // namespace slfmt
 
 #endif // SLFMT_LOGGER_BASE_H
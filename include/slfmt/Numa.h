@@ -0,0 +1,327 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * Numa.h - NUMA topology and huge page backed buffers
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_NUMA_H
+#define SLFMT_NUMA_H
+
+#ifndef _WIN32
+
+    #include <cerrno>
+    #include <charconv>
+    #include <cstring>
+    #include <filesystem>
+    #include <fmt/format.h>
+    #include <fstream>
+    #include <map>
+    #include <sched.h>
+    #include <stdexcept>
+    #include <string>
+    #include <string_view>
+    #include <sys/mman.h>
+    #include <vector>
+
+namespace slfmt {
+    /**
+     * @brief The NUMA nodes of the machine and their CPUs, as reported by Linux in
+     * <code>/sys/devices/system/node</code>.
+     *
+     * @note Nodes are numbered from 0 to NodeCount() - 1, in the order of the kernel's node IDs. Without NUMA
+     * information (other systems, or a kernel without NUMA support) the machine is a single node with all the CPUs.
+     */
+    class NumaTopology {
+    public:
+        /**
+         * @brief Gets the topology of the machine (read once).
+         *
+         * @return The topology.
+         */
+        static const NumaTopology &Get() {
+            static const NumaTopology topology = Read("/sys/devices/system/node");
+            return topology;
+        }
+
+        /**
+         * @brief Reads the topology from a directory laid out like <code>/sys/devices/system/node</code>.
+         *
+         * @param directory The directory with a <code>nodeN/cpulist</code> file per node.
+         *
+         * @return The topology (a single node if the directory has no nodes).
+         */
+        static NumaTopology Read(const std::filesystem::path &directory) {
+            std::map<int, std::vector<int>> nodes;
+            std::error_code error;
+
+            for (const auto &entry: std::filesystem::directory_iterator(directory, error)) {
+                const auto name = entry.path().filename().string();
+                int id = 0;
+
+                if (name.rfind("node", 0) != 0 || !ParseInt(std::string_view(name).substr(4), id)) {
+                    continue;
+                }
+
+                std::ifstream file(entry.path() / "cpulist");
+                std::string cpuList;
+
+                if (std::getline(file, cpuList)) {
+                    nodes[id] = ParseCpuList(cpuList);
+                }
+            }
+
+            NumaTopology topology;
+
+            for (auto &[id, cpus]: nodes) {
+                for (const int cpu: cpus) {
+                    if (static_cast<size_t>(cpu) >= topology.m_cpuNodes.size()) {
+                        topology.m_cpuNodes.resize(cpu + 1, 0);
+                    }
+
+                    topology.m_cpuNodes[cpu] = topology.m_nodeCpus.size();
+                }
+
+                topology.m_nodeCpus.push_back(std::move(cpus));
+            }
+
+            if (topology.m_nodeCpus.empty()) {
+                topology.m_nodeCpus.emplace_back();
+            }
+
+            return topology;
+        }
+
+        /**
+         * @brief Parses a list of CPUs in the kernel's format (e.g. "0-3,8,10-11").
+         *
+         * @param cpuList The list.
+         *
+         * @return The CPUs, in the order of the list (invalid ranges are ignored).
+         */
+        static std::vector<int> ParseCpuList(std::string_view cpuList) {
+            std::vector<int> cpus;
+
+            while (!cpuList.empty()) {
+                const auto comma = cpuList.find(',');
+                const auto range = cpuList.substr(0, comma);
+                cpuList = comma == std::string_view::npos ? std::string_view() : cpuList.substr(comma + 1);
+
+                const auto dash = range.find('-');
+                int first = 0;
+                int last = 0;
+
+                if (!ParseInt(range.substr(0, dash), first) ||
+                    !ParseInt(dash == std::string_view::npos ? range : range.substr(dash + 1), last)) {
+                    continue;
+                }
+
+                for (int cpu = first; cpu <= last; cpu++) {
+                    cpus.push_back(cpu);
+                }
+            }
+
+            return cpus;
+        }
+
+        /**
+         * @brief Gets the number of nodes.
+         *
+         * @return The number of nodes (at least 1).
+         */
+        FMT_NODISCARD size_t NodeCount() const {
+            return m_nodeCpus.size();
+        }
+
+        /**
+         * @brief Gets the CPUs of a node.
+         *
+         * @param node The node.
+         *
+         * @return The CPUs (empty if unknown).
+         */
+        FMT_NODISCARD const std::vector<int> &NodeCpus(const size_t node) const {
+            return m_nodeCpus.at(node);
+        }
+
+        /**
+         * @brief Gets the node of a CPU.
+         *
+         * @param cpu The CPU.
+         *
+         * @return The node (0 if unknown).
+         */
+        FMT_NODISCARD size_t NodeOf(const int cpu) const {
+            return cpu >= 0 && static_cast<size_t>(cpu) < m_cpuNodes.size() ? m_cpuNodes[cpu] : 0;
+        }
+
+        /**
+         * @brief Gets the node the calling thread is running on (<code>sched_getcpu</code>, a vDSO call on Linux).
+         *
+         * @return The node (0 if unknown).
+         */
+        FMT_NODISCARD size_t CurrentNode() const {
+    #ifdef __linux__
+            return m_nodeCpus.size() > 1 ? NodeOf(sched_getcpu()) : 0;
+    #else
+            return 0;
+    #endif
+        }
+
+        /**
+         * @brief Restricts the calling thread to the CPUs of a node, so the memory it touches first is allocated on
+         * that node.
+         *
+         * @param node The node.
+         *
+         * @return False if the thread could not be bound (e.g. the CPUs are unknown, or not allowed).
+         */
+        FMT_NODISCARD bool BindCurrentThread(const size_t node) const {
+    #ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+
+            for (const int cpu: NodeCpus(node)) {
+                if (cpu < CPU_SETSIZE) {
+                    CPU_SET(cpu, &set);
+                }
+            }
+
+            return CPU_COUNT(&set) > 0 && sched_setaffinity(0, sizeof(set), &set) == 0;
+    #else
+            (void) node;
+            return false;
+    #endif
+        }
+
+    private:
+        std::vector<std::vector<int>> m_nodeCpus;
+        std::vector<size_t> m_cpuNodes;
+
+        static bool ParseInt(const std::string_view text, int &value) {
+            const auto *end = text.data() + text.size();
+            const auto result = std::from_chars(text.data(), end, value);
+            return result.ec == std::errc() && result.ptr == end && !text.empty();
+        }
+    };
+
+    /**
+     * @brief Page aligned buffer mapped straight from the kernel (<code>mmap</code>), optionally backed by huge
+     * pages.
+     *
+     * @note The memory is not touched when mapped: on NUMA machines, each page is allocated on the node of the
+     * thread that touches it first (see Touch()). Huge pages cut the TLB misses of large buffers.
+     */
+    class PageBuffer {
+    public:
+        /**
+         * @brief The pages backing the buffer.
+         */
+        enum class Pages {
+            /**
+             * @brief Regular pages.
+             */
+            NORMAL,
+
+            /**
+             * @brief Transparent huge pages (<code>madvise(MADV_HUGEPAGE)</code>): the kernel uses huge pages when
+             * it can, and regular pages otherwise.
+             */
+            TRANSPARENT_HUGE,
+
+            /**
+             * @brief Huge pages reserved by the administrator (<code>MAP_HUGETLB</code>, see
+             * <code>/proc/sys/vm/nr_hugepages</code>). Falls back to transparent huge pages if none is free.
+             */
+            EXPLICIT_HUGE
+        };
+
+        /**
+         * @brief The size of a huge page, the size of the huge page buffers is rounded up to.
+         */
+        static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+        /**
+         * @brief Maps a new buffer.
+         *
+         * @note Throws std::runtime_error if the memory could not be mapped.
+         *
+         * @param size The size of the buffer (rounded up to a whole number of huge pages, if used).
+         * @param pages The pages backing the buffer.
+         */
+        PageBuffer(const size_t size, const Pages pages) : m_pages(pages) {
+            m_size = pages == Pages::NORMAL ? size : (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+    #ifdef MAP_HUGETLB
+            if (pages == Pages::EXPLICIT_HUGE) {
+                m_data = Map(m_size, MAP_HUGETLB);
+            }
+    #endif
+
+            if (m_data == nullptr) {
+                m_pages = pages == Pages::NORMAL ? Pages::NORMAL : Pages::TRANSPARENT_HUGE;
+                m_data = Map(m_size, 0);
+            }
+
+            if (m_data == nullptr) {
+                throw std::runtime_error(
+                        fmt::format("Failed to map a buffer of {} bytes: {}", m_size, std::strerror(errno)));
+            }
+
+    #ifdef MADV_HUGEPAGE
+            if (m_pages == Pages::TRANSPARENT_HUGE) {
+                ::madvise(m_data, m_size, MADV_HUGEPAGE); // Only a hint: regular pages if THP is disabled.
+            }
+    #endif
+        }
+
+        PageBuffer(const PageBuffer &) = delete;
+        PageBuffer &operator=(const PageBuffer &) = delete;
+
+        ~PageBuffer() {
+            ::munmap(m_data, m_size);
+        }
+
+        /**
+         * @brief Writes every page of the buffer, so they are allocated now (on the node of the calling thread).
+         */
+        void Touch() {
+            std::memset(m_data, 0, m_size);
+        }
+
+        FMT_NODISCARD char *Data() const {
+            return m_data;
+        }
+
+        FMT_NODISCARD size_t Size() const {
+            return m_size;
+        }
+
+        /**
+         * @brief Gets the pages the buffer got (explicit huge pages fall back to transparent ones).
+         *
+         * @return The pages backing the buffer.
+         */
+        FMT_NODISCARD Pages GetPages() const {
+            return m_pages;
+        }
+
+    private:
+        char *m_data = nullptr;
+        size_t m_size;
+        Pages m_pages;
+
+        static char *Map(const size_t size, const int flags) {
+            void *data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+            return data == MAP_FAILED ? nullptr : static_cast<char *>(data);
+        }
+    };
+} // namespace slfmt
+
+#endif // _WIN32
+
+#endif // SLFMT_NUMA_H
@@ -0,0 +1,227 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * NumaBufferedSink-inl.h - Implementation of the NUMA buffered sink
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_NUMA_BUFFERED_SINK_INL_H
+#define SLFMT_NUMA_BUFFERED_SINK_INL_H
+
+#ifndef _WIN32
+
+    #include <algorithm>
+    #include <chrono>
+    #include <cstring>
+    #include <slfmt/LogFormat.h>
+    #include <stdexcept>
+    #include <string>
+
+    #include "NumaBufferedSink.h"
+
+namespace slfmt {
+    SLFMT_INLINE NumaBufferedSink::NumaBufferedSink(std::shared_ptr<Sink> sink, const Options &options)
+        : m_sink(std::move(sink)), m_options(options), m_topology(NumaTopology::Get()) {
+        if (m_sink == nullptr) {
+            throw std::runtime_error("A NUMA buffered sink needs a sink.");
+        }
+
+        for (size_t i = 0; i < m_topology.NodeCount(); i++) {
+            m_nodes.push_back(std::make_unique<Node>());
+        }
+    }
+
+    SLFMT_INLINE NumaBufferedSink::~NumaBufferedSink() {
+        for (const auto &node: m_nodes) {
+            if (!node->start.IsDone()) {
+                continue;
+            }
+
+            {
+                const std::lock_guard lock(node->mutex);
+                node->stop = true;
+            }
+
+            node->wakeUp.notify_one();
+            node->drainer.join();
+        }
+    }
+
+    SLFMT_INLINE void NumaBufferedSink::Write(const Record &record) {
+        // Formatted once per thread, not per record; the node too, so the records of a thread stay in order.
+        thread_local const std::string threadId = LogFormat::GetThreadIdString();
+        thread_local const size_t nodeIndex = NumaTopology::Get().CurrentNode();
+
+        // Rendered now: the drain thread has neither the call site fields nor the context of this thread.
+        const auto attributes = LogFormat::Attributes::Capture();
+        const auto attributesSize = attributes.SerializedSize();
+
+        const auto clazz = record.clazz.substr(0, UINT16_MAX);
+        const auto thread = std::string_view(threadId).substr(0, UINT16_MAX);
+        const size_t size =
+                Align(sizeof(RecordHeader) + clazz.size() + thread.size() + record.message.size() + attributesSize);
+
+        if (size > m_options.bufferSize) {
+            m_sink->Write(record);
+            return;
+        }
+
+        const RecordHeader header{
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::Now().time_since_epoch()).count(),
+            static_cast<std::uint32_t>(record.level), static_cast<std::uint16_t>(clazz.size()),
+            static_cast<std::uint16_t>(thread.size()), static_cast<std::uint32_t>(record.message.size()),
+            static_cast<std::uint32_t>(attributesSize)
+        };
+
+        auto &node = Start(std::min(nodeIndex, m_nodes.size() - 1));
+        bool wasEmpty = false;
+
+        {
+            std::unique_lock lock(node.mutex);
+
+            // Both buffers are full: wait for the drain thread to swap them.
+            node.drained.wait(lock, [&node, size, this] {
+                return node.used + size <= m_options.bufferSize;
+            });
+
+            auto *data = node.buffers[node.active]->Data() + node.used;
+            std::memcpy(data, &header, sizeof(header));
+            data += sizeof(header);
+            std::memcpy(data, clazz.data(), clazz.size());
+            std::memcpy(data + clazz.size(), thread.data(), thread.size());
+            std::memcpy(data + clazz.size() + thread.size(), record.message.data(), record.message.size());
+            attributes.Serialize(data + clazz.size() + thread.size() + record.message.size());
+
+            wasEmpty = node.used == 0;
+            node.used += size;
+            node.pending++;
+            node.appended++;
+        }
+
+        if (wasEmpty) {
+            node.wakeUp.notify_one();
+        }
+    }
+
+    SLFMT_INLINE void NumaBufferedSink::Flush() {
+        for (const auto &node: m_nodes) {
+            if (!node->start.IsDone()) {
+                continue;
+            }
+
+            std::unique_lock lock(node->mutex);
+            const auto appended = node->appended;
+            node->drained.wait(lock, [&node, appended] {
+                return node->written >= appended;
+            });
+        }
+    }
+
+    SLFMT_INLINE NumaBufferedSink::Node &NumaBufferedSink::Start(const size_t index) {
+        auto &node = *m_nodes[index];
+
+        node.start.Run([this, &node, index] {
+            // Mapped here, but only touched by the drain thread, once bound to the node.
+            node.buffers[0] = std::make_unique<PageBuffer>(m_options.bufferSize, m_options.pages);
+            node.buffers[1] = std::make_unique<PageBuffer>(m_options.bufferSize, m_options.pages);
+            node.drainer = std::thread(&NumaBufferedSink::Drain, this, index);
+
+            std::unique_lock lock(node.mutex);
+            node.drained.wait(lock, [&node] {
+                return node.ready;
+            });
+        });
+
+        return node;
+    }
+
+    SLFMT_INLINE void NumaBufferedSink::Drain(const size_t index) {
+        auto &node = *m_nodes[index];
+
+        if (m_topology.NodeCount() > 1) {
+            (void) m_topology.BindCurrentThread(index);
+        }
+
+        node.buffers[0]->Touch();
+        node.buffers[1]->Touch();
+
+        std::unique_lock lock(node.mutex);
+        node.ready = true;
+        node.drained.notify_all();
+
+        while (true) {
+            node.wakeUp.wait(lock, [&node] {
+                return node.used > 0 || node.stop;
+            });
+
+            if (node.used == 0) {
+                return; // Stopped, and everything is written.
+            }
+
+            // Swap the buffers: the threads go on appending to the other one while this one is written out.
+            const auto *data = node.buffers[node.active]->Data();
+            const auto size = node.used;
+            const auto records = node.pending;
+            node.active ^= 1;
+            node.used = 0;
+            node.pending = 0;
+            lock.unlock();
+            node.drained.notify_all();
+
+            WriteRecords(data, size);
+
+            lock.lock();
+            node.written += records;
+            node.drained.notify_all();
+        }
+    }
+
+    SLFMT_INLINE void NumaBufferedSink::WriteRecords(const char *data, const size_t size) {
+        std::string threadId, timestamp;
+        LogFormat::Attributes attributes;
+        std::chrono::milliseconds formattedTime{ -1 };
+
+        for (size_t offset = 0; offset < size;) {
+            RecordHeader header{};
+            std::memcpy(&header, data + offset, sizeof(header));
+
+            const auto *strings = data + offset + sizeof(header);
+            const std::string_view clazz(strings, header.classSize);
+            const std::string_view thread(strings + header.classSize, header.threadSize);
+            const std::string_view message(strings + header.classSize + header.threadSize, header.messageSize);
+            LogFormat::Attributes::Deserialize({ message.data() + message.size(), header.attributesSize }, attributes);
+            offset += Align(sizeof(header) + header.classSize + header.threadSize + header.messageSize +
+                            header.attributesSize);
+
+            // The records are formatted with the time, thread, fields and context they were logged with.
+            const auto time = Clock::TimePoint(
+                    std::chrono::duration_cast<Clock::TimePoint::duration>(std::chrono::nanoseconds(header.time)));
+            const auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch());
+
+            if (millis != formattedTime) {
+                timestamp = LogFormat::FormatTimestamp(time);
+                formattedTime = millis;
+            }
+
+            threadId.assign(thread);
+            const LogFormat::TimestampScope timestampScope(timestamp, time);
+            const LogFormat::ThreadIdScope threadIdScope(threadId);
+            const LogFormat::AttributesScope attributesScope(attributes);
+
+            try {
+                m_sink->Write({ static_cast<Level>(header.level), clazz, message });
+            } catch (...) {
+                // Nobody to report the error to: the record is counted as dropped.
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+} // namespace slfmt
+
+#endif // _WIN32
+
+#endif // SLFMT_NUMA_BUFFERED_SINK_INL_H
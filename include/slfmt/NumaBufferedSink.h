@@ -0,0 +1,218 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * NumaBufferedSink.h - Sink that buffers records per NUMA node
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_NUMA_BUFFERED_SINK_H
+#define SLFMT_NUMA_BUFFERED_SINK_H
+
+#ifndef _WIN32
+
+    #include <atomic>
+    #include <condition_variable>
+    #include <cstdint>
+    #include <memory>
+    #include <mutex>
+    #include <slfmt/Clock.h>
+    #include <slfmt/Config.h>
+    #include <slfmt/LazyInit.h>
+    #include <slfmt/LogFormat.h>
+    #include <slfmt/Numa.h>
+    #include <slfmt/Sink.h>
+    #include <thread>
+    #include <vector>
+
+namespace slfmt {
+    /**
+     * @brief Sink that copies the records into buffers local to the NUMA node of the logging thread, and writes them
+     * to another sink from one drain thread per node.
+     *
+     * @note Each node has two buffers, allocated on the node (the drain thread is bound to the node's CPUs and touches
+     * them first) and optionally backed by huge pages: threads append to one while the drain thread writes the other
+     * one out, so logging costs a copy into memory of the same socket and the threads of different sockets never
+     * share a lock or a cache line. Threads block while both buffers of their node are full. The records keep the
+     * time, thread, call site fields and diagnostic context they were logged with. A thread keeps the node it first
+     * logged from, so its records stay in order (pin threads to a node to keep them local). Records larger than a
+     * buffer are written directly. Not available on Windows.
+     */
+    class NumaBufferedSink : public Sink {
+    public:
+        /**
+         * @brief Options of the NUMA buffered sink.
+         */
+        struct Options {
+            /**
+             * @brief The size of each of the two buffers of a node.
+             */
+            size_t bufferSize = 1024 * 1024;
+
+            /**
+             * @brief The pages backing the buffers.
+             */
+            PageBuffer::Pages pages = PageBuffer::Pages::TRANSPARENT_HUGE;
+        };
+
+        /**
+         * @brief Constructs a new sink writing to the specified sink, with the default options.
+         *
+         * @param sink The sink to write the records to.
+         */
+        explicit NumaBufferedSink(std::shared_ptr<Sink> sink) : NumaBufferedSink(std::move(sink), Options{}) {}
+
+        /**
+         * @brief Constructs a new sink writing to the specified sink.
+         *
+         * @note The buffers of a node are allocated, and its drain thread started, when a thread of the node first
+         * writes a record. Throws std::runtime_error if there is no sink.
+         *
+         * @param sink The sink to write the records to.
+         * @param options The options of the sink.
+         */
+        NumaBufferedSink(std::shared_ptr<Sink> sink, const Options &options);
+
+        ~NumaBufferedSink() override;
+
+        /**
+         * @brief Copies a record into the buffer of the node of the calling thread.
+         *
+         * @param record The record to write.
+         */
+        void Write(const Record &record) override;
+
+        /**
+         * @brief Checks if the sink this one writes to writes records of the level.
+         *
+         * @param level The level to check.
+         *
+         * @return True if records of the level are written.
+         */
+        FMT_NODISCARD bool IsEnabled(const Level level) const override {
+            return m_sink->IsEnabled(level);
+        }
+
+        /**
+         * @brief Waits until all the records written so far have been written to the sink.
+         */
+        void Flush();
+
+        /**
+         * @brief Gets the number of records dropped so far because the sink failed to write them (the drain threads
+         * have nobody to report the error to).
+         *
+         * @return The number of dropped records.
+         */
+        FMT_NODISCARD std::uint64_t Dropped() const {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Gets the number of nodes (each of them gets its buffers and drain thread when first used).
+         *
+         * @return The number of nodes.
+         */
+        FMT_NODISCARD size_t NodeCount() const {
+            return m_nodes.size();
+        }
+
+    private:
+        /**
+         * @brief The header of a record in a buffer, followed by its class, thread, message and rendered attributes
+         * (padded to 8 bytes).
+         */
+        struct RecordHeader {
+            std::int64_t time;
+            std::uint32_t level;
+            std::uint16_t classSize;
+            std::uint16_t threadSize;
+            std::uint32_t messageSize;
+
+            /**
+             * @brief The size of the attributes (0 if the record has neither fields nor context).
+             */
+            std::uint32_t attributesSize;
+        };
+
+        /**
+         * @brief The buffers and drain thread of a node.
+         */
+        struct Node {
+            std::unique_ptr<PageBuffer> buffers[2];
+
+            std::mutex mutex;
+            std::condition_variable wakeUp;
+            std::condition_variable drained;
+
+            /**
+             * @brief The buffer the threads append to, and the bytes and records appended to it.
+             */
+            size_t active = 0;
+            size_t used = 0;
+            std::uint64_t pending = 0;
+
+            /**
+             * @brief The records appended to the buffers, and written to the sink, so far.
+             */
+            std::uint64_t appended = 0;
+            std::uint64_t written = 0;
+
+            bool ready = false;
+            bool stop = false;
+
+            LazyInit start;
+
+            /**
+             * @brief The drain thread (declared last, so everything it uses is initialized before and destroyed
+             * after it).
+             */
+            std::thread drainer;
+        };
+
+        const std::shared_ptr<Sink> m_sink;
+        const Options m_options;
+        const NumaTopology &m_topology;
+        std::vector<std::unique_ptr<Node>> m_nodes;
+        std::atomic<std::uint64_t> m_dropped = 0;
+
+        /**
+         * @brief Allocates the buffers of a node and starts its drain thread (if not done yet).
+         *
+         * @param index The index of the node.
+         *
+         * @return The node.
+         */
+        Node &Start(size_t index);
+
+        /**
+         * @brief The body of the drain thread of a node: writes the records of the buffers to the sink.
+         *
+         * @param index The index of the node.
+         */
+        void Drain(size_t index);
+
+        /**
+         * @brief Writes the records of a buffer to the sink, with the time and thread they were logged with.
+         *
+         * @param data The records.
+         * @param size The size of the records.
+         */
+        void WriteRecords(const char *data, size_t size);
+
+        FMT_NODISCARD static size_t Align(const size_t size) {
+            return (size + 7) & ~static_cast<size_t>(7);
+        }
+    };
+} // namespace slfmt
+
+    #ifndef SLFMT_COMPILED_LIB
+        #include "NumaBufferedSink-inl.h"
+    #endif
+
+#endif // _WIN32
+
+#endif // SLFMT_NUMA_BUFFERED_SINK_H
@@ -0,0 +1,222 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * RepeatFilter.h - Suppression of repeated log messages
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_REPEAT_FILTER_H
+#define SLFMT_REPEAT_FILTER_H
+
+#include <chrono>
+#include <cstdint>
+#include <fmt/format.h>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "Level.h"
+
+namespace slfmt {
+    /**
+     * @brief Collapses identical consecutive messages of a logger into the first one plus a summary
+     * ("Last message repeated N times").
+     *
+     * @note A message repeats the previous one if it has the same level and key (see Key) and arrives less than
+     * Options::window after it. While the repetitions continue, a summary is written every window, so a flood of
+     * identical messages costs one line per window instead of one per message. The pending repetitions are also
+     * summarized before the next different message and when the logger is destroyed.
+     */
+    class RepeatFilter {
+    public:
+        /**
+         * @brief What identifies a message.
+         */
+        enum class Key {
+            /**
+             * @brief The formatted message (messages with different arguments are different).
+             */
+            MESSAGE,
+
+            /**
+             * @brief The format string (its address, not its contents): messages logged from the same call are
+             * identical whatever their arguments, and the repetitions are not even formatted.
+             */
+            FORMAT
+        };
+
+        /**
+         * @brief Options of the filter.
+         */
+        struct Options {
+            /**
+             * @brief The maximum time between two repetitions, and how often the repetitions are summarized.
+             */
+            std::chrono::milliseconds window = std::chrono::seconds(1);
+
+            /**
+             * @brief What identifies a message.
+             */
+            Key key = Key::MESSAGE;
+        };
+
+        /**
+         * @brief What to do with a message.
+         */
+        struct Decision {
+            /**
+             * @brief Whether the message must be written (false if it is a repetition).
+             */
+            bool write = true;
+
+            /**
+             * @brief The number of repetitions to summarize before the message (0 if none).
+             */
+            std::uint64_t repeated = 0;
+
+            /**
+             * @brief The level of the repeated message.
+             */
+            Level repeatedLevel = Level::UNKNOWN;
+        };
+
+        /**
+         * @brief Creates a new filter.
+         *
+         * @param options The options of the filter.
+         */
+        explicit RepeatFilter(const Options &options) : m_options(options) {}
+
+        /**
+         * @brief Gets what identifies a message.
+         *
+         * @return The key of the messages.
+         */
+        FMT_NODISCARD Key GetKey() const {
+            return m_options.key;
+        }
+
+        /**
+         * @brief Checks if a message repeats the previous one.
+         *
+         * @param level The level of the message.
+         * @param key The formatted message or the format string (see Options::key).
+         *
+         * @return Whether to write the message, and the repetitions to summarize first.
+         */
+        Decision Check(const Level level, const std::string_view key) {
+            const auto now = std::chrono::steady_clock::now();
+            const std::lock_guard lock(m_mutex);
+            Decision decision;
+
+            if (IsRepetition(level, key) && now - m_last < m_options.window) {
+                m_last = now;
+                m_repeated++;
+                decision.write = false;
+
+                if (now - m_summarized < m_options.window) {
+                    return decision;
+                }
+
+                decision.repeated = m_repeated;
+                decision.repeatedLevel = m_level;
+            } else {
+                decision.repeated = m_repeated;
+                decision.repeatedLevel = m_level;
+                Remember(level, key);
+                m_last = now;
+            }
+
+            m_repeated = 0;
+            m_summarized = now;
+
+            return decision;
+        }
+
+        /**
+         * @brief Takes the repetitions that have not been summarized yet.
+         *
+         * @return The repetitions to summarize (0 if none) and their level.
+         */
+        Decision TakeRepeated() {
+            const std::lock_guard lock(m_mutex);
+            Decision decision{ false, m_repeated, m_level };
+            m_repeated = 0;
+            return decision;
+        }
+
+        /**
+         * @brief Formats the summary of the repetitions of a message.
+         *
+         * @param repeated The number of repetitions.
+         *
+         * @return The summary message.
+         */
+        static std::string Summary(const std::uint64_t repeated) {
+            return fmt::format("Last message repeated {} times", repeated);
+        }
+
+    private:
+        const Options m_options;
+
+        std::mutex m_mutex;
+
+        /**
+         * @brief The last message (only with Key::MESSAGE).
+         */
+        std::string m_message;
+
+        /**
+         * @brief The format string of the last message (only with Key::FORMAT).
+         */
+        std::string_view m_format;
+
+        /**
+         * @brief The level of the last message.
+         */
+        Level m_level = Level::UNKNOWN;
+
+        /**
+         * @brief The repetitions of the last message since the last summary.
+         */
+        std::uint64_t m_repeated = 0;
+
+        /**
+         * @brief When the last message (or repetition) arrived.
+         */
+        std::chrono::steady_clock::time_point m_last{};
+
+        /**
+         * @brief When the repetitions were last summarized (or the last message was written).
+         */
+        std::chrono::steady_clock::time_point m_summarized{};
+
+        FMT_NODISCARD bool IsRepetition(const Level level, const std::string_view key) const {
+            if (level != m_level) {
+                return false;
+            }
+
+            if (m_options.key == Key::FORMAT) {
+                return key.data() == m_format.data() && key.size() == m_format.size();
+            }
+
+            return key == m_message;
+        }
+
+        void Remember(const Level level, const std::string_view key) {
+            m_level = level;
+
+            if (m_options.key == Key::FORMAT) {
+                m_format = key;
+            } else {
+                m_message.assign(key);
+            }
+        }
+    };
+} // namespace slfmt
+
+#endif // SLFMT_REPEAT_FILTER_H
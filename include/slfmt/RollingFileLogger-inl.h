@@ -0,0 +1,360 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * RollingFileLogger-inl.h - Implementation of the rolling file logger
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_ROLLING_FILE_LOGGER_INL_H
+#define SLFMT_ROLLING_FILE_LOGGER_INL_H
+
+#include <algorithm>
+#include <slfmt/FileLock.h>
+#include <slfmt/Files.h>
+#include <slfmt/LogFormat.h>
+
+#include "RollingFileLogger.h"
+
+namespace slfmt {
+    SLFMT_INLINE RollingFileLogger::RollingFileLogger(const std::string_view &clazz, const std::string_view &file,
+                                                      const Options &options)
+        : LoggerBase(clazz), m_file(ActiveFileName(file, options.compression)), m_writer(options.bufferSize),
+          m_gzip(options.compression == Compression::GZIP
+                         ? std::make_unique<GzipWriter>(m_writer, options.index ? 0 : options.blockSize)
+                         : nullptr),
+          m_index(m_gzip != nullptr && options.index ? std::make_unique<FileWriter>() : nullptr),
+          m_blockSize(options.blockSize), m_shared(options.shared),
+          m_sharedCheckInterval(options.sharedCheckInterval),
+          fileSizeLimit(std::max(options.fileSize, MIN_FILE_SIZE)),
+          m_fileSizeTooSmall(options.fileSize < MIN_FILE_SIZE) {
+        if (m_shared && m_gzip != nullptr) {
+            throw std::runtime_error("Shared rolling log files cannot be compressed.");
+        }
+
+#ifdef _WIN32
+        if (m_shared) {
+            throw std::runtime_error("Shared rolling log files are not supported on Windows.");
+        }
+#endif
+    }
+
+    SLFMT_INLINE RollingFileLogger::~RollingFileLogger() {
+        FlushRepeats();
+
+        if (!m_open.IsDone()) {
+            return;
+        }
+
+        if (m_gzip != nullptr) {
+            CloseCompressedFile();
+        }
+
+        m_writer.Close(); // Flush the pending messages before closing the file.
+    }
+
+    SLFMT_INLINE void RollingFileLogger::Flush() {
+        if (!m_open.IsDone()) {
+            return;
+        }
+
+        const std::lock_guard lock(m_mutex);
+
+        if (m_index != nullptr) {
+            EndBlock();
+        } else if (m_gzip != nullptr) {
+            m_gzip->FlushBlock();
+        }
+
+        m_writer.Flush();
+    }
+
+    SLFMT_INLINE void RollingFileLogger::Write(const Record &record) {
+        WriteAndFlushStream(record.level, FORMAT_MAPPED_PARAMS_FOR_RECORD(record));
+
+        if (record.level >= Level::ERROR) {
+            Flush();
+        }
+
+        CheckAndBackupLogFile();
+    }
+
+    SLFMT_INLINE void RollingFileLogger::Open() {
+        if (!fs::exists(s_backupDir)) {
+            fs::create_directory(s_backupDir);
+        }
+
+        if (m_gzip != nullptr) {
+            // A compressed stream cannot be resumed (the previous run may not even have finished it), so any
+            // previous file is moved to the backups and a new one is started.
+            if (fs::exists(m_file) && fs::file_size(m_file) > 0) {
+                CreateCompressedBackup();
+            } else if (m_index != nullptr) {
+                // Without data, any previous index is stale.
+                Files::ClearFile(BlockIndex::IndexFileName(m_file));
+            }
+
+            OpenCompressedFile();
+        } else if (m_shared) {
+            m_writer.Open(m_file);
+            m_currentFileSize = static_cast<size_t>(m_writer.FileSize());
+            m_nextSharedCheck = std::chrono::steady_clock::now() + m_sharedCheckInterval;
+
+            if (m_currentFileSize >= fileSizeLimit) {
+                RollOverShared();
+            }
+        } else {
+            m_writer.Open(m_file);
+
+            // Get the size of the existing file, so we can check if it exceeds the specified file size limit.
+            m_currentFileSize = fs::file_size(m_file);
+
+            // If the file size is greater than the specified file size limit, backup the file.
+            if (m_currentFileSize >= fileSizeLimit) {
+                CreateBackup();
+                m_currentFileSize = 0;
+            }
+        }
+
+        if (m_fileSizeTooSmall) {
+            // Warn the user that the specified size is too small. This could lead to a lot of file rollovers
+            // and/or data loss. The file is being opened, so the message is written directly.
+            const auto msg = fmt::format("Specified file size is too small. Using the minimum allowed size ({} MB).",
+                                         MIN_FILE_SIZE / 1024 / 1024);
+            const Record record{ Level::WARN, GetClass(), msg };
+            auto &line = LogFormat::ThreadBuffer();
+            GetLayout().FormatTo(line, FORMAT_MAPPED_PARAMS_FOR_RECORD(record));
+            WriteLine(Level::WARN, line);
+        }
+    }
+
+    SLFMT_INLINE void RollingFileLogger::WriteAndFlushStream(
+            const Level level, const std::unordered_map<std::string_view, std::string_view> &format_map) {
+        m_open.Run([this] {
+            Open();
+        });
+
+        // Rendered into the buffer of the thread, outside any lock.
+        auto &line = LogFormat::ThreadBuffer();
+        GetLayout().FormatTo(line, format_map);
+        WriteLine(level, line);
+    }
+
+    SLFMT_INLINE void RollingFileLogger::WriteBatch(const std::string_view clazz, const LogBatch &batch) {
+        if (m_gzip != nullptr) {
+            // Compressed blocks (and their index entries) are built record by record.
+            LoggerBase::WriteBatch(clazz, batch);
+            return;
+        }
+
+        m_open.Run([this] {
+            Open();
+        });
+
+        const auto lines = FormatBatch(clazz, batch);
+
+        if (lines.empty()) {
+            return;
+        }
+
+        WriteLine(batch.GetMaxLevel(), lines);
+
+        if (batch.GetMaxLevel() >= Level::ERROR) {
+            Flush();
+        }
+
+        CheckAndBackupLogFile();
+    }
+
+    SLFMT_INLINE void RollingFileLogger::WriteLine(const Level level, const std::string_view msg) {
+        if (m_gzip != nullptr) {
+            const std::lock_guard lock(m_mutex);
+            WriteCompressed(level, msg);
+            m_currentFileSize.fetch_add(msg.size(), std::memory_order_relaxed);
+            return;
+        }
+
+        if (m_shared && std::chrono::steady_clock::now() >= m_nextSharedCheck.load(std::memory_order_relaxed)) {
+            const std::lock_guard lock(m_mutex);
+            CheckSharedFile();
+        }
+
+        // Plain messages are written with a single call: writers only exclude the rotation, which replaces the file.
+        const std::shared_lock lock(m_mutex);
+        m_writer.Write(msg);
+        m_currentFileSize.fetch_add(msg.size(), std::memory_order_relaxed);
+    }
+
+    SLFMT_INLINE void RollingFileLogger::WriteCompressed(const Level level, const std::string_view msg) {
+        if (!m_gzip->IsStarted()) {
+            m_block = {};
+            m_block.offset = m_gzip->OutputSize() - m_fileStart;
+            m_gzip->Begin();
+        }
+
+        m_gzip->Write(msg);
+
+        if (m_index != nullptr) {
+            // The time the record shows (it may have been logged a while ago, e.g. by a queued combined logger).
+            m_block.Add(level, BlockIndex::Millis(LogFormat::GetTime()));
+
+            if (m_gzip->BlockFill() >= m_blockSize) {
+                EndBlock();
+            }
+        }
+    }
+
+    SLFMT_INLINE void RollingFileLogger::EndBlock() {
+        if (!m_gzip->IsStarted()) {
+            return;
+        }
+
+        m_gzip->Finish();
+        m_block.size = m_gzip->OutputSize() - m_fileStart - m_block.offset;
+
+        // The block must be in the file before the index points to it.
+        m_writer.Flush();
+        m_index->Write(BlockIndex::FormatEntry(m_block));
+    }
+
+    SLFMT_INLINE void RollingFileLogger::CloseCompressedFile() {
+        if (m_index != nullptr) {
+            EndBlock();
+            m_index->Close();
+        } else {
+            m_gzip->Finish();
+        }
+
+        m_writer.Close();
+    }
+
+    SLFMT_INLINE void RollingFileLogger::OpenCompressedFile() {
+        m_writer.Open(m_file);
+        m_fileStart = m_gzip->OutputSize();
+
+        if (m_index != nullptr) {
+            m_index->Open(BlockIndex::IndexFileName(m_file));
+        }
+    }
+
+    SLFMT_INLINE std::string RollingFileLogger::BackupFileName(const fs::path &file,
+                                                               const std::string_view extension) {
+        auto now = std::chrono::system_clock::now();
+        auto time = std::chrono::system_clock::to_time_t(now);
+
+        tm tm{};
+
+#ifdef _WIN32
+        localtime_s(&tm, &time);
+#else
+        localtime_r(&time, &tm);
+#endif
+
+        // Adjust fields
+        tm.tm_year += 1900;
+        tm.tm_mon += 1;
+
+        const auto baseName = fmt::format(fmt::runtime("{}_{:04d}-{:02d}-{:02d}_{:02d}-{:02d}-{:02d}"),
+                                          file.stem().string().c_str(), tm.tm_year, tm.tm_mon, tm.tm_mday,
+                                          tm.tm_hour, tm.tm_min, tm.tm_sec);
+        auto name = baseName;
+
+        for (int i = 1; fs::exists(s_backupDir / fmt::format("{}.{}", name, extension)); i++) {
+            name = fmt::format("{}-{}", baseName, i);
+        }
+
+        return name;
+    }
+
+    SLFMT_INLINE void RollingFileLogger::CheckAndBackupLogFile() {
+        if (m_currentFileSize.load(std::memory_order_relaxed) < fileSizeLimit) {
+            return;
+        }
+
+        const std::lock_guard lock(m_mutex);
+
+        // Another thread may have rolled the file over while this one was waiting for the lock.
+        if (m_currentFileSize.load(std::memory_order_relaxed) < fileSizeLimit) {
+            return;
+        }
+
+        if (m_shared) {
+            RollOverShared();
+            return;
+        }
+
+        if (m_gzip != nullptr) {
+            // The compressed file is already the backup: finish it, move it and start the next one.
+            CloseCompressedFile();
+            CreateCompressedBackup();
+            OpenCompressedFile();
+        } else {
+            m_writer.Close();
+            CreateBackup();
+
+            // Open the new log file.
+            m_writer.Open(m_file);
+        }
+
+        m_currentFileSize = 0;
+    }
+
+    SLFMT_INLINE void RollingFileLogger::CheckSharedFile() {
+        const auto now = std::chrono::steady_clock::now();
+
+        if (now < m_nextSharedCheck.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        m_nextSharedCheck = now + m_sharedCheckInterval;
+
+        if (m_writer.IsReplaced(m_file)) {
+            m_writer.Open(m_file);
+        }
+
+        m_currentFileSize = static_cast<size_t>(m_writer.FileSize());
+    }
+
+    SLFMT_INLINE void RollingFileLogger::RollOverShared() {
+        FileLock lock(fmt::format("{}.lock", m_file));
+
+        m_writer.Flush();
+
+        if (!m_writer.IsReplaced(m_file) && m_writer.FileSize() >= fileSizeLimit) {
+            fs::rename(m_file, s_backupDir / fmt::format("{}.log", BackupFileName(m_file, "log")));
+        }
+
+        // Either this process or another one has started a new file.
+        m_writer.Open(m_file);
+        m_currentFileSize = static_cast<size_t>(m_writer.FileSize());
+        m_nextSharedCheck = std::chrono::steady_clock::now() + m_sharedCheckInterval;
+    }
+
+    SLFMT_INLINE void RollingFileLogger::CreateBackup() const {
+        const auto &backupFilename = BackupFileName(m_file, "zip");
+        const auto compressedFile = Files::CompressFile(m_file, backupFilename);
+        Files::MoveFileToDir(compressedFile, s_backupDir);
+        Files::ClearFile(m_file);
+    }
+
+    SLFMT_INLINE void RollingFileLogger::CreateCompressedBackup() const {
+        const auto backupFile = s_backupDir / fmt::format("{}.gz", BackupFileName(m_file, "gz"));
+        const auto indexFile = BlockIndex::IndexFileName(m_file);
+
+        fs::rename(m_file, backupFile);
+
+        if (fs::exists(indexFile)) {
+            fs::rename(indexFile, BlockIndex::IndexFileName(backupFile.string()));
+        }
+    }
+
+    SLFMT_INLINE std::string RollingFileLogger::ActiveFileName(const std::string_view file,
+                                                               const Compression compression) {
+        return compression == Compression::GZIP ? fmt::format("{}.gz", file) : std::string(file);
+    }
+} // namespace slfmt
+
+#endif // SLFMT_ROLLING_FILE_LOGGER_INL_H
@@ -12,6 +12,15 @@
 #ifndef SLFMT_ROLLING_FILE_LOGGER_H
 #define SLFMT_ROLLING_FILE_LOGGER_H
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <shared_mutex>
+#include <slfmt/BlockIndex.h>
+#include <slfmt/Config.h>
+#include <slfmt/FileWriter.h>
+#include <slfmt/GzipWriter.h>
+#include <slfmt/LazyInit.h>
 #include <slfmt/LoggerBase.h>
 
 namespace slfmt {
@@ -20,185 +29,324 @@ namespace slfmt {
         static constexpr size_t DEFAULT_FILE_SIZE = 1024 * 1024 * 5; // 5 MB
         static constexpr size_t MIN_FILE_SIZE = 1024 * 1024;         // 1 MB
 
+        /**
+         * @brief How the log files are compressed.
+         */
+        enum class Compression {
+            /**
+             * @brief The log file is written as plain text and zipped when it is rolled over.
+             */
+            NONE,
+
+            /**
+             * @brief The log file is compressed while it is written (as <code>file.gz</code>), so rolling it over
+             * only has to close it and start the next one.
+             */
+            GZIP
+        };
+
+        /**
+         * @brief Options of the rolling file logger.
+         */
+        struct Options {
+            /**
+             * @brief The maximum size (in bytes) of the log data in a file before rolling it over. For compressed
+             * files, this is the size of the data before compressing it.
+             */
+            size_t fileSize = DEFAULT_FILE_SIZE;
+
+            /**
+             * @brief The size (in bytes) of the in-memory buffer, or 0 to write each message immediately
+             * (see FileLogger).
+             */
+            size_t bufferSize = 0;
+
+            /**
+             * @brief How the log files are compressed.
+             */
+            Compression compression = Compression::NONE;
+
+            /**
+             * @brief For compressed files, the amount of log data (in bytes) after which the compressed data is
+             * flushed to the file. Only the data after the last flush can be lost if the program crashes.
+             */
+            size_t blockSize = GzipWriter::DEFAULT_BLOCK_SIZE;
+
+            /**
+             * @brief For compressed files, writes every block as an independent gzip member and keeps a time index
+             * of the blocks in <code>file.gz.idx</code> (see BlockIndex). This allows finding the messages logged in
+             * a time range by decompressing only the blocks that contain them (see the slfmt-query tool).
+             */
+            bool index = false;
+
+            /**
+             * @brief Allows several processes to log to the same (uncompressed) file. Rolling over is coordinated
+             * through an advisory lock on <code>file.lock</code>: the process that rolls the file over renames it to
+             * the backup directory and starts a new one, and the other processes notice it (checking the inode of
+             * the file every sharedCheckInterval) and reopen the file.
+             *
+             * @note Other processes may append to the renamed file until they notice the rollover, so the backups
+             * of shared files are not zipped (they are kept as <code>.log</code> files). Not supported on Windows.
+             */
+            bool shared = false;
+
+            /**
+             * @brief For shared files, how often each process checks if the file has been rolled over by another
+             * one. Messages logged by the process during this time may end up in the previous file.
+             */
+            std::chrono::milliseconds sharedCheckInterval = std::chrono::seconds(1);
+        };
+
         /**
          * @brief Constructs a new logger for the specified class and file.
          *
          * @param clazz The class to create a logger for.
          * @param file The file to log to.
          * @param fileSize The maximum size (in bytes) of the log file before rolling it over.
+         * @param bufferSize The size (in bytes) of the in-memory buffer, or 0 to write each message immediately
+         * (see FileLogger).
          */
         RollingFileLogger(const std::string_view &clazz, const std::string_view &file,
-                          const size_t fileSize = DEFAULT_FILE_SIZE)
-            : LoggerBase(clazz), m_stream(file.data(), std::ios::out | std::ios::app), m_file(file.data()),
-              fileSizeLimit(fileSize) {
-            if (fileSize < MIN_FILE_SIZE) {
-                // Warn the user that the specified size is too small. This could lead to a lot of file rollovers
-                // and/or data loss.
-                Warn("Specified file size is too small. Using the minimum allowed size ({} MB).",
-                     MIN_FILE_SIZE / 1024 / 1024);
-
-                fileSizeLimit = MIN_FILE_SIZE;
-            }
-
-            if (!fs::exists(s_backupDir)) {
-                fs::create_directory(s_backupDir);
-            }
-
-            // If the file exists, get its size, so we can check if it exceeds the specified file size limit when
-            // opening it.
-            if (fs::exists(file)) {
-                m_currentFileSize = fs::file_size(file);
-
-                // If the file size is greater than the specified file size limit, backup the file.
-                if (m_currentFileSize >= fileSizeLimit) {
-                    CreateBackup();
-                    m_currentFileSize = 0;
-                }
-            }
-        }
-
-        ~RollingFileLogger() override {
-            m_stream.flush(); // Flush the stream before closing the file.
-            m_stream.close();
-        }
+                          const size_t fileSize = DEFAULT_FILE_SIZE, const size_t bufferSize = 0)
+            : RollingFileLogger(clazz, file, Options{ .fileSize = fileSize, .bufferSize = bufferSize }) {}
 
-    private:
         /**
-         * @brief The output stream for the file to log to.
+         * @brief Constructs a new logger for the specified class and file.
+         *
+         * @param clazz The class to create a logger for.
+         * @param file The file to log to (<code>file.gz</code> is used for compressed logs).
+         * @param options The options of the logger.
          *
-         * @note the mode <b>std::ios::app (seek to end before each write)</b> allows having
-         * multiple instances of loggers, writing to the same file <b>without</b> overwriting each other.
+         * @note Nothing is done on the file system until the first message is logged: then the backup directory
+         * is created, the file is opened and a previous file over the size limit is rolled over.
          */
-        std::ofstream m_stream;
+        RollingFileLogger(const std::string_view &clazz, const std::string_view &file, const Options &options);
+
+        ~RollingFileLogger() override;
 
+        /**
+         * @brief Writes the buffered messages (if any) to the file.
+         *
+         * @note For indexed files, this ends the current block.
+         */
+        void Flush();
+
+        /**
+         * @brief Writes a record to the file (and the buffered ones, for ERROR and FATAL records), and rolls the
+         * file over if it is full.
+         *
+         * @param record The record to write.
+         */
+        void Write(const Record &record) override;
+
+        /**
+         * @brief Writes the records of a batch to the file with a single call, and then checks the size of the
+         * file (so a batch is never split between two files). Compressed files write each record on its own.
+         *
+         * @param clazz The class of the records.
+         * @param batch The records to write.
+         */
+        void WriteBatch(std::string_view clazz, const LogBatch &batch) override;
+
+    private:
         /**
          * @brief The file path to log to.
          */
-        const std::string_view m_file;
+        const std::string m_file;
 
         /**
-         * @brief The maximum size (in bytes) of the log file before rolling it over.
+         * @brief Opens the file when the first message is logged.
          */
-        size_t fileSizeLimit;
+        LazyInit m_open;
 
         /**
-         * @brief The current size of the log file.
+         * @brief The writer for the file to log to.
+         *
+         * @note The file is opened in append mode (every write goes to the end of the file), which allows having
+         * multiple instances of loggers writing to the same file <b>without</b> overwriting each other.
          */
-        size_t m_currentFileSize = 0;
+        FileWriter m_writer;
 
         /**
-         * @brief The directory to store the backup log files.
+         * @brief The compressor of the log file (only for compressed logs).
          */
-        static const inline auto s_backupDir = fs::path("logs");
+        std::unique_ptr<GzipWriter> m_gzip;
+
+        /**
+         * @brief The writer of the block index (only for indexed logs).
+         */
+        std::unique_ptr<FileWriter> m_index;
+
+        /**
+         * @brief The index entry of the block being written (only for indexed logs).
+         */
+        BlockIndex::Entry m_block{};
+
+        /**
+         * @brief The compressed output size when the current file was opened (to compute offsets in the file).
+         */
+        std::uint64_t m_fileStart = 0;
+
+        /**
+         * @brief The amount of log data (in bytes) in each block of indexed files.
+         */
+        const size_t m_blockSize;
+
+        /**
+         * @brief Whether other processes log to the same file (see Options::shared).
+         */
+        const bool m_shared;
+
+        /**
+         * @brief How often to check if another process has rolled the shared file over.
+         */
+        const std::chrono::milliseconds m_sharedCheckInterval;
 
-        void Trace_Internal(std::string_view msg) override {
-            WriteAndFlushStream(FORMAT_MAPPED_PARAMS_FOR_LEVEL(TRACE_LEVEL_STRING));
-            CheckAndBackupLogFile();
-        }
+        /**
+         * @brief When to check again if another process has rolled the shared file over.
+         */
+        std::atomic<std::chrono::steady_clock::time_point> m_nextSharedCheck{};
+
+        /**
+         * @brief The maximum size (in bytes) of the log file before rolling it over.
+         */
+        size_t fileSizeLimit;
 
-        void Debug_Internal(std::string_view msg) override {
-            WriteAndFlushStream(FORMAT_MAPPED_PARAMS_FOR_LEVEL(DEBUG_LEVEL_STRING));
-            CheckAndBackupLogFile();
-        }
+        /**
+         * @brief The current size of the log file (every writer adds the size of its message after writing it).
+         */
+        std::atomic<size_t> m_currentFileSize = 0;
 
-        void Info_Internal(std::string_view msg) override {
-            WriteAndFlushStream(FORMAT_MAPPED_PARAMS_FOR_LEVEL(INFO_LEVEL_STRING));
-            CheckAndBackupLogFile();
-        }
+        /**
+         * @brief Held shared by the threads writing to the file, and exclusively to roll it over, reopen it or
+         * write compressed data (the compressed stream is sequential).
+         */
+        std::shared_mutex m_mutex;
 
-        void Warn_Internal(std::string_view msg) override {
-            WriteAndFlushStream(FORMAT_MAPPED_PARAMS_FOR_LEVEL(WARN_LEVEL_STRING));
-            CheckAndBackupLogFile();
-        }
+        /**
+         * @brief Whether the specified file size was below the minimum (to warn about it when opening the file).
+         */
+        const bool m_fileSizeTooSmall;
 
-        void Error_Internal(std::string_view msg) override {
-            WriteAndFlushStream(FORMAT_MAPPED_PARAMS_FOR_LEVEL(ERROR_LEVEL_STRING));
-            CheckAndBackupLogFile();
-        }
+        /**
+         * @brief The directory to store the backup log files.
+         */
+        static const inline auto s_backupDir = fs::path("logs");
 
-        void Fatal_Internal(std::string_view msg) override {
-            WriteAndFlushStream(FORMAT_MAPPED_PARAMS_FOR_LEVEL(FATAL_LEVEL_STRING));
-            CheckAndBackupLogFile();
-        }
+        /**
+         * @brief Prepares the log file: creates the backup directory, opens the file (and index) and rolls over a
+         * previous file that is over the size limit (or compressed).
+         */
+        void Open();
 
         /**
-         * @brief Writes the specified message to the file and flushes the stream.
+         * @brief Writes the specified message to the file, opening it first if it is the first message.
          *
-         * @note When flushing the stream, the message is written to the file immediately. So, if the program
-         * crashes, the message will be written to the file <b>before</b> the crash.
+         * @note When the logger is not buffered, the message is written to the file immediately. So, if the
+         * program crashes, the message will be written to the file <b>before</b> the crash. Buffered messages
+         * rely on the CrashHandler instead.
          *
+         * @param level The level of the message.
          * @param format_map The format map to write.
          */
-        void WriteAndFlushStream(const std::unordered_map<std::string_view, std::string_view> &format_map) {
-            const auto msg = LogFormat::Get().Format(format_map);
-            const auto msgSize = msg.size();
-
-            m_stream.write(msg.data(), (std::streamsize) msgSize).flush();
-            m_currentFileSize += msgSize;
-        }
+        void WriteAndFlushStream(const Level level,
+                                 const std::unordered_map<std::string_view, std::string_view> &format_map);
 
         /**
-         * @brief Generates a backup file name for the specified file.
+         * @brief Writes the specified formatted message to the open file.
          *
-         * @param file The file to generate a backup file name for.
+         * @param level The level of the message.
+         * @param msg The formatted message.
+         */
+        void WriteLine(const Level level, const std::string_view msg);
+
+        /**
+         * @brief Writes the specified message to the compressed file, starting and ending blocks as needed.
          *
-         * @return The backup file name.
+         * @param level The level of the message.
+         * @param msg The formatted message.
          */
-        static std::string BackupFileName(const fs::path &file) {
-            auto now = std::chrono::system_clock::now();
-            auto time = std::chrono::system_clock::to_time_t(now);
+        void WriteCompressed(const Level level, const std::string_view msg);
 
-            tm tm{};
+        /**
+         * @brief Ends the current block of an indexed file and adds it to the index.
+         */
+        void EndBlock();
 
-#ifdef _WIN32
-            localtime_s(&tm, &time);
-#else
-            localtime_r(&time, &tm);
-#endif
+        /**
+         * @brief Ends the compressed data and closes the current compressed file (and its index).
+         */
+        void CloseCompressedFile();
 
-            // Adjust fields
-            tm.tm_year += 1900;
-            tm.tm_mon += 1;
+        /**
+         * @brief Opens a new compressed file (and its index).
+         */
+        void OpenCompressedFile();
 
-            return fmt::format(fmt::runtime("{}_{:04d}-{:02d}-{:02d}_{:02d}-{:02d}-{:02d}"),
-                               file.stem().string().c_str(), tm.tm_year, tm.tm_mon, tm.tm_mday, tm.tm_hour, tm.tm_min,
-                               tm.tm_sec);
-        }
+        /**
+         * @brief Generates a backup file name for the specified file.
+         *
+         * @param file The file to generate a backup file name for.
+         * @param extension The extension the backup file will have.
+         *
+         * @return The backup file name (without the extension).
+         *
+         * @note If a backup with the same name already exists (several rollovers in the same second), a counter
+         * is appended to the name so no backup is overwritten.
+         */
+        static std::string BackupFileName(const fs::path &file, const std::string_view extension);
 
         /**
          * @brief Checks if the current log file exceeds the specified file size limit
          * and creates a backup if it does.
+         *
+         * @note Takes the lock exclusively, and only if the limit has been reached.
          */
-        void CheckAndBackupLogFile() {
-            if (m_currentFileSize < fileSizeLimit) {
-                return;
-            }
+        void CheckAndBackupLogFile();
 
-            m_stream.close();
-            CreateBackup();
-
-            // Open the new log file.
-            m_stream.open(m_file.data(), std::ios::out | std::ios::app);
-
-            if (!m_stream.is_open()) {
-                throw std::runtime_error("Failed to open log file.");
-            }
+        /**
+         * @brief Reopens the shared file if another process has rolled it over (checked every sharedCheckInterval)
+         * and updates the file size with what the other processes have written.
+         *
+         * @note Must be called with the lock held exclusively.
+         */
+        void CheckSharedFile();
 
-            m_currentFileSize = 0;
-        }
+        /**
+         * @brief Rolls the shared file over, unless another process has already done it.
+         *
+         * @note Only one process at a time can hold the lock, and the size is checked again once it is held, so
+         * the file is rolled over exactly once. Renaming (instead of copying and truncating) the file guarantees
+         * that no message of the processes that still have it open is lost.
+         */
+        void RollOverShared();
 
         /**
          * Creates a backup of the current log file.
          *
          * @note The backup file is compressed before moving it to the backup directory.
          */
-        void CreateBackup() const {
-            const auto &backupFilename = BackupFileName(m_file);
-            const auto compressedFile = Files::CompressFile(m_file.data(), backupFilename);
-            Files::MoveFileToDir(compressedFile, s_backupDir);
-            Files::ClearFile(m_file);
-        }
+        void CreateBackup() const;
+
+        /**
+         * Moves the current (compressed) log file and its index (if any) to the backup directory.
+         */
+        void CreateCompressedBackup() const;
+
+        /**
+         * @brief Gets the name of the file the logger writes to.
+         *
+         * @param file The file to log to.
+         * @param compression How the log file is compressed.
+         *
+         * @return The name of the file to write to.
+         */
+        static std::string ActiveFileName(const std::string_view file, const Compression compression);
     };
 } // namespace slfmt
 
+#ifndef SLFMT_COMPILED_LIB
+    #include "RollingFileLogger-inl.h"
+#endif
+
 #endif // SLFMT_ROLLING_FILE_LOGGER_H
@@ -0,0 +1,339 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * ScopedTimer.h - Timing of code scopes through the loggers
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_SCOPED_TIMER_H
+#define SLFMT_SCOPED_TIMER_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <fmt/format.h>
+#include <string>
+#include <string_view>
+
+#include "Level.h"
+#include "LoggerBase.h"
+
+#define SLFMT_TIMER_CONCAT_INNER(a, b) a##b
+#define SLFMT_TIMER_CONCAT(a, b) SLFMT_TIMER_CONCAT_INNER(a, b)
+
+/**
+ * @brief Logs how long the rest of the enclosing scope takes ("name took 1.25 ms"), at the DEBUG level.
+ *
+ * @param logger A pointer to the logger (e.g. a field declared with SLFMT_CONSOLE_LOGGER_FIELD).
+ * @param name The name of the scope.
+ */
+#define SLFMT_TIMED_SCOPE(logger, name)                                                                                \
+    slfmt::ScopedTimer SLFMT_TIMER_CONCAT(slfmtTimer, __LINE__)(*(logger), name)
+
+/**
+ * @brief Times the rest of the enclosing scope into a histogram of the call site, logged periodically as a summary
+ * (see TimerHistogram) instead of one line per call.
+ *
+ * @note The histogram is a static of the call site, created with the logger of the first call: every call must pass
+ * the same logger, and it must outlive the histogram (e.g. a static field declared with SLFMT_CONSOLE_LOGGER_FIELD).
+ * To time a scope into a logger of each instance, give each instance its own TimerHistogram.
+ *
+ * @param logger A pointer to the logger (e.g. a field declared with SLFMT_CONSOLE_LOGGER_FIELD).
+ * @param name The name of the scope.
+ */
+#define SLFMT_TIMED_SCOPE_SUMMARY(logger, name)                                                                        \
+    static slfmt::TimerHistogram SLFMT_TIMER_CONCAT(slfmtHistogram, __LINE__)(*(logger), name);                       \
+    slfmt::ScopedTimer SLFMT_TIMER_CONCAT(slfmtTimer, __LINE__)(SLFMT_TIMER_CONCAT(slfmtHistogram, __LINE__))
+
+namespace slfmt {
+    /**
+     * @brief Durations of a timed scope, aggregated and logged periodically as a summary ("name: 1200 calls in 10 s,
+     * avg 35.2 us, min 20.1 us, p50 32.8 us, p90 65.5 us, p99 131.1 us, max 180.4 us").
+     *
+     * @note Recording a duration only updates a few atomic counters (the durations are counted in power of two
+     * buckets of nanoseconds, so the percentiles are the upper bounds of their buckets). The first recording after
+     * each interval logs the summary of the interval and starts the next one; the last one is logged when the
+     * histogram is destroyed, so it must be destroyed before the logger.
+     */
+    class TimerHistogram {
+    public:
+        static constexpr auto DEFAULT_INTERVAL = std::chrono::seconds(10);
+
+        /**
+         * @brief Creates a new histogram.
+         *
+         * @param logger The logger to write the summaries with.
+         * @param name The name of the timed scope.
+         * @param level The level of the summaries (nothing is timed if the logger does not write it).
+         * @param interval How often the summary is logged.
+         */
+        TimerHistogram(LoggerBase &logger, const std::string_view name, const Level level = Level::DEBUG,
+                       const std::chrono::milliseconds interval = DEFAULT_INTERVAL)
+            : m_logger(logger), m_name(name), m_level(level), m_interval(interval),
+              m_start(Ticks(std::chrono::steady_clock::now())),
+              m_nextReport(Ticks(std::chrono::steady_clock::now() + interval)) {}
+
+        TimerHistogram(const TimerHistogram &) = delete;
+        TimerHistogram &operator=(const TimerHistogram &) = delete;
+
+        /**
+         * @brief Logs the summary of the durations not summarized yet.
+         */
+        ~TimerHistogram() {
+            try {
+                Report(std::chrono::steady_clock::now());
+            } catch (...) {
+                // A destructor must not throw.
+            }
+        }
+
+        /**
+         * @brief Checks if the durations are recorded (if the logger writes the level of the summaries).
+         *
+         * @return True if the scopes must be timed.
+         */
+        FMT_NODISCARD bool IsEnabled() const {
+            return m_logger.IsEnabled(m_level);
+        }
+
+        /**
+         * @brief Records the duration of a call, and logs the summary if the interval is over.
+         *
+         * @param elapsed The duration of the call.
+         * @param now The current time (when the call ended).
+         */
+        void Record(const std::chrono::nanoseconds elapsed, const std::chrono::steady_clock::time_point now) {
+            const auto nanos = static_cast<std::uint64_t>(std::max<std::int64_t>(elapsed.count(), 0));
+            const auto bucket = std::min<size_t>(static_cast<size_t>(std::bit_width(nanos)), BUCKETS - 1);
+
+            m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+            m_count.fetch_add(1, std::memory_order_relaxed);
+            m_total.fetch_add(nanos, std::memory_order_relaxed);
+            UpdateMin(nanos);
+            UpdateMax(nanos);
+
+            auto next = m_nextReport.load(std::memory_order_relaxed);
+
+            // Only the call that moves the next report forward writes the summary.
+            if (Ticks(now) >= next &&
+                m_nextReport.compare_exchange_strong(next, Ticks(now + m_interval), std::memory_order_relaxed)) {
+                Report(now);
+            }
+        }
+
+        /**
+         * @brief Logs the summary of the durations recorded since the last one (nothing if there are none).
+         */
+        void Report() {
+            Report(std::chrono::steady_clock::now());
+        }
+
+        /**
+         * @brief Formats a duration with a unit that keeps it readable ("850 ns", "35.2 us", "1.25 ms", "2.01 s").
+         *
+         * @param duration The duration to format.
+         *
+         * @return The formatted duration.
+         */
+        static std::string FormatDuration(const std::chrono::nanoseconds duration) {
+            const auto nanos = static_cast<double>(duration.count());
+
+            if (duration < std::chrono::microseconds(1)) {
+                return fmt::format("{} ns", duration.count());
+            }
+
+            if (duration < std::chrono::milliseconds(1)) {
+                return fmt::format("{:.1f} us", nanos / 1e3);
+            }
+
+            if (duration < std::chrono::seconds(1)) {
+                return fmt::format("{:.2f} ms", nanos / 1e6);
+            }
+
+            return fmt::format("{:.2f} s", nanos / 1e9);
+        }
+
+    private:
+        /**
+         * @brief Bucket <code>b</code> counts the durations of <code>b</code> significant bits (in nanoseconds).
+         */
+        static constexpr size_t BUCKETS = 64;
+
+        LoggerBase &m_logger;
+        const std::string m_name;
+        const Level m_level;
+        const std::chrono::milliseconds m_interval;
+
+        std::array<std::atomic<std::uint64_t>, BUCKETS> m_buckets{};
+        std::atomic<std::uint64_t> m_count = 0;
+        std::atomic<std::uint64_t> m_total = 0;
+        std::atomic<std::uint64_t> m_min = UINT64_MAX;
+        std::atomic<std::uint64_t> m_max = 0;
+
+        /**
+         * @brief When the current interval started (steady clock ticks).
+         */
+        std::atomic<std::chrono::steady_clock::rep> m_start;
+
+        /**
+         * @brief When the summary is logged next (steady clock ticks).
+         */
+        std::atomic<std::chrono::steady_clock::rep> m_nextReport;
+
+        void UpdateMin(const std::uint64_t nanos) {
+            auto current = m_min.load(std::memory_order_relaxed);
+
+            while (nanos < current && !m_min.compare_exchange_weak(current, nanos, std::memory_order_relaxed)) {
+            }
+        }
+
+        void UpdateMax(const std::uint64_t nanos) {
+            auto current = m_max.load(std::memory_order_relaxed);
+
+            while (nanos > current && !m_max.compare_exchange_weak(current, nanos, std::memory_order_relaxed)) {
+            }
+        }
+
+        void Report(const std::chrono::steady_clock::time_point now) {
+            // Durations recorded meanwhile go to this summary or to the next one.
+            const auto count = m_count.exchange(0, std::memory_order_relaxed);
+            const auto start = m_start.exchange(Ticks(now), std::memory_order_relaxed);
+
+            if (count == 0) {
+                return;
+            }
+
+            std::array<std::uint64_t, BUCKETS> buckets{};
+            std::uint64_t bucketed = 0;
+
+            for (size_t i = 0; i < BUCKETS; i++) {
+                buckets[i] = m_buckets[i].exchange(0, std::memory_order_relaxed);
+                bucketed += buckets[i];
+            }
+
+            const auto total = m_total.exchange(0, std::memory_order_relaxed);
+            const auto max = m_max.exchange(0, std::memory_order_relaxed);
+            const auto min = std::min(m_min.exchange(UINT64_MAX, std::memory_order_relaxed), max);
+
+            const auto percentile = [&](const double fraction) {
+                const auto rank = std::max<std::uint64_t>(
+                        static_cast<std::uint64_t>(fraction * static_cast<double>(bucketed) + 0.5), 1);
+                std::uint64_t seen = 0;
+
+                for (size_t i = 0; i < BUCKETS; i++) {
+                    seen += buckets[i];
+
+                    if (seen >= rank) {
+                        const auto upper = i == 0 ? 0 : (std::uint64_t{ 1 } << i) - 1;
+                        return Format(std::clamp(upper, min, max));
+                    }
+                }
+
+                return Format(max);
+            };
+
+            const auto period = now - std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(start));
+
+            m_logger.Log(m_level, "{}: {} calls in {}, avg {}, min {}, p50 {}, p90 {}, p99 {}, max {}", m_name, count,
+                         FormatDuration(std::chrono::duration_cast<std::chrono::nanoseconds>(period)),
+                         Format(total / count), Format(min), percentile(0.5), percentile(0.9), percentile(0.99),
+                         Format(max));
+        }
+
+        template<typename TimePoint>
+        static std::chrono::steady_clock::rep Ticks(const TimePoint time) {
+            return std::chrono::time_point_cast<std::chrono::steady_clock::duration>(time).time_since_epoch().count();
+        }
+
+        static std::string Format(const std::uint64_t nanos) {
+            return FormatDuration(std::chrono::nanoseconds(static_cast<std::int64_t>(nanos)));
+        }
+    };
+
+    /**
+     * @brief Measures the time until it is destroyed (or stopped), and logs it ("name took 1.25 ms") or records it
+     * in a TimerHistogram.
+     *
+     * @note Nothing is measured if the logger does not write the level of the message. Durations are measured with
+     * <code>std::chrono::steady_clock</code> (read without a system call on the usual platforms) rather than with
+     * Clock, whose time follows the adjustments of the system clock.
+     */
+    class ScopedTimer {
+    public:
+        /**
+         * @brief Starts timing a scope whose duration is logged on its own.
+         *
+         * @param logger The logger to write the duration with.
+         * @param name The name of the scope.
+         * @param level The level of the message.
+         */
+        ScopedTimer(LoggerBase &logger, const std::string_view name, const Level level = Level::DEBUG)
+            : m_logger(&logger), m_name(name), m_level(level), m_running(logger.IsEnabled(level)) {
+            if (m_running) {
+                m_start = std::chrono::steady_clock::now();
+            }
+        }
+
+        /**
+         * @brief Starts timing a scope whose duration is recorded in a histogram.
+         *
+         * @param histogram The histogram of the scope.
+         */
+        explicit ScopedTimer(TimerHistogram &histogram) : m_histogram(&histogram), m_running(histogram.IsEnabled()) {
+            if (m_running) {
+                m_start = std::chrono::steady_clock::now();
+            }
+        }
+
+        ScopedTimer(const ScopedTimer &) = delete;
+        ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+        ~ScopedTimer() {
+            try {
+                Stop();
+            } catch (...) {
+                // A destructor must not throw.
+            }
+        }
+
+        /**
+         * @brief Stops the timer before the end of the scope, and logs or records the duration.
+         *
+         * @return The duration, or zero if nothing was measured (or the timer was already stopped).
+         */
+        std::chrono::nanoseconds Stop() {
+            if (!m_running) {
+                return std::chrono::nanoseconds::zero();
+            }
+
+            m_running = false;
+            const auto now = std::chrono::steady_clock::now();
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_start);
+
+            if (m_histogram != nullptr) {
+                m_histogram->Record(elapsed, now);
+            } else {
+                m_logger->Log(m_level, "{} took {}", m_name, TimerHistogram::FormatDuration(elapsed));
+            }
+
+            return elapsed;
+        }
+
+    private:
+        LoggerBase *m_logger = nullptr;
+        TimerHistogram *m_histogram = nullptr;
+        const std::string_view m_name{};
+        const Level m_level = Level::DEBUG;
+        bool m_running;
+        std::chrono::steady_clock::time_point m_start{};
+    };
+} // namespace slfmt
+
+#endif // SLFMT_SCOPED_TIMER_H
@@ -0,0 +1,53 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * ShmLogger-inl.h - Implementation of the shared memory logger
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_SHM_LOGGER_INL_H
+#define SLFMT_SHM_LOGGER_INL_H
+
+#ifndef _WIN32
+
+    #include <slfmt/Clock.h>
+    #include <slfmt/LogFormat.h>
+
+    #include "ShmLogger.h"
+
+namespace slfmt {
+    SLFMT_INLINE ShmLogger::ShmLogger(const std::string_view &clazz, const std::string_view &ringName,
+                                      const size_t capacity)
+        : LoggerBase(clazz), m_ringName(ringName), m_capacity(capacity) {}
+
+    SLFMT_INLINE ShmLogger::~ShmLogger() {
+        FlushRepeats();
+    }
+
+    SLFMT_INLINE void ShmLogger::Write(const Record &record) {
+        m_open.Run([this] {
+            m_ring = std::make_unique<ShmRing>(m_ringName, m_capacity);
+        });
+
+        // Formatted once per thread, not per message.
+        thread_local const std::string threadId = LogFormat::GetThreadIdString();
+
+        // Rendered now: the agent has neither the call site fields nor the context of this thread.
+        thread_local std::string attributes;
+        const auto captured = LogFormat::Attributes::Capture();
+        attributes.resize(captured.SerializedSize());
+        captured.Serialize(attributes.data());
+
+        if (!m_ring->Write(record.level, Clock::Now(), record.clazz, threadId, record.message, attributes)) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+} // namespace slfmt
+
+#endif // _WIN32
+
+#endif // SLFMT_SHM_LOGGER_INL_H
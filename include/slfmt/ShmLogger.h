@@ -0,0 +1,88 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * ShmLogger.h - Shared memory logger for slfmt
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_SHM_LOGGER_H
+#define SLFMT_SHM_LOGGER_H
+
+#ifndef _WIN32
+
+    #include <atomic>
+    #include <memory>
+    #include <slfmt/Config.h>
+    #include <slfmt/LazyInit.h>
+    #include <slfmt/LoggerBase.h>
+    #include <slfmt/ShmRing.h>
+    #include <string>
+
+namespace slfmt {
+    /**
+     * @brief Logger that hands its messages to another process (<code>slfmt-agent</code>) through a ring in shared
+     * memory (see ShmRing).
+     *
+     * @note Logging copies the class, thread ID, message, call site fields and diagnostic context into the ring,
+     * without formatting, locking or system calls: the agent formats the messages and writes them to its file or
+     * rolling file. If the ring is full (the agent is not running or cannot keep up), messages are dropped (see
+     * Dropped()). The messages already in the ring are not lost if the program crashes. Any number of loggers, in
+     * any number of processes, can write to the same ring. Not available on Windows.
+     */
+    class ShmLogger : public LoggerBase {
+    public:
+        /**
+         * @brief Constructs a new logger for the specified class and ring.
+         *
+         * @note The ring is created (or attached to) when the first message is logged.
+         *
+         * @param clazz The class to create a logger for.
+         * @param ringName The name of the shared memory ring (e.g. "/myapp-log").
+         * @param capacity The size (in bytes) of the ring, if this logger creates it.
+         */
+        ShmLogger(const std::string_view &clazz, const std::string_view &ringName,
+                  size_t capacity = ShmRing::DEFAULT_CAPACITY);
+
+        ~ShmLogger() override;
+
+        /**
+         * @brief Gets the number of messages of this logger dropped so far because the ring was full.
+         *
+         * @return The number of dropped messages.
+         */
+        FMT_NODISCARD std::uint64_t Dropped() const {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Writes a record to the ring (or drops it if the ring is full).
+         *
+         * @param record The record to write.
+         */
+        void Write(const Record &record) override;
+
+    private:
+        const std::string m_ringName;
+        const size_t m_capacity;
+
+        /**
+         * @brief Opens the ring when the first message is logged.
+         */
+        LazyInit m_open;
+
+        std::unique_ptr<ShmRing> m_ring;
+        std::atomic<std::uint64_t> m_dropped = 0;
+    };
+} // namespace slfmt
+
+    #ifndef SLFMT_COMPILED_LIB
+        #include "ShmLogger-inl.h"
+    #endif
+
+#endif // _WIN32
+
+#endif // SLFMT_SHM_LOGGER_H
@@ -0,0 +1,554 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * ShmRing.h - Lock-free ring of log records in POSIX shared memory
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_SHM_RING_H
+#define SLFMT_SHM_RING_H
+
+#ifndef _WIN32
+
+    #include <algorithm>
+    #include <atomic>
+    #include <cerrno>
+    #include <chrono>
+    #include <cstdint>
+    #include <cstring>
+    #include <csignal>
+    #include <fcntl.h>
+    #include <fmt/format.h>
+    #include <stdexcept>
+    #include <string>
+    #include <string_view>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <thread>
+    #include <unistd.h>
+
+    #include "Clock.h"
+    #include "Level.h"
+
+namespace slfmt {
+    /**
+     * @brief Ring buffer of log records in POSIX shared memory (<code>shm_open</code> + <code>mmap</code>), written
+     * by the threads of one or more processes and read by a single consumer (e.g. <code>slfmt-agent</code>).
+     *
+     * @note Writers reserve the space of a record by claiming its header (storing its size with a compare-and-swap)
+     * and then moving the end of the reserved space past it; the writers that find a claimed header help move the end.
+     * The record is then copied in place, so writing takes no lock and costs a <code>memcpy</code> of the record. A
+     * record is published by storing its state last; the consumer reads records in order, waiting for the next one
+     * to be published. When the ring is full, records are
+     * dropped (and counted), so writers never block. The shared memory object outlives the processes: the records
+     * written by a process that crashed can still be read (see Remove()). Not available on Windows.
+     */
+    class ShmRing {
+    public:
+        /**
+         * @brief A record read from the ring. The strings point into the buffer passed to Read().
+         */
+        struct Record {
+            Level level = Level::UNKNOWN;
+            Clock::TimePoint time{};
+            std::string_view clazz{};
+            std::string_view thread{};
+            std::string_view message{};
+
+            /**
+             * @brief The call site fields and diagnostic context of the record, serialized (see
+             * LogFormat::Attributes::Serialize()), or empty.
+             */
+            std::string_view attributes{};
+        };
+
+        static constexpr size_t DEFAULT_CAPACITY = 4 * 1024 * 1024;
+        static constexpr size_t MIN_CAPACITY = 64 * 1024;
+
+        /**
+         * @brief Creates the ring with the specified name, or attaches to it if it already exists.
+         *
+         * @param name The name of the shared memory object (e.g. "/myapp-log").
+         * @param capacity The size (in bytes) of the ring if it is created, rounded up to a power of two. An
+         * existing ring keeps its size.
+         */
+        explicit ShmRing(const std::string &name, const size_t capacity = DEFAULT_CAPACITY) {
+            int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+            const bool created = fd >= 0;
+
+            if (!created && errno == EEXIST) {
+                fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0600);
+            }
+
+            if (fd < 0) {
+                throw std::runtime_error(
+                        fmt::format("Failed to open shared memory {}: {}", name, std::strerror(errno)));
+            }
+
+            try {
+                if (created) {
+                    Create(fd, RoundCapacity(capacity));
+                } else {
+                    Attach(fd, name);
+                }
+            } catch (...) {
+                ::close(fd);
+                throw;
+            }
+
+            ::close(fd); // The mapping keeps the object alive.
+        }
+
+        ShmRing(const ShmRing &) = delete;
+        ShmRing &operator=(const ShmRing &) = delete;
+
+        ~ShmRing() {
+            ::munmap(m_memory, m_mappedSize);
+        }
+
+        /**
+         * @brief Removes the shared memory object of a ring. Processes attached to it keep their mapping.
+         *
+         * @param name The name of the ring.
+         */
+        static void Remove(const std::string &name) {
+            shm_unlink(name.c_str());
+        }
+
+        /**
+         * @brief Writes a record at the end of the ring.
+         *
+         * @param level The level of the record.
+         * @param time When the record was logged.
+         * @param clazz The class that logged it.
+         * @param thread The thread that logged it.
+         * @param message The message.
+         * @param attributes The serialized fields and context of the message (copied as is, empty if none).
+         *
+         * @return False if the record was dropped, because the ring is full (or the record is larger than a
+         * quarter of it).
+         */
+        bool Write(const Level level, const Clock::TimePoint time, std::string_view clazz, std::string_view thread,
+                   std::string_view message, const std::string_view attributes = {}) {
+            clazz = clazz.substr(0, UINT16_MAX);
+            thread = thread.substr(0, UINT16_MAX);
+            const size_t size =
+                    Align(sizeof(RecordHeader) + clazz.size() + thread.size() + message.size() + attributes.size());
+
+            if (size > m_capacity / 4) {
+                Ref(m_header->dropped).fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            auto position = Ref(m_header->reserved).load(std::memory_order_acquire);
+
+            while (true) {
+                // A record never wraps around: the space left at the end is skipped with a padding record.
+                const auto offset = position & (m_capacity - 1);
+                const std::uint64_t padding = offset + size > m_capacity ? m_capacity - offset : 0;
+                const auto consumed = Ref(m_header->consumed).load(std::memory_order_acquire);
+
+                // Stale: other writers reserved the position and the consumer already read past it.
+                if (position < consumed) {
+                    position = Ref(m_header->reserved).load(std::memory_order_acquire);
+                    continue;
+                }
+
+                if (position + padding + size - consumed > m_capacity) {
+                    Ref(m_header->dropped).fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                // The header at the end of the reserved space is claimed (with its size, and the process of the
+                // writer) before the end is moved past it, so the size of a reserved record is known even if its
+                // writer dies right away.
+                const auto claim = padding > 0 ? padding | PADDING : size | m_pid << PID_SHIFT;
+                auto state = Ref(At(position)->state).load(std::memory_order_acquire);
+
+                if (state == FreeState(position) &&
+                    Ref(At(position)->state).compare_exchange_strong(state, claim, std::memory_order_acq_rel)) {
+                    Advance(position, claim);
+
+                    if (padding == 0) {
+                        break;
+                    }
+
+                    position += padding;
+                    continue;
+                }
+
+                // Claimed by another writer: help it move the end of the reserved space, and try again after it.
+                if (IsClaimed(state)) {
+                    Advance(position, state);
+                }
+
+                position = Ref(m_header->reserved).load(std::memory_order_acquire);
+            }
+
+            auto *record = At(position);
+            record->time = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+            record->level = static_cast<std::uint32_t>(level);
+            record->classSize = static_cast<std::uint16_t>(clazz.size());
+            record->threadSize = static_cast<std::uint16_t>(thread.size());
+            record->messageSize = static_cast<std::uint32_t>(message.size());
+            record->attributesSize = static_cast<std::uint32_t>(attributes.size());
+
+            auto *data = reinterpret_cast<char *>(record + 1);
+            std::memcpy(data, clazz.data(), clazz.size());
+            std::memcpy(data + clazz.size(), thread.data(), thread.size());
+            std::memcpy(data + clazz.size() + thread.size(), message.data(), message.size());
+            std::memcpy(data + clazz.size() + thread.size() + message.size(), attributes.data(), attributes.size());
+
+            // Fails if the consumer skipped the record (see Read()).
+            std::uint64_t claimed = size | m_pid << PID_SHIFT;
+            return Ref(record->state).compare_exchange_strong(claimed, size | PUBLISHED, std::memory_order_release,
+                                                              std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Reads the next record of the ring (only one consumer may read a ring).
+         *
+         * @note A record that stays unpublished longer than the timeout is skipped if the process that claimed it
+         * is gone (it died while writing the record). The record of a live process (a slow, preempted or stopped
+         * writer) is waited for, and checked again after each timeout: its writer still owns the space.
+         *
+         * @param buffer The buffer to copy the strings of the record to.
+         * @param record The record read.
+         * @param stallTimeout How long to wait for an unpublished record before skipping it.
+         *
+         * @return False if there are no records to read (yet).
+         */
+        bool Read(std::string &buffer, Record &record,
+                  const std::chrono::milliseconds stallTimeout = std::chrono::seconds(1)) {
+            while (true) {
+                const auto position = Ref(m_header->consumed).load(std::memory_order_relaxed);
+
+                if (position == Ref(m_header->reserved).load(std::memory_order_acquire)) {
+                    // A writer may have died between claiming the header and moving the end of the reserved space.
+                    if (const auto state = Ref(At(position)->state).load(std::memory_order_acquire);
+                        IsClaimed(state)) {
+                        Advance(position, state);
+                        continue;
+                    }
+
+                    return false;
+                }
+
+                auto *header = At(position);
+                const auto state = Ref(header->state).load(std::memory_order_acquire);
+                const auto size = state & SIZE_MASK;
+
+                if ((state & (PUBLISHED | PADDING)) == 0) {
+                    if (!IsStalled(position, stallTimeout)) {
+                        return false;
+                    }
+
+                    if (IsAlive(state >> PID_SHIFT)) {
+                        m_stalledPosition = UINT64_MAX; // Wait for another timeout.
+                        return false;
+                    }
+
+                    Ref(m_header->dropped).fetch_add(1, std::memory_order_relaxed);
+                    Consume(position, size);
+                    continue;
+                }
+
+                if ((state & PADDING) != 0) {
+                    Consume(position, size);
+                    continue;
+                }
+
+                // Never trust the sizes of the strings beyond the record (the ring is shared with other processes).
+                const auto stringsSize = static_cast<size_t>(header->classSize) + header->threadSize +
+                                         header->messageSize + header->attributesSize;
+
+                if (size < sizeof(RecordHeader) || stringsSize > size - sizeof(RecordHeader)) {
+                    Ref(m_header->dropped).fetch_add(1, std::memory_order_relaxed);
+                    Consume(position, size);
+                    continue;
+                }
+
+                const auto *data = reinterpret_cast<const char *>(header + 1);
+                buffer.assign(data, stringsSize);
+
+                record.level = static_cast<Level>(header->level);
+                record.time = Clock::TimePoint(std::chrono::duration_cast<Clock::TimePoint::duration>(
+                        std::chrono::nanoseconds(header->time)));
+                record.clazz = std::string_view(buffer).substr(0, header->classSize);
+                record.thread = std::string_view(buffer).substr(header->classSize, header->threadSize);
+                record.message =
+                        std::string_view(buffer).substr(header->classSize + header->threadSize, header->messageSize);
+                record.attributes = std::string_view(buffer).substr(header->classSize + header->threadSize +
+                                                                    header->messageSize);
+
+                Consume(position, size);
+                return true;
+            }
+        }
+
+        /**
+         * @brief Gets the number of records dropped so far (by all the writers).
+         *
+         * @return The number of dropped records.
+         */
+        FMT_NODISCARD std::uint64_t Dropped() const {
+            return Ref(m_header->dropped).load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Gets the size of the ring.
+         *
+         * @return The capacity in bytes.
+         */
+        FMT_NODISCARD size_t Capacity() const {
+            return m_capacity;
+        }
+
+    private:
+        static constexpr std::uint64_t MAGIC = 0x474e4952544d464cULL; // "LFMTRING"
+        static constexpr std::uint32_t VERSION = 5;
+
+        static constexpr std::uint64_t SIZE_MASK = 0xffffffffULL;
+        static constexpr std::uint64_t PUBLISHED = 1ULL << 32;
+        static constexpr std::uint64_t PADDING = 1ULL << 33;
+
+        /**
+         * @brief The bits of a claimed, unpublished record state holding the process ID of its writer (Linux PIDs
+         * take at most 22 bits, so a claim never looks like the free state).
+         */
+        static constexpr unsigned PID_SHIFT = 34;
+
+        /**
+         * @brief Marks the free space, in the high half of each of its words (see FreeState()).
+         */
+        static constexpr std::uint64_t FREE = 0x46524545ULL << 32; // "FREE"
+
+        /**
+         * @brief The header of the ring, at the start of the shared memory. The counters are positions in an
+         * infinite stream of bytes (the offset in the ring is the position modulo the capacity).
+         */
+        struct alignas(64) Header {
+            std::uint64_t magic;
+            std::uint32_t version;
+            std::uint32_t reserved0;
+            std::uint64_t capacity;
+
+            /**
+             * @brief The end of the space reserved by the writers.
+             */
+            alignas(64) std::uint64_t reserved;
+
+            /**
+             * @brief The end of the records read by the consumer.
+             */
+            alignas(64) std::uint64_t consumed;
+
+            alignas(64) std::uint64_t dropped;
+        };
+
+        /**
+         * @brief The header of a record, followed by its class, thread, message and attributes (padded to 8 bytes).
+         */
+        struct RecordHeader {
+            /**
+             * @brief The size of the record (header included) and whether it is published or padding, or the free
+             * state of the position if the space is free.
+             */
+            std::uint64_t state;
+
+            /**
+             * @brief Nanoseconds since the epoch.
+             */
+            std::int64_t time;
+
+            std::uint32_t level;
+            std::uint16_t classSize;
+            std::uint16_t threadSize;
+            std::uint32_t messageSize;
+
+            /**
+             * @brief The size of the serialized attributes (0 if the record has neither fields nor context).
+             */
+            std::uint32_t attributesSize;
+        };
+
+        Header *m_header = nullptr;
+        char *m_data = nullptr;
+        void *m_memory = nullptr;
+        size_t m_mappedSize = 0;
+        size_t m_capacity = 0;
+
+        /**
+         * @brief The process ID the records are claimed with (so the consumer can tell a dead writer from a slow
+         * one). A process forked after attaching keeps the ID of its parent.
+         */
+        std::uint64_t m_pid = static_cast<std::uint64_t>(::getpid());
+
+        /**
+         * @brief The unpublished record the consumer is waiting for, and since when.
+         */
+        std::uint64_t m_stalledPosition = UINT64_MAX;
+        std::chrono::steady_clock::time_point m_stalledSince{};
+
+        static std::atomic_ref<std::uint64_t> Ref(std::uint64_t &value) {
+            return std::atomic_ref<std::uint64_t>(value);
+        }
+
+        static size_t Align(const size_t size) {
+            return (size + 7) & ~static_cast<size_t>(7);
+        }
+
+        static size_t RoundCapacity(const size_t capacity) {
+            size_t rounded = MIN_CAPACITY;
+
+            while (rounded < capacity) {
+                rounded *= 2;
+            }
+
+            return rounded;
+        }
+
+        FMT_NODISCARD RecordHeader *At(const std::uint64_t position) const {
+            return reinterpret_cast<RecordHeader *>(m_data + (position & (m_capacity - 1)));
+        }
+
+        void Map(const int fd, const size_t capacity) {
+            m_mappedSize = sizeof(Header) + capacity;
+            m_memory = ::mmap(nullptr, m_mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+            if (m_memory == MAP_FAILED) {
+                throw std::runtime_error(fmt::format("Failed to map shared memory: {}", std::strerror(errno)));
+            }
+
+            m_header = static_cast<Header *>(m_memory);
+            m_data = static_cast<char *>(m_memory) + sizeof(Header);
+            m_capacity = capacity;
+        }
+
+        void Create(const int fd, const size_t capacity) {
+            if (::ftruncate(fd, static_cast<off_t>(sizeof(Header) + capacity)) != 0) {
+                throw std::runtime_error(fmt::format("Failed to size shared memory: {}", std::strerror(errno)));
+            }
+
+            Map(fd, capacity);
+            Clear(0, capacity);
+            m_header->version = VERSION;
+            m_header->capacity = capacity;
+            Ref(m_header->magic).store(MAGIC, std::memory_order_release);
+        }
+
+        void Attach(const int fd, const std::string &name) {
+            // The creator may still be initializing the ring.
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            struct stat info {};
+
+            while (::fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) < sizeof(Header)) {
+                if (std::chrono::steady_clock::now() > deadline) {
+                    throw std::runtime_error(fmt::format("Shared memory {} is not a log ring.", name));
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            const auto capacity = static_cast<size_t>(info.st_size) - sizeof(Header);
+
+            if (capacity < MIN_CAPACITY || (capacity & (capacity - 1)) != 0) {
+                throw std::runtime_error(fmt::format("Shared memory {} is not a log ring.", name));
+            }
+
+            Map(fd, capacity);
+
+            while (Ref(m_header->magic).load(std::memory_order_acquire) != MAGIC) {
+                if (std::chrono::steady_clock::now() > deadline) {
+                    ::munmap(m_memory, m_mappedSize);
+                    throw std::runtime_error(fmt::format("Shared memory {} is not a log ring.", name));
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            if (m_header->version != VERSION || m_header->capacity != capacity) {
+                ::munmap(m_memory, m_mappedSize);
+                throw std::runtime_error(fmt::format("Shared memory {} has an incompatible log ring.", name));
+            }
+        }
+
+        /**
+         * @brief Checks if the unpublished record at a position has been waited for longer than the timeout.
+         */
+        bool IsStalled(const std::uint64_t position, const std::chrono::milliseconds timeout) {
+            const auto now = std::chrono::steady_clock::now();
+
+            if (position != m_stalledPosition) {
+                m_stalledPosition = position;
+                m_stalledSince = now;
+                return false;
+            }
+
+            return now - m_stalledSince > timeout;
+        }
+
+        /**
+         * @brief Releases the space of a record to the writers, clearing it so no stale state is read as a
+         * record the next time around.
+         */
+        void Consume(const std::uint64_t position, const std::uint64_t size) {
+            Clear(position + m_capacity, size);
+            Ref(m_header->consumed).store(position + size, std::memory_order_release);
+        }
+
+        /**
+         * @brief Fills a space (that never wraps around) with the free state of its positions. The header goes
+         * straight from the record state to the free state.
+         *
+         * @param position The position the space is free for (in the next lap for consumed records).
+         * @param size The size of the space.
+         */
+        void Clear(const std::uint64_t position, const std::uint64_t size) {
+            const auto free = FreeState(position);
+            auto *words = reinterpret_cast<std::uint64_t *>(At(position));
+            Ref(words[0]).store(free, std::memory_order_relaxed);
+            std::fill(words + 1, words + size / sizeof(std::uint64_t), free);
+        }
+
+        /**
+         * @brief Moves the end of the reserved space past the record claimed at a position (unless it already is).
+         *
+         * @param position The position of the record.
+         * @param state The state of its header.
+         */
+        void Advance(std::uint64_t position, const std::uint64_t state) {
+            Ref(m_header->reserved)
+                    .compare_exchange_strong(position, position + (state & SIZE_MASK), std::memory_order_acq_rel);
+        }
+
+        /**
+         * @brief Gets the state of a free word at a position: FREE and the lap of the ring of the position. Every word
+         * of the free space holds it, and a header can only be claimed in this exact state, so that a writer holding
+         * a stale position (the ring went round while it was preempted) finds neither the state of its lap in the
+         * records written since, nor a zero in the middle of them.
+         */
+        FMT_NODISCARD std::uint64_t FreeState(const std::uint64_t position) const {
+            return FREE | ((position / m_capacity) & SIZE_MASK);
+        }
+
+        /**
+         * @brief Checks if the process that claimed a record still exists.
+         */
+        static bool IsAlive(const std::uint64_t pid) {
+            return pid != 0 && (::kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM);
+        }
+
+        static bool IsClaimed(const std::uint64_t state) {
+            return (state & ~SIZE_MASK) != FREE;
+        }
+    };
+} // namespace slfmt
+
+#endif // _WIN32
+
+#endif // SLFMT_SHM_RING_H
@@ -0,0 +1,108 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * Sink.h - Destinations of the log records
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_SINK_H
+#define SLFMT_SINK_H
+
+#include <fmt/format.h>
+#include <string_view>
+
+#include "Level.h"
+#include "LogBatch.h"
+
+/**
+ * @brief The placeholders of the log format (see LogFormat) replaced with the fields of a record.
+ */
+#define FORMAT_MAPPED_PARAMS_FOR_RECORD(record)                                                                        \
+    {                                                                                                                  \
+        { "{L}", slfmt::LevelToString((record).level) }, { "{C}", (record).clazz }, {                                  \
+            "{M}", (record).message                                                                                    \
+        }                                                                                                              \
+    }
+
+namespace slfmt {
+    /**
+     * @brief A log message, already formatted, as handed to the sinks.
+     *
+     * @note The record only refers to its strings: a sink that keeps it beyond Write() must copy them.
+     */
+    struct Record {
+        /**
+         * @brief The level of the message.
+         */
+        Level level;
+
+        /**
+         * @brief The class of the logger that logged the message.
+         */
+        std::string_view clazz;
+
+        /**
+         * @brief The formatted message.
+         */
+        std::string_view message;
+    };
+
+    /**
+     * @brief Where log records are written to (a file, the console, a socket, other sinks...).
+     *
+     * @note Every logger is a sink, so several loggers (e.g. one per class, see SinkLogger) can share one: the
+     * records carry the class they were logged with. A new sink only has to implement Write(). Sinks must accept
+     * records from several threads at once.
+     */
+    class Sink {
+    public:
+        Sink() = default;
+
+        Sink(const Sink &) = delete;
+        Sink(Sink &&) = delete;
+
+        Sink &operator=(const Sink &) = delete;
+        Sink &operator=(Sink &&) = delete;
+
+        virtual ~Sink() = default;
+
+        /**
+         * @brief Writes a record.
+         *
+         * @param record The record to write.
+         */
+        virtual void Write(const Record &record) = 0;
+
+        /**
+         * @brief Writes the records of a batch (see LogBatch).
+         *
+         * @note By default each record is written on its own. Sinks override it to write the whole batch at once.
+         *
+         * @param clazz The class of the logger that logged the batch.
+         * @param batch The records to write.
+         */
+        virtual void WriteBatch(const std::string_view clazz, const LogBatch &batch) {
+            batch.ForEach([this, clazz](const Level level, const std::string_view msg) {
+                Write({ level, clazz, msg });
+            });
+        }
+
+        /**
+         * @brief Checks if the sink writes records of the specified level (loggers writing to the sink discard the
+         * other records before formatting them).
+         *
+         * @param level The level to check.
+         *
+         * @return True if records of the level are written.
+         */
+        FMT_NODISCARD virtual bool IsEnabled([[maybe_unused]] const Level level) const {
+            return true;
+        }
+    };
+} // namespace slfmt
+
+#endif // SLFMT_SINK_H
@@ -0,0 +1,93 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * SinkLogger.h - Logger that writes to a shared sink
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_SINK_LOGGER_H
+#define SLFMT_SINK_LOGGER_H
+
+#include <memory>
+#include <slfmt/LoggerBase.h>
+#include <slfmt/Sink.h>
+#include <stdexcept>
+
+namespace slfmt {
+    /**
+     * @brief Logger for a class that writes to a sink shared with other loggers (e.g. one file for the whole
+     * program, with one logger per class).
+     *
+     * @note The logger only filters (its own level and the sink's), formats and builds the records: the sink writes
+     * them, tagged with the class of this logger. The sink lives as long as the last logger using it.
+     */
+    class SinkLogger : public LoggerBase {
+    public:
+        /**
+         * @brief Constructs a new logger for the specified class and sink.
+         *
+         * @note Throws std::runtime_error if there is no sink.
+         *
+         * @param clazz The class to create a logger for.
+         * @param sink The sink to write to.
+         */
+        SinkLogger(const std::string_view &clazz, std::shared_ptr<Sink> sink)
+            : LoggerBase(clazz), m_sink(std::move(sink)) {
+            if (m_sink == nullptr) {
+                throw std::runtime_error("A sink logger needs a sink.");
+            }
+        }
+
+        ~SinkLogger() override {
+            FlushRepeats();
+        }
+
+        /**
+         * @brief Gets the sink of the logger.
+         *
+         * @return The sink.
+         */
+        FMT_NODISCARD const std::shared_ptr<Sink> &GetSink() const {
+            return m_sink;
+        }
+
+        /**
+         * @brief Checks if both the logger and its sink write messages of the level.
+         *
+         * @param level The level to check.
+         *
+         * @return True if messages of the level are written.
+         */
+        FMT_NODISCARD bool IsEnabled(const Level level) const override {
+            return LoggerBase::IsEnabled(level) && m_sink->IsEnabled(level);
+        }
+
+        /**
+         * @brief Writes a record to the sink.
+         *
+         * @param record The record to write.
+         */
+        void Write(const Record &record) override {
+            m_sink->Write(record);
+        }
+
+        /**
+         * @brief Writes a batch to the sink, at once.
+         *
+         * @param clazz The class of the records.
+         * @param batch The records to write.
+         */
+        void WriteBatch(const std::string_view clazz, const LogBatch &batch) override {
+            m_sink->WriteBatch(clazz, batch);
+        }
+
+    private:
+        const std::shared_ptr<Sink> m_sink;
+    };
+} // namespace slfmt
+
+#endif // SLFMT_SINK_LOGGER_H
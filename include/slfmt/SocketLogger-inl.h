@@ -0,0 +1,373 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * SocketLogger-inl.h - Implementation of the Unix domain socket logger
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_SOCKET_LOGGER_INL_H
+#define SLFMT_SOCKET_LOGGER_INL_H
+
+#ifndef _WIN32
+
+    #include <algorithm>
+    #include <array>
+    #include <cerrno>
+    #include <ctime>
+    #include <fcntl.h>
+    #include <iterator>
+    #include <slfmt/Clock.h>
+    #include <slfmt/LogFormat.h>
+    #include <unistd.h>
+
+    #include "SocketLogger.h"
+
+namespace slfmt {
+    SLFMT_INLINE SocketLogger::SocketLogger(const std::string_view &clazz, const std::string_view &socketPath,
+                                            Options options)
+        : LoggerBase(clazz), m_socketPath(socketPath), m_options(std::move(options)),
+          m_hostname(HeaderField(Hostname(), 255)), m_procId(std::to_string(::getpid())) {
+        if (m_socketPath.size() >= sizeof(sockaddr_un::sun_path)) {
+            throw std::runtime_error(fmt::format("Socket path is too long: {}", m_socketPath));
+        }
+
+        m_options.batchSize = std::clamp<size_t>(m_options.batchSize, 1, MAX_BATCH_SIZE);
+        m_options.appName = HeaderField(m_options.appName, 48);
+    }
+
+    SLFMT_INLINE SocketLogger::~SocketLogger() {
+        FlushRepeats();
+
+        if (!m_sender.joinable()) {
+            return; // Nothing was logged.
+        }
+
+        {
+            const std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+
+        // The sender thread sends the queued messages (if the socket is reachable) before exiting.
+        m_wakeUp.notify_all();
+        m_sender.join();
+        Disconnect();
+    }
+
+    SLFMT_INLINE bool SocketLogger::Flush(const std::chrono::milliseconds timeout) {
+        std::unique_lock lock(m_mutex);
+        const auto target = m_enqueued;
+
+        return m_idle.wait_for(lock, timeout, [this, target] { return m_completed >= target; });
+    }
+
+    SLFMT_INLINE void SocketLogger::Write(const Record &record) {
+        auto message = m_options.framing == Framing::RFC5424 ? FormatRfc5424(record)
+                                                             : Frame(GetLayout(), record);
+
+        m_start.Run([this] {
+            m_sender = std::thread(&SocketLogger::Run, this);
+        });
+
+        {
+            const std::lock_guard lock(m_mutex);
+
+            if (m_queue.size() >= m_options.queueSize) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            m_queue.push_back(std::move(message));
+            m_enqueued++;
+        }
+
+        m_wakeUp.notify_one();
+    }
+
+    SLFMT_INLINE void SocketLogger::WriteBatch(const std::string_view clazz, const LogBatch &batch) {
+        const auto &format = GetLayout();
+        std::vector<std::string> messages;
+        messages.reserve(batch.Size());
+
+        batch.ForEach([&](const Level level, const std::string_view msg) {
+            if (IsEnabled(level)) {
+                messages.push_back(Frame(format, { level, clazz, msg }));
+            }
+        });
+
+        if (messages.empty()) {
+            return;
+        }
+
+        m_start.Run([this] {
+            m_sender = std::thread(&SocketLogger::Run, this);
+        });
+
+        {
+            const std::lock_guard lock(m_mutex);
+            const auto free = m_options.queueSize - std::min(m_queue.size(), m_options.queueSize);
+            const auto queued = std::min(free, messages.size());
+
+            std::move(messages.begin(), messages.begin() + static_cast<std::ptrdiff_t>(queued),
+                      std::back_inserter(m_queue));
+            m_enqueued += queued;
+            m_dropped.fetch_add(messages.size() - queued, std::memory_order_relaxed);
+        }
+
+        m_wakeUp.notify_one();
+    }
+
+    SLFMT_INLINE std::string SocketLogger::Frame(const LogFormat &format, const Record &record) const {
+        if (m_options.framing == Framing::RFC5424) {
+            return FormatRfc5424(record);
+        }
+
+        return format.Format(FORMAT_MAPPED_PARAMS_FOR_RECORD(record));
+    }
+
+    SLFMT_INLINE std::string SocketLogger::FormatRfc5424(const Record &record) const {
+        const auto now = Clock::Now();
+        const auto time = std::chrono::system_clock::to_time_t(now);
+        const auto millis =
+                std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+
+        tm tm{};
+        gmtime_r(&time, &tm);
+
+        const auto clazz = record.clazz.empty() ? std::string("-") : HeaderField(record.clazz, 32);
+        const int priority = m_options.facility * 8 + Severity(record.level);
+
+        auto message = fmt::format("<{}>1 {:04d}-{:02d}-{:02d}T{:02d}:{:02d}:{:02d}.{:03d}Z {} {} {} {} - {}",
+                                   priority, tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min,
+                                   tm.tm_sec, millis, m_hostname, m_options.appName, m_procId, clazz,
+                                   record.message);
+
+        if (m_options.transport == Transport::STREAM) {
+            message = fmt::format("{} {}", message.size(), message);
+        }
+
+        return message;
+    }
+
+    SLFMT_INLINE void SocketLogger::Run() {
+        std::vector<std::string> batch;
+        auto reconnectDelay = INITIAL_RECONNECT_DELAY;
+
+        while (true) {
+            bool stopping;
+
+            {
+                std::unique_lock lock(m_mutex);
+                m_wakeUp.wait(lock, [this, &batch] { return m_stop || !m_queue.empty() || !batch.empty(); });
+
+                while (batch.size() < m_options.batchSize && !m_queue.empty()) {
+                    batch.push_back(std::move(m_queue.front()));
+                    m_queue.pop_front();
+                }
+
+                if (batch.empty()) {
+                    return; // Stopping, and everything has been sent.
+                }
+
+                stopping = m_stop;
+            }
+
+            const size_t sent = Send(batch);
+            size_t dropped = 0;
+
+            batch.erase(batch.begin(), batch.begin() + static_cast<std::ptrdiff_t>(sent));
+
+            if (batch.empty()) {
+                reconnectDelay = INITIAL_RECONNECT_DELAY;
+            } else if (stopping) {
+                // The socket is not reachable and the logger is being destroyed: give up.
+                dropped = batch.size();
+                batch.clear();
+            }
+
+            {
+                std::unique_lock lock(m_mutex);
+                m_completed += sent + dropped;
+                m_dropped.fetch_add(dropped, std::memory_order_relaxed);
+
+                if (!batch.empty()) {
+                    m_wakeUp.wait_for(lock, reconnectDelay, [this] { return m_stop; });
+                    reconnectDelay = std::min(reconnectDelay * 2, m_options.maxReconnectDelay);
+                }
+            }
+
+            m_idle.notify_all();
+        }
+    }
+
+    SLFMT_INLINE size_t SocketLogger::Send(const std::vector<std::string> &batch) {
+        if (m_fd < 0 && !Connect()) {
+            return 0;
+        }
+
+        const size_t sent = m_options.transport == Transport::DATAGRAM ? SendDatagrams(batch) : SendStream(batch);
+
+        if (sent < batch.size()) {
+            Disconnect();
+        }
+
+        return sent;
+    }
+
+    SLFMT_INLINE size_t SocketLogger::SendDatagrams(const std::vector<std::string> &batch) {
+        size_t done = 0;
+
+        while (done < batch.size()) {
+    #ifdef __linux__
+            std::array<mmsghdr, MAX_BATCH_SIZE> messages{};
+            std::array<iovec, MAX_BATCH_SIZE> buffers{};
+            const size_t count = std::min(batch.size() - done, MAX_BATCH_SIZE);
+
+            for (size_t i = 0; i < count; i++) {
+                buffers[i] = { const_cast<char *>(batch[done + i].data()), batch[done + i].size() };
+                messages[i].msg_hdr.msg_iov = &buffers[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            const int result = ::sendmmsg(m_fd, messages.data(), static_cast<unsigned int>(count), SEND_FLAGS);
+    #else
+            const int result = ::send(m_fd, batch[done].data(), batch[done].size(), SEND_FLAGS) < 0 ? -1 : 1;
+    #endif
+
+            if (result >= 0) {
+                done += static_cast<size_t>(result);
+            } else if (errno == EMSGSIZE) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                done++;
+            } else if (errno != EINTR) {
+                break;
+            }
+        }
+
+        return done;
+    }
+
+    SLFMT_INLINE size_t SocketLogger::SendStream(const std::vector<std::string> &batch) {
+        size_t done = 0;
+        size_t offset = 0; // Bytes of batch[done] already written.
+
+        while (done < batch.size()) {
+            std::array<iovec, MAX_BATCH_SIZE> buffers{};
+            size_t count = 0;
+
+            for (size_t i = done; i < batch.size() && count < buffers.size(); i++, count++) {
+                const size_t skip = i == done ? offset : 0;
+                buffers[count] = { const_cast<char *>(batch[i].data()) + skip, batch[i].size() - skip };
+            }
+
+            msghdr message{};
+            message.msg_iov = buffers.data();
+            message.msg_iovlen = count;
+
+            auto written = ::sendmsg(m_fd, &message, SEND_FLAGS);
+
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                return done + (offset > 0 ? 1 : 0);
+            }
+
+            while (written > 0) {
+                const auto remaining = static_cast<ssize_t>(batch[done].size() - offset);
+
+                if (written < remaining) {
+                    offset += static_cast<size_t>(written);
+                    break;
+                }
+
+                written -= remaining;
+                offset = 0;
+                done++;
+            }
+        }
+
+        return done;
+    }
+
+    SLFMT_INLINE bool SocketLogger::Connect() {
+        const int type = m_options.transport == Transport::DATAGRAM ? SOCK_DGRAM : SOCK_STREAM;
+        const int fd = ::socket(AF_UNIX, type, 0);
+
+        if (fd < 0) {
+            return false;
+        }
+
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    #ifdef SO_NOSIGPIPE
+        const int noSigPipe = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+    #endif
+
+        // A stuck agent must not stall the sender thread (and the destructor) forever.
+        const timeval timeout{ 1, 0 };
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        m_socketPath.copy(address.sun_path, sizeof(address.sun_path) - 1);
+
+        if (::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+            ::close(fd);
+            return false;
+        }
+
+        m_fd = fd;
+        return true;
+    }
+
+    SLFMT_INLINE void SocketLogger::Disconnect() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    SLFMT_INLINE int SocketLogger::Severity(const Level level) {
+        switch (level) {
+            case Level::TRACE:
+            case Level::DEBUG: return 7; // Debug
+            case Level::INFO: return 6;  // Informational
+            case Level::WARN: return 4;  // Warning
+            case Level::ERROR: return 3; // Error
+            case Level::FATAL: return 2; // Critical
+            default: return 5;           // Notice
+        }
+    }
+
+    SLFMT_INLINE std::string SocketLogger::Hostname() {
+        std::array<char, 256> name{};
+
+        if (::gethostname(name.data(), name.size() - 1) != 0 || name[0] == '\0') {
+            return "-";
+        }
+
+        return name.data();
+    }
+
+    SLFMT_INLINE std::string SocketLogger::HeaderField(const std::string_view value, const size_t maxLength) {
+        std::string field(value.substr(0, maxLength));
+
+        for (auto &c: field) {
+            if (c < 33 || c > 126) {
+                c = '_';
+            }
+        }
+
+        return field.empty() ? "-" : field;
+    }
+} // namespace slfmt
+
+#endif // _WIN32
+
+#endif // SLFMT_SOCKET_LOGGER_INL_H
@@ -0,0 +1,313 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * SocketLogger.h - Unix domain socket logger for slfmt
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_SOCKET_LOGGER_H
+#define SLFMT_SOCKET_LOGGER_H
+
+#ifndef _WIN32
+
+    #include <atomic>
+    #include <chrono>
+    #include <condition_variable>
+    #include <deque>
+    #include <mutex>
+    #include <slfmt/Config.h>
+    #include <slfmt/LazyInit.h>
+    #include <slfmt/LoggerBase.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <thread>
+    #include <vector>
+
+namespace slfmt {
+    /**
+     * @brief Logger that sends its messages to a local agent (e.g. a syslog daemon) through a Unix domain socket.
+     *
+     * @note Messages are queued and sent by a background thread, in batches of up to Options::batchSize messages
+     * per system call (<code>sendmmsg</code> for datagram sockets, <code>sendmsg</code> with one buffer per message
+     * for stream sockets). Logging never blocks on the socket: while the agent is not reachable, the sender thread
+     * keeps retrying to connect (with an increasing delay) and messages are queued until the queue is full, after
+     * which new messages are dropped (see Dropped()). Not available on Windows.
+     */
+    class SocketLogger : public LoggerBase {
+    public:
+        /**
+         * @brief The type of the socket.
+         */
+        enum class Transport {
+            /**
+             * @brief A datagram socket (<code>SOCK_DGRAM</code>): one message per datagram, like
+             * <code>/dev/log</code>.
+             */
+            DATAGRAM,
+
+            /**
+             * @brief A stream socket (<code>SOCK_STREAM</code>): messages are written one after the other.
+             */
+            STREAM
+        };
+
+        /**
+         * @brief How each message is framed.
+         */
+        enum class Framing {
+            /**
+             * @brief The message is formatted with the current LogFormat (which ends it with a newline).
+             */
+            LAYOUT,
+
+            /**
+             * @brief The message is sent as an RFC 5424 syslog message (the class is used as the MSGID). On stream
+             * sockets, every message is prefixed with its length (octet counting, RFC 6587).
+             */
+            RFC5424
+        };
+
+        /**
+         * @brief Options of the socket logger.
+         */
+        struct Options {
+            /**
+             * @brief The type of the socket.
+             */
+            Transport transport = Transport::DATAGRAM;
+
+            /**
+             * @brief How each message is framed.
+             */
+            Framing framing = Framing::LAYOUT;
+
+            /**
+             * @brief The syslog facility of the messages (RFC 5424 only, 1 is "user-level messages").
+             */
+            int facility = 1;
+
+            /**
+             * @brief The APP-NAME of the messages (RFC 5424 only).
+             */
+            std::string appName = "-";
+
+            /**
+             * @brief The maximum number of messages waiting to be sent. Messages logged while the queue is full are
+             * dropped.
+             */
+            size_t queueSize = 8192;
+
+            /**
+             * @brief The maximum number of messages sent with a single system call.
+             */
+            size_t batchSize = 64;
+
+            /**
+             * @brief The maximum delay between two attempts to connect to the socket.
+             */
+            std::chrono::milliseconds maxReconnectDelay = std::chrono::seconds(5);
+        };
+
+        /**
+         * @brief Constructs a new logger for the specified class and socket, with the default options.
+         *
+         * @param clazz The class to create a logger for.
+         * @param socketPath The path of the Unix domain socket to send the messages to.
+         */
+        SocketLogger(const std::string_view &clazz, const std::string_view &socketPath)
+            : SocketLogger(clazz, socketPath, Options{}) {}
+
+        /**
+         * @brief Constructs a new logger for the specified class and socket.
+         *
+         * @note The socket is not connected here, but by the sender thread (started when the first message is
+         * logged), so the agent does not need to be running yet.
+         *
+         * @param clazz The class to create a logger for.
+         * @param socketPath The path of the Unix domain socket to send the messages to.
+         * @param options The options of the logger.
+         */
+        SocketLogger(const std::string_view &clazz, const std::string_view &socketPath, Options options);
+
+        ~SocketLogger() override;
+
+        /**
+         * @brief Waits until all the messages logged so far have been sent (or dropped).
+         *
+         * @param timeout The maximum time to wait.
+         *
+         * @return True if all the messages were handled within the timeout.
+         */
+        bool Flush(std::chrono::milliseconds timeout = std::chrono::seconds(1));
+
+        /**
+         * @brief Gets the number of messages dropped so far (because the queue was full or the socket rejected
+         * them).
+         *
+         * @return The number of dropped messages.
+         */
+        FMT_NODISCARD std::uint64_t Dropped() const {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Frames a record and queues it for the sender thread (or drops it if the queue is full).
+         *
+         * @param record The record to queue.
+         */
+        void Write(const Record &record) override;
+
+        /**
+         * @brief Frames the records of a batch and queues them all at once (dropping those that do not fit).
+         *
+         * @param clazz The class of the records.
+         * @param batch The records to queue.
+         */
+        void WriteBatch(std::string_view clazz, const LogBatch &batch) override;
+
+    private:
+        static constexpr size_t MAX_BATCH_SIZE = 256;
+        static constexpr auto INITIAL_RECONNECT_DELAY = std::chrono::milliseconds(100);
+
+    #ifdef MSG_NOSIGNAL
+        static constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+    #else
+        static constexpr int SEND_FLAGS = 0;
+    #endif
+
+        const std::string m_socketPath;
+        Options m_options;
+        const std::string m_hostname;
+        const std::string m_procId;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wakeUp;
+        std::condition_variable m_idle;
+        std::deque<std::string> m_queue;
+        std::uint64_t m_enqueued = 0;
+        std::uint64_t m_completed = 0;
+        bool m_stop = false;
+        std::atomic<std::uint64_t> m_dropped = 0;
+
+        /**
+         * @brief The socket (only used by the sender thread), or -1 if not connected.
+         */
+        int m_fd = -1;
+
+        /**
+         * @brief Starts the sender thread when the first message is logged.
+         */
+        LazyInit m_start;
+
+        /**
+         * @brief The sender thread (declared last, so everything it uses is initialized before and destroyed
+         * after it).
+         */
+        std::thread m_sender;
+
+        /**
+         * @brief Frames a record (with the log format or as an RFC 5424 syslog message).
+         *
+         * @param format The log format (only used without RFC 5424 framing).
+         * @param record The record to frame.
+         *
+         * @return The message to send.
+         */
+        FMT_NODISCARD std::string Frame(const LogFormat &format, const Record &record) const;
+
+        /**
+         * @brief Formats a record as an RFC 5424 syslog message.
+         *
+         * @param record The record to format.
+         *
+         * @return The syslog message.
+         */
+        FMT_NODISCARD std::string FormatRfc5424(const Record &record) const;
+
+        /**
+         * @brief The body of the sender thread: sends the queued messages in batches, reconnecting as needed.
+         */
+        void Run();
+
+        /**
+         * @brief Sends a batch of messages, connecting the socket first if needed.
+         *
+         * @param batch The messages to send.
+         *
+         * @return The number of messages (from the start of the batch) that were handled. The rest could not be
+         * sent because the socket is not reachable (it is closed, to reconnect later).
+         */
+        size_t Send(const std::vector<std::string> &batch);
+
+        /**
+         * @brief Sends each message as a datagram, all of them with as few system calls as possible.
+         *
+         * @param batch The messages to send.
+         *
+         * @return The number of messages handled before an error. Messages that are too large for a datagram are
+         * dropped.
+         */
+        size_t SendDatagrams(const std::vector<std::string> &batch);
+
+        /**
+         * @brief Writes the messages one after the other to the stream socket, gathering several of them in every
+         * system call.
+         *
+         * @param batch The messages to send.
+         *
+         * @return The number of messages handled before an error. A message interrupted by an error counts as
+         * handled: the rest of it would be meaningless on a new connection.
+         */
+        size_t SendStream(const std::vector<std::string> &batch);
+
+        /**
+         * @brief Connects the socket.
+         *
+         * @return True if the socket is connected.
+         */
+        bool Connect();
+
+        /**
+         * @brief Closes the socket (if connected).
+         */
+        void Disconnect();
+
+        /**
+         * @brief Maps a level to a syslog severity.
+         *
+         * @param level The level.
+         *
+         * @return The severity (0-7).
+         */
+        static int Severity(const Level level);
+
+        /**
+         * @brief Gets the name of the host.
+         *
+         * @return The host name, or "-" if it is not available.
+         */
+        static std::string Hostname();
+
+        /**
+         * @brief Makes a string valid as an RFC 5424 header field (printable ASCII without spaces, limited length).
+         *
+         * @param value The value of the field.
+         * @param maxLength The maximum length of the field.
+         *
+         * @return The valid field ("-" if empty).
+         */
+        static std::string HeaderField(const std::string_view value, const size_t maxLength);
+    };
+} // namespace slfmt
+
+    #ifndef SLFMT_COMPILED_LIB
+        #include "SocketLogger-inl.h"
+    #endif
+
+#endif // _WIN32
+
+#endif // SLFMT_SOCKET_LOGGER_H
@@ -0,0 +1,169 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * StaticLogger.h - Logger writing to a set of sinks known at compile time
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#ifndef SLFMT_STATIC_LOGGER_H
+#define SLFMT_STATIC_LOGGER_H
+
+#include <cstddef>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "LoggerBase.h"
+#include "Sink.h"
+
+namespace slfmt {
+    /**
+     * @brief Logger that writes to a set of sinks known at compile time, the static counterpart of CombinedLogger,
+     * e.g. <code>StaticLogger<FileLogger, ConsoleLogger></code>.
+     *
+     * @note The logger owns its sinks, and writes each record to all of them with a fold expression: the sinks are
+     * called by their concrete type (without virtual calls, so the compiler can inline them), and there is no vector
+     * of loggers to walk. The logger is a LoggerBase like any other, so it can be passed where one is expected: only
+     * the call to the logger itself is virtual then. A sink is any class with <code>Write(const Record &)</code>,
+     * <code>WriteBatch(std::string_view, const LogBatch &)</code> and <code>IsEnabled(Level)</code> (every logger and
+     * Sink has them).
+     *
+     * @tparam Sinks The types of the sinks, in the order they are written to.
+     */
+    template<typename... Sinks>
+    class StaticLogger final : public LoggerBase {
+        static_assert(sizeof...(Sinks) > 0, "A static logger needs at least one sink.");
+
+    public:
+        /**
+         * @brief Constructs a new logger for the specified class, with sinks constructed from the class alone (or
+         * from nothing, if they do not take a class).
+         *
+         * @param clazz The class to create a logger for.
+         */
+        explicit StaticLogger(const std::string_view clazz)
+            : StaticLogger(clazz, (static_cast<void>(sizeof(Sinks)), std::tuple<>())...) {}
+
+        /**
+         * @brief Constructs a new logger for the specified class, constructing each sink in place from a tuple of
+         * arguments, e.g. <code>StaticLogger<FileLogger, ConsoleLogger>("Main", std::tuple("app.log"),
+         * std::tuple())</code>.
+         *
+         * @note The class is passed as the first argument to the sinks that take one (loggers), before the tuple.
+         *
+         * @tparam Args The types of the tuples of arguments.
+         * @param clazz The class to create a logger for.
+         * @param args A tuple with the constructor arguments of each sink (in the order of the sinks).
+         */
+        template<typename... Args>
+            requires(sizeof...(Args) == sizeof...(Sinks))
+        StaticLogger(const std::string_view clazz, Args &&...args)
+            : LoggerBase(clazz), m_slots(std::tuple_cat(std::forward_as_tuple(clazz), std::forward<Args>(args))...) {}
+
+        ~StaticLogger() override {
+            FlushRepeats();
+        }
+
+        /**
+         * @brief Gets a sink of the logger (e.g. to flush it, or to set its level).
+         *
+         * @tparam Index The index of the sink (in the order of the sinks).
+         *
+         * @return The sink.
+         */
+        template<size_t Index>
+        FMT_NODISCARD auto &Get() {
+            return std::get<Index>(m_slots).sink;
+        }
+
+        /**
+         * @brief Checks if the logger and at least one of its sinks write messages of the level.
+         *
+         * @param level The level to check.
+         *
+         * @return True if messages of the level are written.
+         */
+        FMT_NODISCARD bool IsEnabled(const Level level) const override {
+            if (!LoggerBase::IsEnabled(level)) {
+                return false;
+            }
+
+            return std::apply([level](const auto &...slots) {
+                return (slots.IsEnabled(level) || ...);
+            }, m_slots);
+        }
+
+        /**
+         * @brief Writes a record to the sinks that accept its level.
+         *
+         * @param record The record to write.
+         */
+        void Write(const Record &record) override {
+            std::apply([&record](auto &...slots) {
+                (slots.Write(record), ...);
+            }, m_slots);
+        }
+
+        /**
+         * @brief Forwards a batch to all the sinks, so each of them writes it at once.
+         *
+         * @param clazz The class of the records.
+         * @param batch The records to write.
+         */
+        void WriteBatch(const std::string_view clazz, const LogBatch &batch) override {
+            std::apply([clazz, &batch](auto &...slots) {
+                (slots.WriteBatch(clazz, batch), ...);
+            }, m_slots);
+        }
+
+    private:
+        /**
+         * @brief Holds a sink, constructed in place (sinks can be neither copied nor moved), and calls it by its
+         * concrete type.
+         *
+         * @tparam SinkType The type of the sink.
+         */
+        template<typename SinkType>
+        struct Slot {
+            SinkType sink;
+
+            template<typename... Args>
+            explicit Slot(std::tuple<const std::string_view &, Args...> &&args)
+                : sink(Make(std::move(args), std::index_sequence_for<Args...>())) {}
+
+            FMT_NODISCARD bool IsEnabled(const Level level) const {
+                return sink.SinkType::IsEnabled(level);
+            }
+
+            void Write(const Record &record) {
+                if (IsEnabled(record.level)) {
+                    sink.SinkType::Write(record);
+                }
+            }
+
+            void WriteBatch(const std::string_view clazz, const LogBatch &batch) {
+                sink.SinkType::WriteBatch(clazz, batch);
+            }
+
+        private:
+            template<typename Tuple, size_t... Indices>
+            static SinkType Make(Tuple &&args, std::index_sequence<Indices...>) {
+                if constexpr (std::is_constructible_v<SinkType, std::string_view,
+                                                      std::tuple_element_t<Indices + 1, Tuple>...>) {
+                    return SinkType(std::get<0>(args), std::get<Indices + 1>(std::move(args))...);
+                } else {
+                    return SinkType(std::get<Indices + 1>(std::move(args))...);
+                }
+            }
+        };
+
+        std::tuple<Slot<Sinks>...> m_slots;
+    };
+} // namespace slfmt
+
+#endif // SLFMT_STATIC_LOGGER_H
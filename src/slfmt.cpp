@@ -1 +1,20 @@
 #include <slfmt.h>
+
+#ifdef SLFMT_COMPILED_LIB
+    #include <slfmt/BlockIndex-inl.h>
+    #include <slfmt/CombinedLogger-inl.h>
+    #include <slfmt/ConsoleLogger-inl.h>
+    #include <slfmt/DurableFileLogger-inl.h>
+    #include <slfmt/FileLogger-inl.h>
+    #include <slfmt/Files-inl.h>
+    #include <slfmt/GzipWriter-inl.h>
+    #include <slfmt/LogFormat-inl.h>
+    #include <slfmt/LogManager-inl.h>
+    #include <slfmt/RollingFileLogger-inl.h>
+
+    #ifndef _WIN32
+        #include <slfmt/NumaBufferedSink-inl.h>
+        #include <slfmt/ShmLogger-inl.h>
+        #include <slfmt/SocketLogger-inl.h>
+    #endif
+#endif
@@ -0,0 +1,127 @@
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.h"
+
+/*
+ * The replacements of the global operator new/delete (see AllocationCounter.h).
+ */
+
+namespace {
+    using slfmt::test::AllocationCounter;
+
+    void *Allocate(const std::size_t size) {
+        AllocationCounter::Add();
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void *AllocateAligned(const std::size_t size, const std::align_val_t alignment) {
+        AllocationCounter::Add();
+        const auto align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+        return _aligned_malloc(size == 0 ? 1 : size, align);
+#else
+        void *memory = nullptr;
+        return posix_memalign(&memory, align < sizeof(void *) ? sizeof(void *) : align, size == 0 ? 1 : size) == 0
+                       ? memory
+                       : nullptr;
+#endif
+    }
+
+    void FreeAligned(void *memory) {
+#ifdef _WIN32
+        _aligned_free(memory);
+#else
+        std::free(memory);
+#endif
+    }
+} // namespace
+
+void *operator new(const std::size_t size) {
+    if (auto *memory = Allocate(size)) {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+void *operator new[](const std::size_t size) {
+    return operator new(size);
+}
+
+void *operator new(const std::size_t size, const std::nothrow_t &) noexcept {
+    return Allocate(size);
+}
+
+void *operator new[](const std::size_t size, const std::nothrow_t &) noexcept {
+    return Allocate(size);
+}
+
+void *operator new(const std::size_t size, const std::align_val_t alignment) {
+    if (auto *memory = AllocateAligned(size, alignment)) {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+void *operator new[](const std::size_t size, const std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void *operator new(const std::size_t size, const std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return AllocateAligned(size, alignment);
+}
+
+void *operator new[](const std::size_t size, const std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return AllocateAligned(size, alignment);
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept {
+    FreeAligned(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept {
+    FreeAligned(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept {
+    FreeAligned(memory);
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept {
+    FreeAligned(memory);
+}
+
+void operator delete(void *memory, std::align_val_t, const std::nothrow_t &) noexcept {
+    FreeAligned(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t, const std::nothrow_t &) noexcept {
+    FreeAligned(memory);
+}
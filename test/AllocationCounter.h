@@ -0,0 +1,65 @@
+#ifndef SLFMT_TEST_ALLOCATION_COUNTER_H
+#define SLFMT_TEST_ALLOCATION_COUNTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Counts the allocations of each thread, to check that the logging paths do not allocate more than expected. The
+ * global operator new/delete are replaced in AllocationCounter.cpp: compile it into the executable (the replacements
+ * apply to the whole program). They are kept out of this header so the compiler cannot inline them into the callers,
+ * where it would see memory from malloc released by operator delete (-Wmismatched-new-delete).
+ *
+ * Only operator new is counted (std::string, std::vector, std::function... all allocate through it): slfmt does not
+ * call malloc directly, and interposing malloc portably is not possible.
+ */
+
+namespace slfmt::test {
+    class AllocationCounter {
+    public:
+        AllocationCounter() = delete;
+
+        /**
+         * @brief Gets the number of allocations made by the current thread so far.
+         *
+         * @return The number of allocations.
+         */
+        static std::uint64_t Count() {
+            return s_count;
+        }
+
+        /**
+         * @brief Counts the allocations made by the current thread while calling a function many times, after
+         * calling it a few times to warm up (thread buffers, lazily opened files...).
+         *
+         * @tparam Function The type of the function.
+         * @param function The function to call.
+         * @param calls The number of calls to count the allocations of.
+         *
+         * @return The average number of allocations per call.
+         */
+        template<typename Function>
+        static double PerCall(Function &&function, const int calls = 1000) {
+            for (int i = 0; i < 64; i++) {
+                function();
+            }
+
+            const auto before = Count();
+
+            for (int i = 0; i < calls; i++) {
+                function();
+            }
+
+            return static_cast<double>(Count() - before) / calls;
+        }
+
+        static void Add() {
+            s_count++;
+        }
+
+    private:
+        static inline thread_local std::uint64_t s_count = 0;
+    };
+} // namespace slfmt::test
+
+#endif // SLFMT_TEST_ALLOCATION_COUNTER_H
@@ -0,0 +1,148 @@
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <memory>
+#include <slfmt.h>
+#include <string>
+#include <vector>
+
+#include "AllocationCounter.h"
+
+/*
+ * Allocation tests: the steady-state heap allocations of a logging call on each logger, counted on the logging thread
+ * (see AllocationCounter.h). Allocation freedom is easy to lose without noticing: each logger has a budget of
+ * allocations per call, which is what it makes today. Lower a budget when a change removes allocations, and never
+ * raise it without a good reason.
+ */
+
+namespace fs = std::filesystem;
+
+using slfmt::test::AllocationCounter;
+
+namespace {
+    /**
+     * @brief The allocations of formatting a line with the default layout: the placeholders map of the record and
+     * the strings of the layout elements (timestamp, thread...).
+     */
+    constexpr double LINE_ALLOCATIONS = 6;
+
+    /**
+     * @brief Discards every record (the cost of the logger itself, without any output).
+     */
+    struct NullSink : slfmt::Sink {
+        void Write([[maybe_unused]] const slfmt::Record &record) override {}
+    };
+
+    double InfoAllocations(slfmt::LoggerBase &logger) {
+        return AllocationCounter::PerCall([&logger] {
+            logger.Info("x={}", 42);
+        });
+    }
+
+    fs::path TempPath(const std::string &name) {
+        const auto path = fs::temp_directory_path() / name;
+        fs::remove(path);
+        return path;
+    }
+} // namespace
+
+TEST_CASE("test allocation counter") {
+    const auto before = AllocationCounter::Count();
+    const auto value = std::make_unique<int>(42);
+    REQUIRE(AllocationCounter::Count() == before + 1);
+
+    REQUIRE(AllocationCounter::PerCall([] {
+                (void) std::make_unique<std::string>(64, 'x');
+            }) == 2);
+}
+
+TEST_CASE("test logging allocations") {
+    SECTION("disabled level") {
+        slfmt::SinkLogger logger("Alloc", std::make_shared<NullSink>());
+        logger.SetLevel(slfmt::Level::WARN);
+        REQUIRE(InfoAllocations(logger) == 0);
+    }
+
+    SECTION("sink") {
+        slfmt::SinkLogger logger("Alloc", std::make_shared<NullSink>());
+        REQUIRE(InfoAllocations(logger) == 0);
+    }
+
+    SECTION("combined") {
+        std::vector<std::unique_ptr<slfmt::LoggerBase>> loggers;
+        loggers.push_back(slfmt::LogManager::GetSinkLogger("Alloc", std::make_shared<NullSink>()));
+        loggers.push_back(slfmt::LogManager::GetSinkLogger("Alloc", std::make_shared<NullSink>()));
+        slfmt::CombinedLogger logger("Alloc", std::move(loggers));
+        REQUIRE(InfoAllocations(logger) == 0);
+    }
+
+    SECTION("static") {
+        slfmt::StaticLogger<NullSink, NullSink> logger("Alloc");
+        REQUIRE(InfoAllocations(logger) == 0);
+    }
+
+    SECTION("shared memory") {
+        slfmt::ShmRing::Remove("/slfmt_alloc");
+
+        {
+            slfmt::ShmLogger logger("Alloc", "/slfmt_alloc");
+            REQUIRE(InfoAllocations(logger) == 0);
+        }
+
+        slfmt::ShmRing::Remove("/slfmt_alloc");
+    }
+
+    SECTION("console") {
+        slfmt::ConsoleLogger logger("Alloc");
+        REQUIRE(InfoAllocations(logger) <= LINE_ALLOCATIONS);
+    }
+
+    SECTION("file") {
+        const auto path = TempPath("slfmt_alloc.log");
+
+        {
+            slfmt::FileLogger logger("Alloc", path.string());
+            REQUIRE(InfoAllocations(logger) <= LINE_ALLOCATIONS);
+        }
+
+        fs::remove(path);
+    }
+
+    SECTION("context layout") {
+        const auto path = TempPath("slfmt_alloc_context.log");
+
+        {
+            // The context is longer than the small string buffer, so copying it would allocate on each call.
+            const slfmt::Context::Scope request("request", std::string(64, 'r'));
+            slfmt::FileLogger logger("Alloc", path.string());
+            logger.SetLayout(slfmt::LogFormat::Builder().Level().Message().Build());
+            const auto withoutContext = InfoAllocations(logger);
+
+            logger.SetLayout(slfmt::LogFormat::Builder().Level().Context().Message().Build());
+            REQUIRE(InfoAllocations(logger) == withoutContext);
+        }
+
+        fs::remove(path);
+    }
+
+    SECTION("rolling file") {
+        const auto path = TempPath("slfmt_alloc_rolling.log");
+
+        {
+            slfmt::RollingFileLogger logger("Alloc", path.string(), 1 << 20);
+            REQUIRE(InfoAllocations(logger) <= LINE_ALLOCATIONS);
+        }
+
+        fs::remove(path);
+    }
+
+    SECTION("durable file") {
+        const auto path = TempPath("slfmt_alloc_durable.log");
+
+        {
+            slfmt::DurableFileLogger logger("Alloc", path.string());
+            REQUIRE(InfoAllocations(logger) <= LINE_ALLOCATIONS);
+        }
+
+        fs::remove(path);
+    }
+}
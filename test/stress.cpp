@@ -0,0 +1,406 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <miniz.h>
+#include <slfmt.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/*
+ * Stress tests: many threads hammer the file loggers (across many rollovers) and every line written is checked to
+ * be whole, unique and in the order each thread logged it. Build with -DSLFMT_SANITIZE_THREAD=ON to run them under
+ * ThreadSanitizer.
+ */
+
+#if defined(__SANITIZE_THREAD__)
+    #define SLFMT_STRESS_TSAN
+#elif defined(__has_feature)
+    #if __has_feature(thread_sanitizer)
+        #define SLFMT_STRESS_TSAN
+    #endif
+#endif
+
+namespace {
+    constexpr int THREADS = 8;
+
+#ifdef SLFMT_STRESS_TSAN
+    // ThreadSanitizer runs everything many times slower: fewer messages still go through the same paths.
+    constexpr int MESSAGES = 2000;
+#else
+    constexpr int MESSAGES = 12000;
+#endif
+
+    /**
+     * @brief Minimum rate (messages per second, all the threads together) of a buffered file logger.
+     *
+     * @note Recorded from an unoptimized build on a single core (about 110000 messages per second), divided by 4 so
+     * that slow machines pass and only serious regressions (e.g. a lock held while formatting) fail.
+     */
+    constexpr double BASELINE_RATE = 25000;
+
+    std::uint32_t Checksum(const std::string_view text) {
+        std::uint32_t hash = 2166136261U; // FNV-1a
+
+        for (const char c: text) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 16777619U;
+        }
+
+        return hash;
+    }
+
+    /**
+     * @brief Builds the message a thread logs: its origin, a payload of varying length and a checksum of both.
+     */
+    std::string Message(const int thread, const int index) {
+        const auto payloadSize = static_cast<size_t>((thread * 31 + index * 7) % 150);
+        const auto text = fmt::format("stress {} {} {}", thread, index,
+                                      std::string(payloadSize, static_cast<char>('a' + index % 26)));
+        return fmt::format("{} {:08x}", text, Checksum(text));
+    }
+
+    /**
+     * @brief Checks the lines written by the stress tests.
+     */
+    class Verifier {
+    public:
+        Verifier() : m_seen(static_cast<size_t>(THREADS * MESSAGES), 0), m_last(THREADS, -1) {}
+
+        /**
+         * @brief Checks the contents of a log file: every line must hold exactly one whole message, and the
+         * messages of each thread must be in the order they were logged.
+         */
+        void Add(const std::string_view contents) {
+            std::fill(m_last.begin(), m_last.end(), -1);
+            size_t start = 0;
+
+            while (start < contents.size()) {
+                const auto end = contents.find('\n', start);
+
+                if (end == std::string_view::npos) {
+                    torn++; // The last line was cut.
+                    break;
+                }
+
+                Check(contents.substr(start, end - start));
+                start = end + 1;
+            }
+        }
+
+        /**
+         * @brief Gets the number of messages never seen.
+         */
+        FMT_NODISCARD int Missing() const {
+            return static_cast<int>(std::count(m_seen.begin(), m_seen.end(), 0));
+        }
+
+        int torn = 0;
+        int duplicated = 0;
+        int unordered = 0;
+
+    private:
+        std::vector<int> m_seen;
+        std::vector<int> m_last;
+
+        void Check(const std::string_view line) {
+            const auto start = line.find("stress ");
+
+            if (start == std::string_view::npos || line.find("stress ", start + 1) != std::string_view::npos) {
+                torn++;
+                return;
+            }
+
+            const std::string message(line.substr(start));
+            int thread = -1;
+            int index = -1;
+
+            if (std::sscanf(message.c_str(), "stress %d %d", &thread, &index) != 2 || thread < 0 ||
+                thread >= THREADS || index < 0 || index >= MESSAGES || message != Message(thread, index)) {
+                torn++;
+                return;
+            }
+
+            if (m_seen[static_cast<size_t>(thread * MESSAGES + index)]++ > 0) {
+                duplicated++;
+            }
+
+            if (index <= m_last[static_cast<size_t>(thread)]) {
+                unordered++;
+            }
+
+            m_last[static_cast<size_t>(thread)] = index;
+        }
+    };
+
+    /**
+     * @brief Runs the tests in an empty directory (the rolling logger keeps its backups in <code>logs</code>).
+     */
+    class ScratchDirectory {
+    public:
+        ScratchDirectory() : m_previous(fs::current_path()), m_path(fs::temp_directory_path() / "slfmt_stress") {
+            fs::remove_all(m_path);
+            fs::create_directories(m_path);
+            fs::current_path(m_path);
+        }
+
+        ~ScratchDirectory() {
+            fs::current_path(m_previous);
+            fs::remove_all(m_path);
+        }
+
+        ScratchDirectory(const ScratchDirectory &) = delete;
+        ScratchDirectory &operator=(const ScratchDirectory &) = delete;
+
+    private:
+        const fs::path m_previous;
+        const fs::path m_path;
+    };
+
+    /**
+     * @brief Calls a function for every message from THREADS threads started at once.
+     *
+     * @return The time it took, in seconds.
+     */
+    template<typename Function>
+    double Hammer(Function &&log) {
+        std::atomic<bool> go = false;
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([&go, &log, t] {
+                while (!go) {
+                    std::this_thread::yield();
+                }
+
+                for (int i = 0; i < MESSAGES; i++) {
+                    log(t, i);
+                }
+            });
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        go = true;
+
+        for (auto &thread: threads) {
+            thread.join();
+        }
+
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::string ReadFile(const fs::path &path) {
+        std::ifstream stream(path, std::ios::binary);
+        return { std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+    }
+
+    std::string Unzip(const fs::path &path) {
+        mz_zip_archive zip{};
+        REQUIRE(mz_zip_reader_init_file(&zip, path.string().c_str(), 0));
+        REQUIRE(mz_zip_reader_get_num_files(&zip) == 1);
+
+        size_t size = 0;
+        auto *data = mz_zip_reader_extract_to_heap(&zip, 0, &size, 0);
+        REQUIRE(data != nullptr);
+
+        std::string contents(static_cast<const char *>(data), size);
+        mz_free(data);
+        mz_zip_reader_end(&zip);
+
+        return contents;
+    }
+
+    /**
+     * @brief Decompresses a gzip file (all its members), checking the CRC and size in their trailers.
+     */
+    std::string Gunzip(const std::string &data) {
+        constexpr size_t HEADER_SIZE = 10; // The header written by slfmt (no optional fields).
+        constexpr size_t TRAILER_SIZE = 8;
+        std::string output;
+        std::array<char, 64 * 1024> chunk{};
+        size_t position = 0;
+
+        while (position < data.size()) {
+            REQUIRE(data.size() - position >= HEADER_SIZE + TRAILER_SIZE);
+            const auto memberStart = output.size();
+
+            mz_stream stream{};
+            REQUIRE(mz_inflateInit2(&stream, -MZ_DEFAULT_WINDOW_BITS) == MZ_OK);
+            stream.next_in = reinterpret_cast<const unsigned char *>(data.data()) + position + HEADER_SIZE;
+            stream.avail_in = static_cast<unsigned int>(data.size() - position - HEADER_SIZE);
+
+            int status = MZ_OK;
+
+            while (status == MZ_OK) {
+                stream.next_out = reinterpret_cast<unsigned char *>(chunk.data());
+                stream.avail_out = static_cast<unsigned int>(chunk.size());
+                status = mz_inflate(&stream, MZ_NO_FLUSH);
+                output.append(chunk.data(), chunk.size() - stream.avail_out);
+            }
+
+            REQUIRE(status == MZ_STREAM_END);
+            position = static_cast<size_t>(reinterpret_cast<const char *>(stream.next_in) - data.data());
+            mz_inflateEnd(&stream);
+
+            REQUIRE(data.size() - position >= TRAILER_SIZE);
+            std::uint32_t crc = 0;
+            std::uint32_t size = 0;
+
+            for (size_t i = 0; i < 4; i++) {
+                crc |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[position + i])) << (8 * i);
+                size |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[position + 4 + i])) << (8 * i);
+            }
+
+            const auto member = std::string_view(output).substr(memberStart);
+            REQUIRE(crc == mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const unsigned char *>(member.data()),
+                                    member.size()));
+            REQUIRE(size == static_cast<std::uint32_t>(member.size()));
+            position += TRAILER_SIZE;
+        }
+
+        return output;
+    }
+
+    void RequireComplete(const Verifier &verifier) {
+        REQUIRE(verifier.torn == 0);
+        REQUIRE(verifier.duplicated == 0);
+        REQUIRE(verifier.unordered == 0);
+        REQUIRE(verifier.Missing() == 0);
+    }
+} // namespace
+
+TEST_CASE("stress file logger") {
+    const ScratchDirectory directory;
+    const auto bufferSize = GENERATE(0, 4096, 64 * 1024);
+
+    {
+        slfmt::FileLogger logger("Stress", "stress.log", static_cast<size_t>(bufferSize));
+
+        Hammer([&logger](const int thread, const int index) {
+            logger.Info("{}", Message(thread, index));
+        });
+    }
+
+    Verifier verifier;
+    verifier.Add(ReadFile("stress.log"));
+    RequireComplete(verifier);
+}
+
+TEST_CASE("stress file logger throughput") {
+    const ScratchDirectory directory;
+    double seconds = 0;
+
+    {
+        slfmt::FileLogger logger("Stress", "stress.log", 64 * 1024);
+
+        seconds = Hammer([&logger](const int thread, const int index) {
+            logger.Info("stress {} {}", thread, index);
+        });
+    }
+
+    const auto rate = THREADS * MESSAGES / seconds;
+    CAPTURE(rate);
+
+#ifdef SLFMT_STRESS_TSAN
+    REQUIRE(rate > 0); // Timings under ThreadSanitizer mean nothing.
+#else
+    REQUIRE(rate >= BASELINE_RATE);
+#endif
+}
+
+TEST_CASE("stress rolling file logger") {
+    const ScratchDirectory directory;
+    const auto compression =
+            GENERATE(slfmt::RollingFileLogger::Compression::NONE, slfmt::RollingFileLogger::Compression::GZIP);
+    const auto bufferSize = GENERATE(0, 8192);
+    const bool gzip = compression == slfmt::RollingFileLogger::Compression::GZIP;
+
+    slfmt::RollingFileLogger::Options options;
+    options.fileSize = slfmt::RollingFileLogger::MIN_FILE_SIZE;
+    options.bufferSize = static_cast<size_t>(bufferSize);
+    options.compression = compression;
+
+    {
+        slfmt::RollingFileLogger logger("Stress", "stress.log", options);
+
+        Hammer([&logger](const int thread, const int index) {
+            logger.Info("{}", Message(thread, index));
+        });
+    }
+
+    // Every archive holds whole lines, and was rolled over only once full.
+    Verifier verifier;
+    size_t archives = 0;
+
+    for (const auto &entry: fs::directory_iterator("logs")) {
+        const auto contents = gzip ? Gunzip(ReadFile(entry.path())) : Unzip(entry.path());
+        REQUIRE(contents.size() >= options.fileSize);
+        verifier.Add(contents);
+        archives++;
+    }
+
+    const auto active = gzip ? Gunzip(ReadFile("stress.log.gz")) : ReadFile("stress.log");
+    REQUIRE(active.size() < options.fileSize);
+    verifier.Add(active);
+
+#ifdef SLFMT_STRESS_TSAN
+    REQUIRE(archives >= 1);
+#else
+    REQUIRE(archives >= 10);
+#endif
+    RequireComplete(verifier);
+}
+
+TEST_CASE("stress combined logger") {
+    const ScratchDirectory directory;
+
+    {
+        std::vector<std::unique_ptr<slfmt::LoggerBase>> loggers;
+        loggers.push_back(std::make_unique<slfmt::FileLogger>("Stress", "unbuffered.log"));
+        loggers.push_back(std::make_unique<slfmt::FileLogger>("Stress", "buffered.log", 4096));
+        loggers.push_back(std::make_unique<slfmt::RollingFileLogger>(
+                "Stress", "rolling.log", slfmt::RollingFileLogger::MIN_FILE_SIZE, 8192));
+        slfmt::CombinedLogger logger("Stress", std::move(loggers));
+
+        // Half of the threads log their messages one by one, the other half in batches.
+        Hammer([&logger](const int thread, const int index) {
+            if (thread % 2 == 0) {
+                logger.Info("{}", Message(thread, index));
+                return;
+            }
+
+            thread_local std::unique_ptr<slfmt::LogBatch> batch;
+
+            if (batch == nullptr) {
+                batch = std::make_unique<slfmt::LogBatch>(logger, slfmt::LogBatch::Timestamp::PER_RECORD);
+            }
+
+            batch->Info("{}", Message(thread, index));
+
+            if (batch->Size() == 16 || index == MESSAGES - 1) {
+                batch.reset();
+            }
+        });
+    }
+
+    for (const auto *file: { "unbuffered.log", "buffered.log" }) {
+        Verifier verifier;
+        verifier.Add(ReadFile(file));
+        RequireComplete(verifier);
+    }
+
+    Verifier verifier;
+
+    for (const auto &entry: fs::directory_iterator("logs")) {
+        verifier.Add(Unzip(entry.path()));
+    }
+
+    verifier.Add(ReadFile("rolling.log"));
+    RequireComplete(verifier);
+}
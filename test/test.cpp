@@ -1,5 +1,47 @@
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <cstdio>
+#include <fstream>
+#include <miniz.h>
 #include <slfmt.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Creates a path in the temporary directory, removing what a previous run left there.
+ */
+static fs::path TempPath(const std::string &name) {
+    auto path = fs::temp_directory_path() / name;
+    fs::remove(path);
+    return path;
+}
+
+/**
+ * @brief Sink recording the records written to it (from any thread) as "LEVEL class message" lines, along with their
+ * messages and the threads that wrote them. A sink only has to write records.
+ */
+struct RecordingSink : slfmt::Sink {
+    const slfmt::Level minimum;
+    std::mutex mutex;
+    std::vector<std::string> lines;
+    std::vector<std::string> messages;
+    std::vector<std::string> threads;
+
+    explicit RecordingSink(const slfmt::Level level = slfmt::Level::TRACE) : minimum(level) {}
+
+    void Write(const slfmt::Record &record) override {
+        const std::lock_guard lock(mutex);
+        lines.push_back(fmt::format("{} {} {}", slfmt::LevelToString(record.level), record.clazz, record.message));
+        messages.emplace_back(record.message);
+        threads.push_back(slfmt::LogFormat::GetThreadIdString());
+    }
+
+    FMT_NODISCARD bool IsEnabled(const slfmt::Level level) const override {
+        return level >= minimum;
+    }
+};
 
 TEST_CASE("test version") {
 	REQUIRE(SLFMT_VERSION_STRING == std::string("0.1.0"));
@@ -20,3 +62,1384 @@ TEST_CASE("test logger") {
 
     REQUIRE(true);
 }
+
+TEST_CASE("test json escape") {
+    std::string out;
+
+    SECTION("plain strings are copied") {
+        const std::string str(100, 'a');
+        slfmt::Json::Escape(out, str);
+        REQUIRE(out == str);
+    }
+
+    SECTION("special characters are escaped at any position") {
+        // Place the special characters around the 16 and 32 byte vector boundaries.
+        const std::string padding(31, 'x');
+        slfmt::Json::Escape(out, padding + "\"\\\n\t\x01" + padding + "\x1f" + "\xc3\xa9");
+        REQUIRE(out == padding + "\\\"\\\\\\n\\t\\u0001" + padding + "\\u001f" + "\xc3\xa9");
+    }
+}
+
+TEST_CASE("test json format") {
+    const auto format = slfmt::LogFormat::Builder().Level().Class().Message().BuildJson();
+
+    SECTION("without fields") {
+        const auto line = format.Format({ { "{L}", "INFO" }, { "{C}", "TestClass" }, { "{M}", "say \"hi\"" } });
+        REQUIRE(line == "{\"level\":\"INFO\",\"class\":\"TestClass\",\"message\":\"say \\\"hi\\\"\"}\n");
+    }
+
+    SECTION("with fields") {
+        const slfmt::Fields fields{ { "user", "bob" }, { "id", 42 }, { "ratio", 0.5 }, { "ok", true } };
+        const slfmt::Fields::Scope scope(fields);
+
+        const auto line = format.Format({ { "{L}", "WARN" }, { "{C}", "TestClass" }, { "{M}", "x" } });
+        REQUIRE(line == "{\"level\":\"WARN\",\"class\":\"TestClass\",\"message\":\"x\","
+                        "\"user\":\"bob\",\"id\":42,\"ratio\":0.5,\"ok\":true}\n");
+    }
+}
+
+TEST_CASE("test diagnostic context") {
+    const auto text = slfmt::LogFormat::Builder().Level().Context("[", "]").Message().Build();
+    const auto json = slfmt::LogFormat::Builder().Level().Context().Message().BuildJson();
+    const std::unordered_map<std::string_view, std::string_view> replaces{ { "{L}", "INFO" }, { "{M}", "x" } };
+
+    REQUIRE(text.Format(replaces) == "INFO [] x\n");
+    REQUIRE(json.Format(replaces) == "{\"level\":\"INFO\",\"message\":\"x\"}\n");
+
+    {
+        const slfmt::Context::Scope request("request", "r-1");
+        slfmt::Context::Push("tenant", "acme");
+
+        REQUIRE(text.Format(replaces) == "INFO [request=r-1 tenant=acme] x\n");
+        REQUIRE(json.Format(replaces) == "{\"level\":\"INFO\",\"request\":\"r-1\",\"tenant\":\"acme\","
+                                         "\"message\":\"x\"}\n");
+
+        // The rendered context is reused until it changes.
+        const auto *rendered = slfmt::Context::Text().data();
+        REQUIRE(slfmt::Context::Text().data() == rendered);
+
+        {
+            const slfmt::Context::Scope retry("request", "r-2");
+            REQUIRE(slfmt::Context::Get("request") == "r-2");
+            REQUIRE(text.Format(replaces) == "INFO [tenant=acme request=r-2] x\n");
+        }
+
+        slfmt::Context::Pop();
+        REQUIRE(text.Format(replaces) == "INFO [request=r-1] x\n");
+
+        // Other threads have their own context.
+        std::string other;
+        std::thread([&text, &replaces, &other] {
+            other = text.Format(replaces);
+        }).join();
+        REQUIRE(other == "INFO [] x\n");
+    }
+
+    REQUIRE(slfmt::Context::Text().empty());
+    REQUIRE(slfmt::Context::Get("request").empty());
+}
+
+TEST_CASE("test log format with placeholders in values") {
+    const auto text = slfmt::LogFormat::Builder().Level().Context().Fields().Message().Build();
+    const auto json = slfmt::LogFormat::Builder().Level().Context().Fields().Message().BuildJson();
+    const std::unordered_map<std::string_view, std::string_view> replaces{ { "{L}", "INFO" }, { "{M}", "hello" } };
+
+    // Field and context values are written as they are, never replaced like the placeholders of the layout.
+    const slfmt::Context::Scope tenant("tenant", "{L}");
+    const slfmt::Fields fields{ { "user", "{M}" } };
+    const slfmt::Fields::Scope scope(fields);
+
+    REQUIRE(text.Format(replaces) == "INFO tenant={L} user={M} hello\n");
+    REQUIRE(json.Format(replaces) ==
+            "{\"level\":\"INFO\",\"tenant\":\"{L}\",\"user\":\"{M}\",\"message\":\"hello\"}\n");
+}
+
+static std::string ReadFile(const fs::path &path) {
+    std::ifstream stream(path, std::ios::binary);
+    return { std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+}
+
+TEST_CASE("test log format snapshots") {
+    const auto previous = slfmt::LogFormat::GetShared();
+    const auto path = TempPath("slfmt_layout.log");
+    const auto ownPath = TempPath("slfmt_own_layout.log");
+
+    {
+        slfmt::FileLogger global("Layout", path.string());
+        slfmt::FileLogger own("Layout", ownPath.string());
+        own.SetLayout(slfmt::LogFormat::Builder().Level().Message().Build());
+
+        // Threads log while the global format is replaced: each line has either the old or the new one.
+        std::atomic<bool> stop = false;
+        std::vector<std::thread> threads;
+
+        for (int i = 0; i < 4; i++) {
+            threads.emplace_back([&global, &stop] {
+                while (!stop) {
+                    global.Info("swapped");
+                }
+            });
+        }
+
+        for (int i = 0; i < 50; i++) {
+            slfmt::LogFormat::Set(i % 2 == 0 ? slfmt::LogFormat::Builder().Class().Message().Build() : *previous);
+        }
+
+        stop = true;
+
+        for (auto &thread: threads) {
+            thread.join();
+        }
+
+        slfmt::LogFormat::Set(slfmt::LogFormat::Builder().Class().Message().Build());
+        global.Info("last");
+        own.Info("own");
+    }
+
+    slfmt::LogFormat::Set(*previous);
+    REQUIRE(ReadFile(path).find("(Layout) last\n") != std::string::npos);
+    REQUIRE(ReadFile(ownPath) == "INFO own\n");
+
+    fs::remove(path);
+    fs::remove(ownPath);
+}
+
+TEST_CASE("test buffered file writer") {
+    const auto path = TempPath("slfmt_buffered_writer.log");
+
+    {
+        slfmt::FileWriter writer(path.string(), 64);
+
+        writer.Write("first\n");
+        REQUIRE(ReadFile(path).empty());
+
+        // A crash drain writes the pending data without going through Flush().
+        writer.DrainForCrash();
+        REQUIRE(ReadFile(path) == "first\n");
+
+        writer.Write("second\n");
+        writer.Write(std::string(100, 'x')); // Larger than the buffer: written through.
+        REQUIRE(ReadFile(path) == "first\nsecond\n" + std::string(100, 'x'));
+
+        writer.Write("third\n");
+    }
+
+    REQUIRE(ReadFile(path) == "first\nsecond\n" + std::string(100, 'x') + "third\n");
+    fs::remove(path);
+}
+
+TEST_CASE("test file writers past the crash handler limit") {
+    const auto path = TempPath("slfmt_unregistered_writer.log");
+
+    std::vector<std::unique_ptr<slfmt::FileWriter>> writers;
+
+    for (size_t i = 0; i < slfmt::CrashHandler::MAX_DRAINABLES; i++) {
+        writers.push_back(std::make_unique<slfmt::FileWriter>(64));
+    }
+
+    // The crash handler cannot drain another buffer: the writer writes every call through instead.
+    {
+        slfmt::FileWriter writer(path.string(), 64);
+        REQUIRE(!writer.IsBuffered());
+
+        writer.Write("through\n");
+        REQUIRE(ReadFile(path) == "through\n");
+    }
+
+    writers.clear();
+    REQUIRE(slfmt::FileWriter(64).IsBuffered());
+    fs::remove(path);
+}
+
+static slfmt::Clock::TimePoint FixedTime() {
+    return slfmt::Clock::TimePoint(std::chrono::milliseconds(1700000000123));
+}
+
+TEST_CASE("test clock") {
+    slfmt::Clock::Use(&FixedTime);
+    REQUIRE(slfmt::Clock::GetSource() == slfmt::Clock::Source::CUSTOM);
+    REQUIRE(slfmt::BlockIndex::Now() == 1700000000123);
+
+    // Every source falls back to an available one and stays close to the system clock.
+    for (const auto source: { slfmt::Clock::Source::TSC, slfmt::Clock::Source::COARSE }) {
+        REQUIRE(slfmt::Clock::Use(source) <= source);
+
+        const auto difference = slfmt::Clock::Now() - std::chrono::system_clock::now();
+        REQUIRE(std::chrono::abs(difference) < std::chrono::milliseconds(100));
+    }
+
+    REQUIRE(slfmt::Clock::Use(slfmt::Clock::Source::SYSTEM) == slfmt::Clock::Source::SYSTEM);
+}
+
+TEST_CASE("test lazy file opening") {
+    const auto path = TempPath("slfmt_lazy.log");
+    const auto rollingPath = TempPath("slfmt_lazy_rolling.log");
+
+    {
+        slfmt::FileLogger logger("Lazy", path.string());
+        slfmt::RollingFileLogger rollingLogger("Lazy", rollingPath.string());
+
+        // Creating (and destroying) a logger does not touch the file system.
+        REQUIRE(!fs::exists(path));
+        REQUIRE(!fs::exists(rollingPath));
+
+        logger.Info("first {}", 1);
+        REQUIRE(ReadFile(path).find("first 1") != std::string::npos);
+    }
+
+    REQUIRE(!fs::exists(rollingPath));
+    fs::remove(path);
+}
+
+/**
+ * @brief Counts how many times it is formatted.
+ */
+struct Counted {
+    int *count;
+};
+
+template<>
+struct fmt::formatter<Counted> : fmt::formatter<int> {
+    auto format(const Counted &counted, fmt::format_context &ctx) const {
+        return fmt::formatter<int>::format(++*counted.count, ctx);
+    }
+};
+
+TEST_CASE("test combined logger levels") {
+    const auto debugPath = TempPath("slfmt_combined_debug.log");
+    const auto errorPath = TempPath("slfmt_combined_error.log");
+
+    {
+        auto debugLogger = slfmt::LogManager::GetFileLogger("Combined", debugPath.string());
+        auto errorLogger = slfmt::LogManager::GetFileLogger("Combined", errorPath.string());
+        debugLogger->SetLevel(slfmt::Level::DEBUG);
+        errorLogger->SetLevel(slfmt::Level::ERROR);
+
+        const auto logger =
+                slfmt::LogManager::GetCombinedLogger("Combined", std::move(debugLogger), std::move(errorLogger));
+        int formatted = 0;
+
+        // No logger wants TRACE messages: they are not even formatted.
+        logger->Trace("trace {}", Counted{ &formatted });
+        REQUIRE(formatted == 0);
+        REQUIRE(!logger->IsEnabled(slfmt::Level::TRACE));
+
+        logger->Debug("debug {}", Counted{ &formatted });
+        logger->Error("error {}", Counted{ &formatted });
+        REQUIRE(formatted == 2);
+
+        // The formatted message is not used as a format string by the loggers.
+        logger->Error("braces {}", "{not a placeholder}");
+    }
+
+    const auto debugLog = ReadFile(debugPath);
+    const auto errorLog = ReadFile(errorPath);
+
+    REQUIRE(debugLog.find("debug 1") != std::string::npos);
+    REQUIRE(debugLog.find("error 2") != std::string::npos);
+    REQUIRE(errorLog.find("debug") == std::string::npos);
+    REQUIRE(errorLog.find("error 2") != std::string::npos);
+    REQUIRE(errorLog.find("braces {not a placeholder}") != std::string::npos);
+
+    fs::remove(debugPath);
+    fs::remove(errorPath);
+}
+
+static slfmt::Clock::TimePoint SteppingTime() {
+    static std::atomic<int> reads = 0;
+    return FixedTime() + std::chrono::milliseconds(reads++);
+}
+
+TEST_CASE("test combined logger time") {
+    const auto firstPath = TempPath("slfmt_combined_first.log");
+    const auto secondPath = TempPath("slfmt_combined_second.log");
+
+    // Each read of the clock is a millisecond later: the loggers still write the record at the same time.
+    slfmt::Clock::Use(&SteppingTime);
+
+    {
+        const auto logger = slfmt::LogManager::GetCombinedLogger(
+                "Combined", slfmt::LogManager::GetFileLogger("Combined", firstPath.string()),
+                slfmt::LogManager::GetFileLogger("Combined", secondPath.string()));
+        logger->Info("once");
+    }
+
+    slfmt::Clock::Use(slfmt::Clock::Source::SYSTEM);
+
+    const auto first = ReadFile(firstPath);
+    REQUIRE(first.find("once") != std::string::npos);
+    REQUIRE(first == ReadFile(secondPath));
+
+    fs::remove(firstPath);
+    fs::remove(secondPath);
+}
+
+TEST_CASE("test shared sink") {
+    static_assert(slfmt::LevelToString(slfmt::Level::WARN) == "WARN");
+
+    const auto sink = std::make_shared<RecordingSink>(slfmt::Level::INFO);
+    int formatted = 0;
+
+    {
+        const auto parser = slfmt::LogManager::GetSinkLogger("Parser", sink);
+        const auto network = slfmt::LogManager::GetSinkLogger("Network", sink);
+
+        // The sink does not write DEBUG records: they are not even formatted.
+        parser->Debug("debug {}", Counted{ &formatted });
+        REQUIRE(formatted == 0);
+
+        parser->Info("parsed {}", 3);
+        network->Error("timeout");
+
+        {
+            auto batch = network->Batch();
+            batch.Warn("retry {}", 1);
+            batch.Debug("dropped");
+        }
+    }
+
+    REQUIRE(sink->lines == std::vector<std::string>{ "INFO Parser parsed 3", "ERROR Network timeout",
+                                                     "WARN Network retry 1" });
+
+    // Loggers are sinks too: two classes sharing one file.
+    const auto path = TempPath("slfmt_shared_sink.log");
+
+    {
+        const auto file = std::make_shared<slfmt::FileLogger>("", path.string());
+        slfmt::SinkLogger("Parser", file).Info("from the parser");
+        slfmt::SinkLogger("Network", file).Warn("from the network");
+    }
+
+    const auto log = ReadFile(path);
+    REQUIRE(log.find("INFO (Parser) [Thread-") != std::string::npos);
+    REQUIRE(log.find("WARN (Network) [Thread-") != std::string::npos);
+    REQUIRE(log.find("from the parser") < log.find("from the network"));
+
+    fs::remove(path);
+}
+
+TEST_CASE("test static logger") {
+    const auto path = TempPath("slfmt_static.log");
+
+    {
+        // The recording sinks are constructed from their own arguments (they do not take a class).
+        auto logger = slfmt::LogManager::GetStaticLogger<slfmt::FileLogger, RecordingSink, RecordingSink>(
+                "Static", std::tuple(path.string()), std::tuple(slfmt::Level::INFO),
+                std::tuple(slfmt::Level::ERROR));
+        logger->Get<0>().SetLevel(slfmt::Level::WARN);
+
+        logger->Debug("dropped");
+        logger->Info("info {}", 1);
+        logger->Error("error {}", 2);
+
+        // Usable where a LoggerBase is expected.
+        slfmt::LoggerBase &base = *logger;
+        base.Warn("warn {}", 3);
+
+        REQUIRE(!logger->IsEnabled(slfmt::Level::DEBUG));
+        REQUIRE(logger->Get<1>().lines == std::vector<std::string>{ "INFO Static info 1", "ERROR Static error 2",
+                                                                    "WARN Static warn 3" });
+        REQUIRE(logger->Get<2>().lines == std::vector<std::string>{ "ERROR Static error 2" });
+    }
+
+    const auto log = ReadFile(path);
+    REQUIRE(log.find("info 1") == std::string::npos);
+    REQUIRE(log.find("ERROR (Static) [Thread-") != std::string::npos);
+    REQUIRE(log.find("error 2") < log.find("warn 3"));
+
+    fs::remove(path);
+}
+
+static size_t CountOccurrences(const std::string &text, const std::string_view what) {
+    size_t count = 0;
+
+    for (auto position = text.find(what); position != std::string::npos; position = text.find(what, position + 1)) {
+        count++;
+    }
+
+    return count;
+}
+
+TEST_CASE("test queued combined logger") {
+    // Stands for a console whose pipe is full: blocks until released.
+    struct StalledSink : slfmt::Sink {
+        std::mutex mutex;
+        std::condition_variable released;
+        bool release = false;
+        size_t written = 0;
+
+        void Write([[maybe_unused]] const slfmt::Record &record) override {
+            std::unique_lock lock(mutex);
+            released.wait(lock, [this] {
+                return release;
+            });
+            written++;
+        }
+    };
+
+    const auto path = TempPath("slfmt_combined_queued.log");
+    constexpr int MESSAGES = 1000;
+
+    const auto stalled = std::make_shared<StalledSink>();
+    std::string threadId;
+
+    {
+        std::vector<std::unique_ptr<slfmt::LoggerBase>> loggers;
+        loggers.push_back(slfmt::LogManager::GetSinkLogger("Queued", stalled));
+        loggers.push_back(slfmt::LogManager::GetFileLogger("Queued", path.string()));
+
+        slfmt::CombinedLogger logger("Queued", std::move(loggers),
+                                     { .delivery = slfmt::CombinedLogger::Delivery::QUEUED, .queueSize = 32 });
+        threadId = slfmt::LogFormat::GetThreadIdString();
+
+        // The file gets every message while the other logger is stalled (logged in chunks that fit in a queue, so
+        // the file does not drop any either).
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        size_t written = 0;
+
+        for (int i = 0; i < MESSAGES; i++) {
+            logger.Info("message {}", i);
+
+            while (i % 16 == 15 && written < static_cast<size_t>(i + 1) &&
+                   std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                written = CountOccurrences(ReadFile(path), "message ");
+            }
+        }
+
+        const auto droppedByFile = logger.Dropped(1);
+
+        {
+            const std::lock_guard lock(stalled->mutex);
+            stalled->release = true;
+        }
+
+        stalled->released.notify_all();
+        logger.Flush();
+
+        REQUIRE(CountOccurrences(ReadFile(path), "message ") == MESSAGES);
+        REQUIRE(ReadFile(path).find(threadId) != std::string::npos);
+        REQUIRE(droppedByFile == 0);
+
+        // The stalled logger only dropped the messages that did not fit in its own queue (and the ones its thread
+        // had taken out of the queue when it stalled).
+        REQUIRE(stalled->written <= 2 * 32);
+        REQUIRE(logger.Dropped(0) == MESSAGES - stalled->written);
+        REQUIRE(logger.Dropped() == logger.Dropped(0));
+    }
+
+    fs::remove(path);
+}
+
+TEST_CASE("test queued combined logger fields and context") {
+    const auto textPath = TempPath("slfmt_combined_attributes.log");
+    const auto jsonPath = TempPath("slfmt_combined_attributes.json");
+
+    {
+        std::vector<std::unique_ptr<slfmt::LoggerBase>> loggers;
+        loggers.push_back(slfmt::LogManager::GetFileLogger("Queued", textPath.string()));
+        loggers.push_back(slfmt::LogManager::GetFileLogger("Queued", jsonPath.string()));
+        loggers[0]->SetLayout(slfmt::LogFormat::Builder().Level().Context("[", "]").Fields().Message().Build());
+        loggers[1]->SetLayout(slfmt::LogFormat::Builder().Level().Context().Fields().Message().BuildJson());
+
+        slfmt::CombinedLogger logger("Queued", std::move(loggers),
+                                     { .delivery = slfmt::CombinedLogger::Delivery::QUEUED });
+
+        {
+            const slfmt::Context::Scope request("request", "r-7");
+            logger.Info({ { "user", "bob" } }, "queued");
+        }
+
+        logger.Info("plain");
+        logger.Flush();
+    }
+
+    // Formatted by the threads of the loggers, with the fields and context of the logging thread.
+    REQUIRE(ReadFile(textPath) == "INFO [request=r-7] user=bob queued\nINFO []  plain\n");
+    REQUIRE(ReadFile(jsonPath) ==
+            "{\"level\":\"INFO\",\"request\":\"r-7\",\"user\":\"bob\",\"message\":\"queued\"}\n"
+            "{\"level\":\"INFO\",\"message\":\"plain\"}\n");
+
+    fs::remove(textPath);
+    fs::remove(jsonPath);
+}
+
+TEST_CASE("test repeated messages") {
+    const auto path = TempPath("slfmt_repeats.log");
+
+    SECTION("message key") {
+        {
+            slfmt::FileLogger logger("Repeats", path.string());
+            logger.SuppressRepeats({ .window = std::chrono::hours(1) });
+
+            for (int i = 0; i < 1000; i++) {
+                logger.Warn("Connection to {} lost", "db");
+            }
+
+            logger.Warn("Connection to {} lost", "cache");
+            logger.Error("Connection to {} lost", "cache");
+            logger.Error("Connection to {} lost", "cache");
+        }
+
+        const auto log = ReadFile(path);
+        REQUIRE(CountOccurrences(log, "Connection to db lost") == 1);
+        REQUIRE(log.find("Last message repeated 999 times") < log.find("Connection to cache lost"));
+        REQUIRE(CountOccurrences(log, "Connection to cache lost") == 2);
+
+        // The pending repetitions are summarized when the logger is destroyed.
+        REQUIRE(log.find("ERROR (Repeats) [Thread-") != std::string::npos);
+        REQUIRE(log.ends_with("Last message repeated 1 times\n"));
+    }
+
+    SECTION("format key") {
+        int formatted = 0;
+
+        {
+            slfmt::FileLogger logger("Repeats", path.string());
+            logger.SuppressRepeats({ .window = std::chrono::hours(1), .key = slfmt::RepeatFilter::Key::FORMAT });
+
+            for (int i = 0; i < 100; i++) {
+                logger.Info("Request {} failed", Counted{ &formatted });
+            }
+        }
+
+        // Only the first message is formatted.
+        REQUIRE(formatted == 1);
+        REQUIRE(CountOccurrences(ReadFile(path), "Request 1 failed") == 1);
+        REQUIRE(ReadFile(path).find("Last message repeated 99 times") != std::string::npos);
+    }
+
+    fs::remove(path);
+}
+
+TEST_CASE("test log volume") {
+    const auto path = TempPath("slfmt_volume.log");
+
+    {
+        slfmt::FileLogger noisy("VolumeNoisy", path.string());
+        slfmt::FileLogger quiet("VolumeQuiet", path.string());
+        noisy.SetLevel(slfmt::Level::INFO);
+
+        for (int i = 0; i < 100; i++) {
+            noisy.Debug("not written");
+            noisy.Info("item {:03}", i); // 8 bytes
+        }
+
+        noisy.Warn("1234");
+        quiet.Error("12345678901234567890");
+
+        {
+            auto batch = noisy.Batch();
+            batch.Info("12");
+        }
+    }
+
+    const auto top = slfmt::LogVolume::Top(100);
+    const auto noisy = std::find_if(top.begin(), top.end(), [](const auto &entry) {
+        return entry.clazz == "VolumeNoisy";
+    });
+    const auto quiet = std::find_if(top.begin(), top.end(), [](const auto &entry) {
+        return entry.clazz == "VolumeQuiet";
+    });
+
+    REQUIRE(noisy != top.end());
+    REQUIRE(quiet != top.end());
+    REQUIRE(noisy < quiet);
+    REQUIRE(noisy->records[static_cast<size_t>(slfmt::Level::DEBUG)] == 0);
+    REQUIRE(noisy->records[static_cast<size_t>(slfmt::Level::INFO)] == 101);
+    REQUIRE(noisy->bytes[static_cast<size_t>(slfmt::Level::INFO)] == 100 * 8 + 2);
+    REQUIRE(noisy->TotalBytes() == 100 * 8 + 2 + 4);
+    REQUIRE(quiet->TotalRecords() == 1);
+
+    // By records, the ranking is the same; the report shows both.
+    const auto report = slfmt::LogVolume::Report(100, slfmt::LogVolume::Order::RECORDS);
+    REQUIRE(report.find("VolumeNoisy: 102 records, 806 bytes (INFO 101/802, WARN 1/4)") != std::string::npos);
+    REQUIRE(report.find("VolumeNoisy") < report.find("VolumeQuiet"));
+
+    // Periodic reports.
+    RecordingSink sink;
+
+    {
+        const slfmt::LogVolume::Reporter reporter(sink, 1, std::chrono::milliseconds(10));
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    REQUIRE(!sink.messages.empty());
+    REQUIRE(sink.messages[0].rfind("Log volume, top 1 classes by bytes:", 0) == 0);
+
+    fs::remove(path);
+}
+
+TEST_CASE("test scoped timer") {
+    const auto path = TempPath("slfmt_scoped_timer.log");
+
+    REQUIRE(slfmt::TimerHistogram::FormatDuration(std::chrono::nanoseconds(850)) == "850 ns");
+    REQUIRE(slfmt::TimerHistogram::FormatDuration(std::chrono::microseconds(1250)) == "1.25 ms");
+
+    SECTION("each duration is logged") {
+        {
+            slfmt::FileLogger logger("Timed", path.string());
+
+            {
+                slfmt::ScopedTimer timer(logger, "parse");
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                REQUIRE(timer.Stop() >= std::chrono::milliseconds(2));
+                REQUIRE(timer.Stop() == std::chrono::nanoseconds::zero());
+            }
+
+            // Not measured when the level is not written.
+            logger.SetLevel(slfmt::Level::INFO);
+            slfmt::ScopedTimer disabled(logger, "skipped");
+            REQUIRE(disabled.Stop() == std::chrono::nanoseconds::zero());
+        }
+
+        const auto contents = ReadFile(path);
+        REQUIRE(CountOccurrences(contents, "parse took ") == 1);
+        REQUIRE(contents.find("skipped") == std::string::npos);
+    }
+
+    SECTION("durations are summarized") {
+        {
+            slfmt::FileLogger logger("Timed", path.string());
+            slfmt::TimerHistogram histogram(logger, "step", slfmt::Level::INFO, std::chrono::hours(1));
+
+            for (int i = 0; i < 100; i++) {
+                const slfmt::ScopedTimer timer(histogram);
+            }
+
+            REQUIRE(ReadFile(path).empty());
+            histogram.Report();
+        } // Nothing left to summarize when the histogram is destroyed.
+
+        const auto contents = ReadFile(path);
+        REQUIRE(CountOccurrences(contents, "step: ") == 1);
+        REQUIRE(contents.find("step: 100 calls in ") != std::string::npos);
+        REQUIRE(contents.find(", p99 ") != std::string::npos);
+    }
+
+    fs::remove(path);
+}
+
+TEST_CASE("test batches") {
+    const auto path = TempPath("slfmt_batch.log");
+    const auto errorPath = TempPath("slfmt_batch_error.log");
+
+    slfmt::Clock::Use(&FixedTime);
+
+    {
+        auto fileLogger = slfmt::LogManager::GetFileLogger("Batch", path.string());
+        auto errorLogger = slfmt::LogManager::GetFileLogger("Batch", errorPath.string());
+        errorLogger->SetLevel(slfmt::Level::ERROR);
+
+        const auto logger =
+                slfmt::LogManager::GetCombinedLogger("Batch", std::move(fileLogger), std::move(errorLogger));
+        logger->SetLevel(slfmt::Level::DEBUG);
+
+        {
+            auto batch = logger->Batch(slfmt::LogBatch::Timestamp::SNAPSHOT);
+            slfmt::Clock::Use(slfmt::Clock::Source::SYSTEM);
+
+            for (int i = 0; i < 100; i++) {
+                batch.Info("item {}", i);
+            }
+
+            batch.Trace("discarded");
+            batch.Error("failed {}", "{braces}");
+            REQUIRE(batch.Size() == 101);
+
+            // Nothing is written until the batch is committed.
+            REQUIRE(!fs::exists(path));
+        }
+
+        logger->Info("after");
+    }
+
+    const auto log = ReadFile(path);
+    const auto errorLog = ReadFile(errorPath);
+
+    REQUIRE(CountOccurrences(log, "\n") == 102);
+    REQUIRE(log.find("item 0") < log.find("item 99"));
+    REQUIRE(log.find("item 99") < log.find("failed {braces}"));
+    REQUIRE(log.find("discarded") == std::string::npos);
+
+    // Every message of the batch has the time it was created at.
+    REQUIRE(CountOccurrences(log, slfmt::LogFormat::FormatTimestamp(FixedTime())) == 101);
+
+    REQUIRE(CountOccurrences(errorLog, "\n") == 1);
+    REQUIRE(errorLog.find("failed {braces}") != std::string::npos);
+
+    fs::remove(path);
+    fs::remove(errorPath);
+}
+
+#ifdef SLFMT_HAS_COROUTINES
+/**
+ * @brief A coroutine that starts right away and is not awaited by anyone.
+ */
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+static Detached AwaitRecord(slfmt::DurableFileLogger &logger, const slfmt::DurableFileLogger::Sequence sequence,
+                            std::atomic<bool> &durable) {
+    co_await logger.AwaitDurable(sequence);
+    durable = true;
+}
+#endif
+
+TEST_CASE("test durable file logger") {
+    const auto path = TempPath("slfmt_durable.log");
+
+    {
+        slfmt::DurableFileLogger logger("Durable", path.string(), { .commitDelay = std::chrono::milliseconds(1) });
+        slfmt::DurableFileLogger::Sequence last = 0;
+
+        for (int i = 0; i < 100; i++) {
+            last = logger.Append(slfmt::Level::INFO, "record {}", i);
+        }
+
+        // A single sync makes all the previous records durable.
+        REQUIRE(last == 100);
+        logger.WaitDurable(last);
+        REQUIRE(logger.DurableSequence() == 100);
+        REQUIRE(logger.Commits() == 1);
+
+        std::atomic<int> notDurable = 0;
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&logger, &notDurable, t] {
+                for (int i = 0; i < 50; i++) {
+                    const auto sequence = logger.Append(slfmt::Level::INFO, "record {}-{}", t, i);
+                    logger.WaitDurable(sequence);
+
+                    if (logger.DurableSequence() < sequence) {
+                        notDurable++;
+                    }
+                }
+            });
+        }
+
+        for (auto &thread: threads) {
+            thread.join();
+        }
+
+        REQUIRE(notDurable == 0);
+        REQUIRE(logger.LastSequence() == 300);
+
+        // Messages logged as usual are sequenced too.
+        logger.Info("record {}", "info");
+        REQUIRE(logger.LastSequence() == 301);
+
+#ifdef SLFMT_HAS_COROUTINES
+        std::atomic<bool> durable = false;
+        AwaitRecord(logger, logger.LastSequence(), durable);
+        REQUIRE(logger.WaitDurable(logger.LastSequence(), std::chrono::seconds(5)));
+
+        for (int i = 0; i < 100 && !durable; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        REQUIRE(durable);
+#else
+        REQUIRE(logger.WaitDurable(logger.LastSequence(), std::chrono::seconds(5)));
+#endif
+        REQUIRE_THROWS_AS(logger.WaitDurable(logger.LastSequence() + 1), std::runtime_error);
+
+        logger.SetLevel(slfmt::Level::WARN);
+        REQUIRE(logger.Append(slfmt::Level::INFO, "discarded") == 0);
+    }
+
+    REQUIRE(CountOccurrences(ReadFile(path), "record ") == 301);
+    fs::remove(path);
+}
+
+#ifndef _WIN32
+TEST_CASE("test shared memory ring") {
+    const std::string name = "/slfmt-test-ring";
+    slfmt::ShmRing::Remove(name);
+
+    slfmt::ShmRing reader(name, slfmt::ShmRing::MIN_CAPACITY);
+    REQUIRE(reader.Capacity() == slfmt::ShmRing::MIN_CAPACITY);
+
+    constexpr int THREADS = 4;
+    constexpr int MESSAGES = 20000;
+    std::atomic<int> finished = 0;
+    std::vector<std::thread> threads;
+
+    // Each writer attaches to the ring on its own, like another process would.
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&name, &finished, t] {
+            slfmt::ShmLogger logger("Writer" + std::to_string(t), name);
+
+            for (int i = 0; i < MESSAGES; i++) {
+                logger.Info("{} {}", i, std::string(static_cast<size_t>(i % 200), 'x'));
+            }
+
+            finished++;
+        });
+    }
+
+    std::string buffer;
+    slfmt::ShmRing::Record record;
+    std::vector<int> next(THREADS, 0);
+    size_t read = 0;
+    bool ordered = true;
+
+    while (true) {
+        const bool done = finished == THREADS;
+
+        if (!reader.Read(buffer, record)) {
+            if (done) {
+                break;
+            }
+
+            std::this_thread::yield();
+            continue;
+        }
+
+        // The records of every writer arrive complete and in order (some may have been dropped).
+        const auto thread = record.clazz.back() - '0';
+        const auto space = record.message.find(' ');
+        const auto number = std::stoi(std::string(record.message.substr(0, space)));
+        ordered = ordered && number >= next[thread] && record.message.size() - space - 1 == size_t(number % 200);
+        next[thread] = number + 1;
+        read++;
+    }
+
+    for (auto &thread: threads) {
+        thread.join();
+    }
+
+    REQUIRE(ordered);
+    REQUIRE(read > 0);
+    REQUIRE(read + reader.Dropped() == THREADS * MESSAGES);
+
+    slfmt::ShmRing::Remove(name);
+}
+
+TEST_CASE("test shared memory ring after a writer died") {
+    const std::string name = "/slfmt-test-dead-writer";
+    slfmt::ShmRing::Remove(name);
+
+    slfmt::ShmRing ring(name, slfmt::ShmRing::MIN_CAPACITY);
+
+    // A writer that stops right after claiming the header of a 64 bytes record, before moving the end of the
+    // reserved space: the ring header takes 256 bytes, and the first record header starts with its state (the size,
+    // and the process ID of the writer from bit 34).
+    const int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    REQUIRE(fd >= 0);
+    auto *memory = ::mmap(nullptr, 256 + ring.Capacity(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    REQUIRE(memory != MAP_FAILED);
+    const auto word = [memory](const size_t offset) {
+        return std::atomic_ref<std::uint64_t>(*reinterpret_cast<std::uint64_t *>(static_cast<char *>(memory) + 256 +
+                                                                                  offset));
+    };
+    const auto claim = [&word](const size_t offset, const pid_t pid) {
+        word(offset).store(64 | static_cast<std::uint64_t>(pid) << 34);
+    };
+
+    // A process that no longer exists.
+    const pid_t dead = fork();
+
+    if (dead == 0) {
+        _exit(0);
+    }
+
+    REQUIRE(waitpid(dead, nullptr, 0) == dead);
+
+    std::string buffer;
+    slfmt::ShmRing::Record record;
+    const auto timeout = std::chrono::milliseconds(10);
+
+    // A slow writer (its process is alive) keeps its record however long it takes.
+    claim(0, getpid());
+    REQUIRE(!ring.Read(buffer, record, timeout));
+    std::this_thread::sleep_for(timeout * 2);
+    REQUIRE(!ring.Read(buffer, record, timeout));
+    REQUIRE(ring.Dropped() == 0);
+
+    // The consumer knows the size of the dead record, so it skips it once it has waited for the timeout.
+    claim(0, dead);
+    REQUIRE(!ring.Read(buffer, record, timeout));
+    std::this_thread::sleep_for(timeout * 2);
+    REQUIRE(!ring.Read(buffer, record, timeout));
+    REQUIRE(ring.Dropped() == 1);
+
+    // The next writer moves the end of the reserved space past the dead record, and writes after it.
+    claim(64, dead);
+    REQUIRE(ring.Write(slfmt::Level::INFO, slfmt::Clock::Now(), "Ring", "1", "after"));
+    REQUIRE(!ring.Read(buffer, record, timeout));
+    std::this_thread::sleep_for(timeout * 2);
+    REQUIRE(ring.Read(buffer, record, timeout));
+    REQUIRE(record.message == "after");
+    REQUIRE(ring.Dropped() == 2);
+
+    // A record whose strings would not fit in it (e.g. overwritten by a writer that resumed late) is dropped, not
+    // read past its end: it comes after the 48 bytes of the last record, and its message size is at offset 24.
+    const size_t position = 128 + 48;
+    word(position + 24).store(1 << 20);
+    word(position).store(64 | 1ULL << 32);
+    REQUIRE(!ring.Read(buffer, record, timeout));
+    REQUIRE(ring.Dropped() == 3);
+
+    ::munmap(memory, 256 + ring.Capacity());
+    slfmt::ShmRing::Remove(name);
+}
+
+TEST_CASE("test shared memory logger fields and context") {
+    const std::string name = "/slfmt-test-attributes";
+    const auto path = TempPath("slfmt_shm_attributes.log");
+    slfmt::ShmRing::Remove(name);
+
+    slfmt::ShmRing reader(name, slfmt::ShmRing::MIN_CAPACITY);
+
+    {
+        slfmt::ShmLogger logger("Shm", name);
+
+        {
+            const slfmt::Context::Scope request("request", "r-7");
+            logger.Info({ { "user", "bob" } }, "sent");
+        }
+
+        logger.Info("plain");
+    }
+
+    // Formatted like the agent does, with the fields and context of the logging thread.
+    {
+        slfmt::FileLogger file("Shm", path.string());
+        file.SetLayout(slfmt::LogFormat::Builder().Level().Context("[", "]").Fields().Message().Build());
+
+        std::string buffer;
+        slfmt::ShmRing::Record record;
+        slfmt::LogFormat::Attributes attributes;
+
+        while (reader.Read(buffer, record)) {
+            REQUIRE(slfmt::LogFormat::Attributes::Deserialize(record.attributes, attributes));
+            const slfmt::LogFormat::AttributesScope scope(attributes);
+            file.Write({ record.level, record.clazz, record.message });
+        }
+    }
+
+    REQUIRE(ReadFile(path) == "INFO [request=r-7] user=bob sent\nINFO []  plain\n");
+
+    // Sizes past the end of the attributes (the ring is shared with other processes).
+    slfmt::LogFormat::Attributes attributes;
+    attributes.contextText = "stale";
+    REQUIRE(!slfmt::LogFormat::Attributes::Deserialize(std::string("\x05\0\0\0ab", 6), attributes));
+    REQUIRE(attributes.Empty());
+
+    slfmt::ShmRing::Remove(name);
+    fs::remove(path);
+}
+
+TEST_CASE("test numa buffered sink") {
+    SECTION("topology") {
+        const auto root = fs::temp_directory_path() / "slfmt_numa";
+        fs::remove_all(root);
+        fs::create_directories(root / "node0");
+        fs::create_directories(root / "node2");
+        std::ofstream(root / "node0" / "cpulist") << "0-1,4\n";
+        std::ofstream(root / "node2" / "cpulist") << "2-3\n";
+
+        const auto topology = slfmt::NumaTopology::Read(root);
+        REQUIRE(topology.NodeCount() == 2);
+        REQUIRE(topology.NodeCpus(0) == std::vector<int>{ 0, 1, 4 });
+        REQUIRE(topology.NodeOf(3) == 1);
+        REQUIRE(topology.NodeOf(4) == 0);
+        REQUIRE(slfmt::NumaTopology::Read(root / "missing").NodeCount() == 1);
+
+        fs::remove_all(root);
+    }
+
+    SECTION("records") {
+        constexpr int THREADS = 4;
+        constexpr int MESSAGES = 5000;
+        const auto collector = std::make_shared<RecordingSink>();
+        std::vector<std::string> threadIds(THREADS);
+
+        {
+            // Small buffers, so the threads often wait for the drain threads.
+            const auto sink = std::make_shared<slfmt::NumaBufferedSink>(
+                    collector, slfmt::NumaBufferedSink::Options{ 4096, slfmt::PageBuffer::Pages::NORMAL });
+            std::vector<std::thread> threads;
+
+            for (int t = 0; t < THREADS; t++) {
+                threads.emplace_back([&sink, &threadIds, t] {
+                    slfmt::SinkLogger logger("Numa", sink);
+                    threadIds[t] = slfmt::LogFormat::GetThreadIdString();
+
+                    for (int i = 0; i < MESSAGES; i++) {
+                        logger.Info("{} {}", t, i);
+                    }
+                });
+            }
+
+            for (auto &thread: threads) {
+                thread.join();
+            }
+
+            sink->Flush();
+            REQUIRE(collector->messages.size() == THREADS * MESSAGES);
+
+            // Larger than a buffer: written directly.
+            slfmt::SinkLogger("Numa", sink).Info("{}", std::string(8192, 'x'));
+        }
+
+        // The records of every thread arrive in order, with the thread that logged them.
+        std::vector<int> next(THREADS, 0);
+        bool ordered = true;
+
+        for (size_t i = 0; i + 1 < collector->messages.size(); i++) {
+            const auto t = collector->messages[i][0] - '0';
+            ordered = ordered && collector->messages[i] == fmt::format("{} {}", t, next[t]++) &&
+                      collector->threads[i] == threadIds[t];
+        }
+
+        REQUIRE(ordered);
+        REQUIRE(collector->messages.back().size() == 8192);
+    }
+
+    SECTION("failing sink") {
+        // Stands for a file on a full disk.
+        struct FailingSink : slfmt::Sink {
+            void Write([[maybe_unused]] const slfmt::Record &record) override {
+                throw std::runtime_error("No space left on device");
+            }
+        };
+
+        const auto sink = std::make_shared<slfmt::NumaBufferedSink>(std::make_shared<FailingSink>());
+        slfmt::SinkLogger logger("Numa", sink);
+
+        for (int i = 0; i < 3; i++) {
+            logger.Info("lost {}", i);
+        }
+
+        // The drain thread survives the errors, and the records still count as written.
+        sink->Flush();
+        REQUIRE(sink->Dropped() == 3);
+    }
+
+    SECTION("fields and context") {
+        const auto textPath = TempPath("slfmt_numa_attributes.log");
+        const auto jsonPath = TempPath("slfmt_numa_attributes.json");
+
+        {
+            const auto files = std::make_shared<slfmt::StaticLogger<slfmt::FileLogger, slfmt::FileLogger>>(
+                    "Numa", std::tuple(textPath.string()), std::tuple(jsonPath.string()));
+            files->Get<0>().SetLayout(slfmt::LogFormat::Builder().Level().Context("[", "]").Fields().Message().Build());
+            files->Get<1>().SetLayout(slfmt::LogFormat::Builder().Level().Context().Fields().Message().BuildJson());
+
+            const auto sink = std::make_shared<slfmt::NumaBufferedSink>(files);
+            slfmt::SinkLogger logger("Numa", sink);
+
+            {
+                const slfmt::Context::Scope request("request", "r-7");
+                logger.Info({ { "user", "bob" } }, "drained");
+            }
+
+            logger.Info("plain");
+            sink->Flush();
+        }
+
+        // Formatted by the drain thread, with the fields and context of the logging thread.
+        REQUIRE(ReadFile(textPath) == "INFO [request=r-7] user=bob drained\nINFO []  plain\n");
+        REQUIRE(ReadFile(jsonPath) ==
+                "{\"level\":\"INFO\",\"request\":\"r-7\",\"user\":\"bob\",\"message\":\"drained\"}\n"
+                "{\"level\":\"INFO\",\"message\":\"plain\"}\n");
+
+        fs::remove(textPath);
+        fs::remove(jsonPath);
+    }
+}
+#endif
+
+TEST_CASE("test concurrent file logging") {
+    const auto path = TempPath("slfmt_concurrent.log");
+    constexpr int THREADS = 4;
+    constexpr int MESSAGES = 2000;
+
+    const auto bufferSize = GENERATE(0, 4096);
+
+    {
+        slfmt::FileLogger logger("Concurrent", path.string(), bufferSize);
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([&logger, t] {
+                for (int i = 0; i < MESSAGES; i++) {
+                    logger.Info("thread {} message {} {}", t, i, std::string(static_cast<size_t>(i % 97), 'x'));
+                }
+            });
+        }
+
+        for (auto &thread: threads) {
+            thread.join();
+        }
+    }
+
+    // Every message is written whole, on its own line.
+    std::ifstream stream(path);
+    std::string line;
+    int lines = 0;
+
+    while (std::getline(stream, line)) {
+        const auto message = line.find("thread ");
+        REQUIRE(message != std::string::npos);
+        REQUIRE(line.find("thread ", message + 1) == std::string::npos);
+
+        int i = 0;
+        REQUIRE(std::sscanf(line.c_str() + message, "thread %*d message %d", &i) == 1);
+        REQUIRE(line.size() - line.find_last_not_of('x') - 1 == static_cast<size_t>(i % 97));
+        lines++;
+    }
+
+    REQUIRE(lines == THREADS * MESSAGES);
+    fs::remove(path);
+}
+
+static std::string Gunzip(const std::string &data) {
+    // Skip the 10 bytes gzip header written by slfmt and inflate the raw deflate stream.
+    mz_stream stream{};
+    std::string output(1024 * 1024, '\0');
+
+    REQUIRE(mz_inflateInit2(&stream, -MZ_DEFAULT_WINDOW_BITS) == MZ_OK);
+    stream.next_in = reinterpret_cast<const unsigned char *>(data.data()) + 10;
+    stream.avail_in = static_cast<unsigned int>(data.size() - 10);
+    stream.next_out = reinterpret_cast<unsigned char *>(output.data());
+    stream.avail_out = static_cast<unsigned int>(output.size());
+
+    mz_inflate(&stream, MZ_SYNC_FLUSH);
+    output.resize(stream.total_out);
+    mz_inflateEnd(&stream);
+
+    return output;
+}
+
+TEST_CASE("test gzip writer") {
+    const auto path = TempPath("slfmt_gzip_writer.log.gz");
+
+    std::string expected;
+    slfmt::FileWriter writer(path.string());
+    slfmt::GzipWriter gzip(writer, 1024);
+
+    gzip.Begin();
+
+    for (int i = 0; i < 100; i++) {
+        const auto line = fmt::format("line number {}\n", i);
+        gzip.Write(line);
+        expected += line;
+    }
+
+    SECTION("flushed blocks can be read before the stream is finished") {
+        const auto flushed = Gunzip(ReadFile(path));
+
+        REQUIRE(!flushed.empty());
+        REQUIRE(expected.starts_with(flushed));
+    }
+
+    SECTION("finished stream contains everything") {
+        gzip.Finish();
+        REQUIRE(Gunzip(ReadFile(path)) == expected);
+    }
+
+    fs::remove(path);
+}
+
+TEST_CASE("test block index") {
+    const auto path = TempPath("slfmt_block_index.log.gz");
+    const auto indexPath = slfmt::BlockIndex::IndexFileName(path.string());
+    fs::remove(indexPath);
+
+    {
+        slfmt::FileWriter writer(path.string());
+        slfmt::FileWriter index(indexPath);
+        slfmt::GzipWriter gzip(writer, 0);
+
+        // Two independent blocks: the first one with INFO messages, the second one with an ERROR.
+        for (const auto &[level, time, message]: { std::tuple{ slfmt::Level::INFO, 1000, "first block\n" },
+                                                   std::tuple{ slfmt::Level::ERROR, 2000, "second block\n" } }) {
+            slfmt::BlockIndex::Entry entry;
+            entry.offset = gzip.OutputSize();
+            entry.Add(level, time);
+
+            gzip.Begin();
+            gzip.Write(message);
+            gzip.Finish();
+
+            entry.size = gzip.OutputSize() - entry.offset;
+            index.Write(slfmt::BlockIndex::FormatEntry(entry));
+        }
+    }
+
+    const auto entries = slfmt::BlockIndex::Read(indexPath);
+
+    REQUIRE(entries.size() == 2);
+    REQUIRE(entries[0].Overlaps(0, 1500));
+    REQUIRE(!entries[1].Overlaps(0, 1500));
+    REQUIRE(!entries[0].HasLevelAtLeast(slfmt::Level::WARN));
+    REQUIRE(entries[1].HasLevelAtLeast(slfmt::Level::WARN));
+    REQUIRE(slfmt::BlockIndex::ReadBlock(path, entries[1]) == "second block\n");
+
+    fs::remove(path);
+    fs::remove(indexPath);
+}
+
+TEST_CASE("test block index of queued records") {
+    const auto path = TempPath("slfmt_index_time.log");
+    const auto compressedPath = fs::path(path.string() + ".gz");
+    const auto indexPath = slfmt::BlockIndex::IndexFileName(compressedPath.string());
+    fs::remove(compressedPath);
+    fs::remove(indexPath);
+
+    {
+        std::vector<std::unique_ptr<slfmt::LoggerBase>> loggers;
+        loggers.push_back(std::make_unique<slfmt::RollingFileLogger>(
+                "Index", path.string(),
+                slfmt::RollingFileLogger::Options{ .compression = slfmt::RollingFileLogger::Compression::GZIP,
+                                                   .index = true }));
+        slfmt::CombinedLogger logger("Index", std::move(loggers),
+                                     { .delivery = slfmt::CombinedLogger::Delivery::QUEUED });
+
+        // Logged long before its thread writes it.
+        const auto time = FixedTime();
+        const auto timestamp = slfmt::LogFormat::FormatTimestamp(time);
+        const slfmt::LogFormat::TimestampScope scope(timestamp, time);
+        logger.Info("logged a while ago");
+    }
+
+    // The block is indexed with the time the record shows, not the time it was written at.
+    const auto entries = slfmt::BlockIndex::Read(indexPath);
+    REQUIRE(entries.size() == 1);
+    REQUIRE(entries[0].firstTime == 1700000000123);
+    REQUIRE(entries[0].lastTime == 1700000000123);
+
+    fs::remove(compressedPath);
+    fs::remove(indexPath);
+}
+
+TEST_CASE("test file writer replacement") {
+    const auto path = TempPath("slfmt_replaced_writer.log");
+    const auto renamed = TempPath("slfmt_replaced_writer.log.1");
+
+    slfmt::FileWriter writer(path.string());
+    slfmt::FileWriter other(path.string());
+
+    writer.Write("first\n");
+    other.Write("second\n");
+    REQUIRE(writer.FileSize() == 13);
+    REQUIRE(!writer.IsReplaced(path.string()));
+
+#ifndef _WIN32
+    {
+        // Another writer rolls the file over while this one still has it open.
+        slfmt::FileLock lock(path.string() + ".lock");
+        fs::rename(path, renamed);
+        other.Open(path.string());
+    }
+
+    REQUIRE(writer.IsReplaced(path.string()));
+    writer.Open(path.string());
+    REQUIRE(!writer.IsReplaced(path.string()));
+    REQUIRE(writer.FileSize() == 0);
+#endif
+
+    writer.Close();
+    other.Close();
+    fs::remove(path);
+    fs::remove(renamed);
+    fs::remove(path.string() + ".lock");
+}
+
+#ifndef _WIN32
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+
+/**
+ * @brief Creates a Unix domain socket bound to the specified path (a stand-in for a local log agent).
+ */
+static int BindSocket(const fs::path &path, const int type) {
+    fs::remove(path);
+
+    const int fd = socket(AF_UNIX, type, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    path.string().copy(address.sun_path, sizeof(address.sun_path) - 1);
+
+    REQUIRE(bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0);
+
+    if (type == SOCK_STREAM) {
+        REQUIRE(listen(fd, 1) == 0);
+    }
+
+    return fd;
+}
+
+TEST_CASE("test socket logger") {
+    SECTION("datagrams with syslog framing") {
+        const auto path = TempPath("slfmt_socket_dgram.sock");
+        const int server = BindSocket(path, SOCK_DGRAM);
+
+        {
+            slfmt::SocketLogger logger("Socket", path.string(),
+                                       { .framing = slfmt::SocketLogger::Framing::RFC5424, .appName = "test" });
+            logger.Info("hello {}", 1);
+            logger.Error("bye");
+            REQUIRE(logger.Flush());
+        }
+
+        std::array<char, 1024> buffer{};
+        auto size = recv(server, buffer.data(), buffer.size(), 0);
+        const std::string first(buffer.data(), static_cast<size_t>(size));
+        size = recv(server, buffer.data(), buffer.size(), 0);
+        const std::string second(buffer.data(), static_cast<size_t>(size));
+
+        REQUIRE(first.starts_with("<14>1 "));
+        REQUIRE(first.find(" test ") != std::string::npos);
+        REQUIRE(first.ends_with(" Socket - hello 1"));
+        REQUIRE(second.starts_with("<11>1 "));
+
+        close(server);
+        fs::remove(path);
+    }
+
+    SECTION("stream reconnecting once the agent is up") {
+        const auto path = TempPath("slfmt_socket_stream.sock");
+
+        slfmt::SocketLogger logger("Socket", path.string(), { .transport = slfmt::SocketLogger::Transport::STREAM });
+
+        // The agent is not running: logging does not block, messages wait in the queue.
+        logger.Info("first");
+        REQUIRE(!logger.Flush(std::chrono::milliseconds(50)));
+
+        const int server = BindSocket(path, SOCK_STREAM);
+        logger.Info("second");
+        REQUIRE(logger.Flush(std::chrono::seconds(5)));
+        REQUIRE(logger.Dropped() == 0);
+
+        const int connection = accept(server, nullptr, nullptr);
+        std::string received;
+        std::array<char, 1024> buffer{};
+
+        while (std::count(received.begin(), received.end(), '\n') < 2) {
+            const auto size = recv(connection, buffer.data(), buffer.size(), 0);
+            REQUIRE(size > 0);
+            received.append(buffer.data(), static_cast<size_t>(size));
+        }
+
+        REQUIRE(received.find("first\n") < received.find("second\n"));
+
+        close(connection);
+        close(server);
+        fs::remove(path);
+    }
+}
+#endif
@@ -0,0 +1,190 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * slfmt-agent.cpp - Writes the messages of a shared memory ring (see ShmLogger) to a log file
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <functional>
+#include <memory>
+#include <slfmt/FileLogger.h>
+#include <slfmt/LogFormat.h>
+#include <slfmt/RollingFileLogger.h>
+#include <slfmt/ShmRing.h>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+    /**
+     * @brief The ring to read and where to write its messages.
+     */
+    struct Config {
+        std::string ring{};
+        std::string file{};
+        size_t capacity = slfmt::ShmRing::DEFAULT_CAPACITY;
+        size_t rollingSize = 0;
+        size_t bufferSize = 64 * 1024;
+    };
+
+    /**
+     * @brief The logger writing the messages of all the classes, and how to flush it.
+     */
+    struct Output {
+        std::unique_ptr<slfmt::LoggerBase> sink;
+        std::function<void()> flush;
+    };
+
+    volatile std::sig_atomic_t s_stop = 0;
+
+    void Stop(int) {
+        s_stop = 1;
+    }
+
+    void PrintUsage() {
+        fmt::print(stderr,
+                   "Usage: slfmt-agent [options] --ring <name> --file <file>\n"
+                   "\n"
+                   "Reads the messages that ShmLoggers write to a shared memory ring, formats them and writes them\n"
+                   "to a log file, until interrupted (SIGINT or SIGTERM). The ring is created if it does not exist.\n"
+                   "\n"
+                   "Options:\n"
+                   "  --ring <name>      Name of the shared memory ring (e.g. /myapp-log)\n"
+                   "  --file <file>      Log file to write the messages to\n"
+                   "  --rolling <MB>     Roll the log file over when it reaches the size\n"
+                   "  --capacity <KB>    Size of the ring, if the agent creates it\n"
+                   "  --buffer <KB>      Size of the write buffer (0 to write every message immediately)\n");
+    }
+
+    bool ParseArguments(const int argc, char *argv[], Config &config) {
+        for (int i = 1; i < argc; i++) {
+            const std::string_view arg = argv[i];
+
+            if (arg == "--help" || arg == "-h") {
+                return false;
+            }
+
+            if (i + 1 >= argc) {
+                fmt::print(stderr, "Missing value for {}\n", arg);
+                return false;
+            }
+
+            const std::string_view value = argv[++i];
+
+            if (arg == "--ring") {
+                config.ring = value;
+            } else if (arg == "--file") {
+                config.file = value;
+            } else if (arg == "--rolling") {
+                config.rollingSize = static_cast<size_t>(std::atoll(value.data())) * 1024 * 1024;
+            } else if (arg == "--capacity") {
+                config.capacity = static_cast<size_t>(std::atoll(value.data())) * 1024;
+            } else if (arg == "--buffer") {
+                config.bufferSize = static_cast<size_t>(std::atoll(value.data())) * 1024;
+            } else {
+                fmt::print(stderr, "Unknown option: {}\n", arg);
+                return false;
+            }
+        }
+
+        return !config.ring.empty() && !config.file.empty();
+    }
+
+    /**
+     * @brief Creates the sink for the messages of all the classes: the records carry their class, so a single
+     * file (or rolling file) logger writes them all.
+     *
+     * @param config Where to write the messages.
+     *
+     * @return The logger.
+     */
+    Output CreateOutput(const Config &config) {
+        if (config.rollingSize == 0) {
+            auto logger = std::make_unique<slfmt::FileLogger>("", config.file, config.bufferSize);
+            auto *file = logger.get();
+            return { std::move(logger), [file] { file->Flush(); } };
+        }
+
+        slfmt::RollingFileLogger::Options options;
+        options.fileSize = config.rollingSize;
+        options.bufferSize = config.bufferSize;
+
+        auto logger = std::make_unique<slfmt::RollingFileLogger>("", config.file, options);
+        auto *file = logger.get();
+        return { std::move(logger), [file] { file->Flush(); } };
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Config config;
+
+    if (!ParseArguments(argc, argv, config)) {
+        PrintUsage();
+        return 1;
+    }
+
+    std::signal(SIGINT, Stop);
+    std::signal(SIGTERM, Stop);
+
+    try {
+        slfmt::ShmRing ring(config.ring, config.capacity);
+        const auto output = CreateOutput(config);
+        std::string buffer, threadId, timestamp;
+        std::chrono::milliseconds formattedTime{ -1 };
+        slfmt::ShmRing::Record record;
+        slfmt::LogFormat::Attributes attributes;
+        bool pending = false;
+
+        while (true) {
+            if (!ring.Read(buffer, record)) {
+                if (s_stop != 0) {
+                    break; // Stopped, and the ring is empty.
+                }
+
+                // Idle: write out what is buffered, and wait for more messages.
+                if (pending) {
+                    output.flush();
+
+                    pending = false;
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            // The messages are formatted with the time, thread, fields and context they were logged with (malformed
+            // attributes are left out).
+            const auto time = std::chrono::duration_cast<std::chrono::milliseconds>(record.time.time_since_epoch());
+
+            if (time != formattedTime) {
+                timestamp = slfmt::LogFormat::FormatTimestamp(record.time);
+                formattedTime = time;
+            }
+
+            threadId.assign(record.thread);
+            slfmt::LogFormat::Attributes::Deserialize(record.attributes, attributes);
+            const slfmt::LogFormat::TimestampScope timestampScope(timestamp, record.time);
+            const slfmt::LogFormat::ThreadIdScope threadIdScope(threadId);
+            const slfmt::LogFormat::AttributesScope attributesScope(attributes);
+            output.sink->Write({ record.level, record.clazz, record.message });
+            pending = true;
+        }
+
+        if (ring.Dropped() > 0) {
+            fmt::print(stderr, "{} messages were dropped because the ring was full.\n", ring.Dropped());
+        }
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "{}\n", e.what());
+        return 2;
+    }
+
+    return 0;
+}
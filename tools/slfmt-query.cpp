@@ -0,0 +1,398 @@
+/*
+ * slfmt - A simple logging library for C++
+ *
+ * slfmt-query.cpp - Finds the messages of indexed log archives matching a time range, level and class
+ *
+ * Copyright (c) 2023 Samuel Castrillo Domínguez
+ * All rights reserved.
+ *
+ * For more information, please see the LICENSE file.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fmt/format.h>
+#include <limits>
+#include <optional>
+#include <slfmt/BlockIndex.h>
+#include <slfmt/Level.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    /**
+     * @brief The filters of the query and where to look.
+     */
+    struct Query {
+        std::int64_t from = std::numeric_limits<std::int64_t>::min();
+        std::int64_t to = std::numeric_limits<std::int64_t>::max();
+        slfmt::Level level = slfmt::Level::TRACE;
+        std::string clazz{};
+        unsigned int jobs = std::max(1U, std::thread::hardware_concurrency());
+        std::vector<fs::path> archives{};
+    };
+
+    /**
+     * @brief An archive to search, with its index.
+     */
+    struct Archive {
+        fs::path file{};
+        std::vector<slfmt::BlockIndex::Entry> blocks{};
+    };
+
+    void PrintUsage() {
+        fmt::print(stderr,
+                   "Usage: slfmt-query [options] <archive.gz | directory>...\n"
+                   "\n"
+                   "Prints the messages of indexed slfmt log archives (file.gz + file.gz.idx) that match the filters.\n"
+                   "Only the blocks that may contain matching messages are decompressed.\n"
+                   "\n"
+                   "Options:\n"
+                   "  --from <time>    Only messages logged at or after the time\n"
+                   "  --to <time>      Only messages logged at or before the time\n"
+                   "  --level <level>  Only messages of the level or a more severe one (TRACE..FATAL)\n"
+                   "  --class <class>  Only messages of the class\n"
+                   "  --jobs <n>       Number of archives to search in parallel\n"
+                   "\n"
+                   "Times are local times (\"YYYY-MM-DD HH:MM:SS[,mmm]\") or milliseconds since the epoch.\n");
+    }
+
+    /**
+     * @brief Parses a local time in the format "YYYY-MM-DD HH:MM:SS[,mmm]" (a 'T' may separate date and time).
+     *
+     * @param str The string to parse.
+     *
+     * @return The time in milliseconds since the epoch, or nothing if the string is not a time.
+     */
+    std::optional<std::int64_t> ParseLocalTime(const std::string_view str) {
+        static constexpr std::string_view PATTERN = "0000-00-00 00:00:00";
+
+        if (str.size() < PATTERN.size()) {
+            return std::nullopt;
+        }
+
+        for (size_t i = 0; i < PATTERN.size(); i++) {
+            const bool isDigit = str[i] >= '0' && str[i] <= '9';
+            const bool separatorMatches = str[i] == PATTERN[i] || (i == 10 && str[i] == 'T');
+
+            if (PATTERN[i] == '0' ? !isDigit : !separatorMatches) {
+                return std::nullopt;
+            }
+        }
+
+        const auto number = [&str](const size_t position, const size_t length) {
+            int value = 0;
+            std::from_chars(str.data() + position, str.data() + position + length, value);
+            return value;
+        };
+
+        // Consecutive lines are usually logged in the same second: only call mktime when the second changes.
+        thread_local std::string lastSecond;
+        thread_local std::int64_t lastSecondTime = 0;
+
+        if (str.substr(0, PATTERN.size()) != lastSecond) {
+            std::tm tm{};
+            tm.tm_year = number(0, 4) - 1900;
+            tm.tm_mon = number(5, 2) - 1;
+            tm.tm_mday = number(8, 2);
+            tm.tm_hour = number(11, 2);
+            tm.tm_min = number(14, 2);
+            tm.tm_sec = number(17, 2);
+            tm.tm_isdst = -1;
+
+            lastSecond = str.substr(0, PATTERN.size());
+            lastSecondTime = static_cast<std::int64_t>(std::mktime(&tm)) * 1000;
+        }
+
+        std::int64_t millis = 0;
+        if (str.size() >= PATTERN.size() + 4 && (str[19] == ',' || str[19] == '.')) {
+            millis = number(20, 3);
+        }
+
+        return lastSecondTime + millis;
+    }
+
+    /**
+     * @brief Parses a time argument (local time or milliseconds since the epoch).
+     *
+     * @param str The argument.
+     *
+     * @return The time in milliseconds since the epoch, or nothing if the argument is invalid.
+     */
+    std::optional<std::int64_t> ParseTimeArgument(const std::string_view str) {
+        std::int64_t value = 0;
+        const auto [end, error] = std::from_chars(str.data(), str.data() + str.size(), value);
+
+        if (error == std::errc() && end == str.data() + str.size()) {
+            return value;
+        }
+
+        return ParseLocalTime(str);
+    }
+
+    bool ParseArguments(const int argc, char *argv[], Query &query) {
+        for (int i = 1; i < argc; i++) {
+            const std::string_view arg = argv[i];
+
+            if (arg == "--help" || arg == "-h") {
+                return false;
+            }
+
+            if (!arg.starts_with("--")) {
+                query.archives.emplace_back(arg);
+                continue;
+            }
+
+            if (i + 1 >= argc) {
+                fmt::print(stderr, "Missing value for {}\n", arg);
+                return false;
+            }
+
+            const std::string_view value = argv[++i];
+
+            if (arg == "--from" || arg == "--to") {
+                const auto time = ParseTimeArgument(value);
+
+                if (!time) {
+                    fmt::print(stderr, "Invalid time: {}\n", value);
+                    return false;
+                }
+
+                (arg == "--from" ? query.from : query.to) = *time;
+            } else if (arg == "--level") {
+                query.level = slfmt::StringToLevel(value);
+
+                if (query.level == slfmt::Level::UNKNOWN) {
+                    fmt::print(stderr, "Invalid level: {}\n", value);
+                    return false;
+                }
+            } else if (arg == "--class") {
+                query.clazz = value;
+            } else if (arg == "--jobs") {
+                query.jobs = static_cast<unsigned int>(std::max(1, std::atoi(value.data())));
+            } else {
+                fmt::print(stderr, "Unknown option: {}\n", arg);
+                return false;
+            }
+        }
+
+        return !query.archives.empty();
+    }
+
+    /**
+     * @brief Collects the indexed archives of the specified paths (directories are searched recursively).
+     *
+     * @param paths The files and directories to search.
+     *
+     * @return The archives, sorted by the time of their first block.
+     */
+    std::vector<Archive> FindArchives(const std::vector<fs::path> &paths) {
+        std::vector<fs::path> files;
+
+        for (const auto &path: paths) {
+            if (fs::is_directory(path)) {
+                for (const auto &entry: fs::recursive_directory_iterator(path)) {
+                    if (entry.is_regular_file() && entry.path().extension() == ".gz") {
+                        files.push_back(entry.path());
+                    }
+                }
+            } else {
+                files.push_back(path);
+            }
+        }
+
+        std::vector<Archive> archives;
+
+        for (const auto &file: files) {
+            const auto indexFile = slfmt::BlockIndex::IndexFileName(file.string());
+
+            if (!fs::exists(indexFile)) {
+                fmt::print(stderr, "Skipping {}: it has no index\n", file.string());
+                continue;
+            }
+
+            archives.push_back({ file, slfmt::BlockIndex::Read(indexFile) });
+        }
+
+        std::sort(archives.begin(), archives.end(), [](const Archive &a, const Archive &b) {
+            const auto firstTime = [](const Archive &archive) {
+                return archive.blocks.empty() ? 0 : archive.blocks.front().firstTime;
+            };
+
+            return firstTime(a) < firstTime(b);
+        });
+
+        return archives;
+    }
+
+    /**
+     * @brief Gets the value of a string member of a JSON line (without unescaping it).
+     *
+     * @param line The JSON line.
+     * @param key The member name.
+     *
+     * @return The value, or nothing if the line has no such member.
+     */
+    std::optional<std::string_view> JsonMember(const std::string_view line, const std::string_view key) {
+        const auto member = fmt::format("\"{}\":\"", key);
+        const auto start = line.find(member);
+
+        if (start == std::string_view::npos) {
+            return std::nullopt;
+        }
+
+        const auto valueStart = start + member.size();
+        auto valueEnd = valueStart;
+
+        while (valueEnd < line.size() && line[valueEnd] != '"') {
+            valueEnd += line[valueEnd] == '\\' ? 2 : 1;
+        }
+
+        return line.substr(valueStart, std::min(valueEnd, line.size()) - valueStart);
+    }
+
+    /**
+     * @brief Checks if a log line matches the filters of the query.
+     *
+     * @note Both JSON lines and the text layouts built with LogFormat::Builder are understood. Filters whose
+     * field cannot be found in the line (e.g. continuation lines of multi-line messages) do not exclude it.
+     *
+     * @param line The line to check.
+     * @param query The query.
+     *
+     * @return True if the line matches.
+     */
+    bool Matches(const std::string_view line, const Query &query) {
+        std::optional<std::int64_t> time;
+        std::optional<slfmt::Level> level;
+        std::optional<std::string_view> clazz;
+
+        if (line.starts_with('{')) {
+            if (const auto timestamp = JsonMember(line, "timestamp")) {
+                time = ParseLocalTime(*timestamp);
+            }
+
+            if (const auto levelString = JsonMember(line, "level")) {
+                level = slfmt::StringToLevel(*levelString);
+            }
+
+            clazz = JsonMember(line, "class");
+        } else {
+            // The timestamp may be preceded by a delimiter (e.g. "[").
+            for (size_t i = 0; i < 4 && i < line.size() && !time; i++) {
+                time = ParseLocalTime(line.substr(i));
+            }
+
+            size_t position = 0;
+
+            while (position < line.size() && (!level || !clazz)) {
+                const auto end = std::min(line.find(' ', position), line.size());
+                const auto token = line.substr(position, end - position);
+
+                if (!clazz && token.size() >= 2 && token.front() == '(' && token.back() == ')') {
+                    clazz = token.substr(1, token.size() - 2);
+                } else if (!level) {
+                    const auto trimmed = token.substr(0, token.find_last_not_of(")]>:") + 1);
+                    const auto candidate = slfmt::StringToLevel(trimmed.substr(std::min(
+                            trimmed.find_first_not_of("([<"), trimmed.size())));
+
+                    if (candidate != slfmt::Level::UNKNOWN) {
+                        level = candidate;
+                    }
+                }
+
+                position = end + 1;
+            }
+        }
+
+        return (!time || (*time >= query.from && *time <= query.to)) && (!level || *level >= query.level) &&
+               (query.clazz.empty() || !clazz || *clazz == query.clazz);
+    }
+
+    /**
+     * @brief Searches an archive, decompressing only the blocks that may contain matching messages.
+     *
+     * @param archive The archive to search.
+     * @param query The query.
+     *
+     * @return The matching lines.
+     */
+    std::string SearchArchive(const Archive &archive, const Query &query) {
+        std::string output;
+
+        for (const auto &block: archive.blocks) {
+            if (!block.Overlaps(query.from, query.to) || !block.HasLevelAtLeast(query.level)) {
+                continue;
+            }
+
+            const auto contents = slfmt::BlockIndex::ReadBlock(archive.file, block);
+            size_t position = 0;
+
+            while (position < contents.size()) {
+                const auto end = std::min(contents.find('\n', position), contents.size());
+                const auto line = std::string_view(contents).substr(position, end - position);
+
+                if (Matches(line, query)) {
+                    output.append(line);
+                    output += '\n';
+                }
+
+                position = end + 1;
+            }
+        }
+
+        return output;
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Query query;
+
+    if (!ParseArguments(argc, argv, query)) {
+        PrintUsage();
+        return 1;
+    }
+
+    const auto archives = FindArchives(query.archives);
+    std::vector<std::string> results(archives.size());
+    std::atomic<size_t> next = 0;
+    std::atomic<bool> failed = false;
+
+    // Each worker takes the next archive to search until there are none left.
+    const auto worker = [&] {
+        for (size_t i = next++; i < archives.size(); i = next++) {
+            try {
+                results[i] = SearchArchive(archives[i], query);
+            } catch (const std::exception &e) {
+                fmt::print(stderr, "{}: {}\n", archives[i].file.string(), e.what());
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    const auto workerCount = std::min<size_t>(query.jobs, archives.size());
+
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(worker);
+    }
+
+    for (auto &thread: workers) {
+        thread.join();
+    }
+
+    for (const auto &result: results) {
+        fmt::print("{}", result);
+    }
+
+    return failed ? 2 : 0;
+}